@@ -0,0 +1,88 @@
+# spdlog_setup_embed(<target> <toml_file> [NAMESPACE <name>])
+#
+# Embeds the TOML configuration file into the target at build time. The file
+# is validated and turned into the header "spdlog_setup_embedded/<name>.h",
+# which is made includable by the target and provides
+# spdlog_setup::embedded::<name>::setup_embedded(). <name> defaults to the
+# file name without extension, made into a C identifier. The file is validated
+# with the compile definitions of the target, but those set by #define in its
+# sources are not seen.
+#
+# The generator is built with the same toolchain as the target, so cross
+# builds need CMAKE_CROSSCOMPILING_EMULATOR to run it, e.g. qemu-user or wine.
+
+include(CMakeParseArguments)
+
+if(NOT SPDLOG_SETUP_EMBED_GENERATOR_SOURCE)
+  set(SPDLOG_SETUP_EMBED_GENERATOR_SOURCE
+    "${CMAKE_CURRENT_LIST_DIR}/../src/embed/main.cpp")
+endif()
+
+# global, since the function may be called from any directory scope
+set_property(GLOBAL PROPERTY SPDLOG_SETUP_EMBED_GENERATOR_SOURCE
+  "${SPDLOG_SETUP_EMBED_GENERATOR_SOURCE}")
+
+function(spdlog_setup_embed target toml_file)
+  cmake_parse_arguments(EMBED "" "NAMESPACE" "" ${ARGN})
+
+  get_filename_component(toml_path "${toml_file}" ABSOLUTE)
+
+  if(NOT EMBED_NAMESPACE)
+    get_filename_component(toml_name "${toml_file}" NAME_WE)
+    string(MAKE_C_IDENTIFIER "${toml_name}" EMBED_NAMESPACE)
+  endif()
+
+  # the generator is built once per target, with the toolchain and compile
+  # definitions of the target, so that it accepts the same sink types, such as
+  # syslog sinks behind SPDLOG_ENABLE_SYSLOG
+  set(generator "${target}_spdlog_setup_embed_generator")
+  set(generator_emulator)
+
+  if(CMAKE_CROSSCOMPILING)
+    if(NOT CMAKE_CROSSCOMPILING_EMULATOR)
+      message(FATAL_ERROR
+        "spdlog_setup_embed(${target} ${toml_file}) needs "
+        "CMAKE_CROSSCOMPILING_EMULATOR to run its generator, which is built "
+        "for the target platform when cross compiling")
+    endif()
+
+    set(generator_emulator ${CMAKE_CROSSCOMPILING_EMULATOR})
+  endif()
+
+  if(NOT TARGET ${generator})
+    get_property(generator_source
+      GLOBAL PROPERTY SPDLOG_SETUP_EMBED_GENERATOR_SOURCE)
+
+    add_executable(${generator} "${generator_source}")
+
+    set_property(TARGET ${generator} PROPERTY CXX_STANDARD 11)
+
+    target_compile_definitions(${generator}
+      PRIVATE
+        $<TARGET_PROPERTY:${target},COMPILE_DEFINITIONS>)
+
+    if(TARGET spdlog_setup)
+      target_link_libraries(${generator} PRIVATE spdlog_setup)
+    else()
+      target_link_libraries(${generator} PRIVATE spdlog_setup::spdlog_setup)
+    endif()
+
+    find_package(Threads REQUIRED)
+    target_link_libraries(${generator} PRIVATE Threads::Threads)
+  endif()
+
+  set(embed_dir "${CMAKE_CURRENT_BINARY_DIR}/spdlog_setup_embedded")
+  set(embed_header "${embed_dir}/${EMBED_NAMESPACE}.h")
+
+  add_custom_command(
+    OUTPUT "${embed_header}"
+    COMMAND "${CMAKE_COMMAND}" -E make_directory "${embed_dir}"
+    COMMAND ${generator_emulator} $<TARGET_FILE:${generator}>
+      "${toml_path}" "${embed_header}" "${EMBED_NAMESPACE}"
+    DEPENDS ${generator} "${toml_path}"
+    COMMENT "Embedding ${toml_file} as ${EMBED_NAMESPACE}"
+    VERBATIM)
+
+  target_sources(${target} PRIVATE "${embed_header}")
+  target_include_directories(${target} PRIVATE "${CMAKE_CURRENT_BINARY_DIR}")
+endfunction()
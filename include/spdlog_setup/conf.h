@@ -7,8 +7,15 @@
 #pragma once
 
 #include "details/conf_impl.h"
+#include "details/embed_impl.h"
+#include "details/reconfigure_impl.h"
 #include "details/setup_error.h"
+#include "details/shutdown_impl.h"
+#include "details/snapshot_impl.h"
+#include "details/stats_impl.h"
 #include "details/template_impl.h"
+#include "details/transaction_impl.h"
+#include "details/watch_impl.h"
 
 namespace spdlog_setup {
 // declaration section
@@ -23,6 +30,28 @@ template <class... Ps>
 void from_file_with_tag_replacement(
     const std::string &pre_toml_path, Ps &&... ps);
 
+/**
+ * Compiles the pre-TOML configuration file, whose tags are written as
+ * {{ name }}, into a template that can be rendered many times.
+ * @param pre_toml_path Path to the pre-TOML configuration file path.
+ * @return Compiled template of the file content.
+ * @throw setup_error
+ */
+auto compile_template_file(const std::string &pre_toml_path)
+    -> compiled_template;
+
+/**
+ * Performs spdlog configuration setup from a compiled pre-TOML template, with
+ * tag values to be replaced by the given mapping.
+ * @param pre_toml Compiled pre-TOML configuration template.
+ * @param tags Mapping of tag names to values. Missing tags are rendered as
+ * empty.
+ * @throw setup_error
+ */
+void from_file_with_tag_replacement(
+    const compiled_template &pre_toml,
+    const std::unordered_map<std::string, std::string> &tags);
+
 /**
  * Performs spdlog configuration setup from both base and override files, with
  * tag values to be replaced into various primitive values for both files. The
@@ -60,6 +89,160 @@ auto from_file_and_override(
     const std::string &base_toml_path, const std::string &override_toml_path)
     -> bool;
 
+/**
+ * Performs spdlog configuration setup from a base file and any number of
+ * override files, which are merged into the base configuration values in the
+ * given order, so later override files take precedence. The base file is
+ * required while every override file is optional.
+ * @param base_toml_path Path to the base TOML configuration file path.
+ * @param override_toml_paths Paths to the override TOML configuration files,
+ * from lowest to highest precedence.
+ * @return Number of override files that were present and used.
+ * @throw setup_error
+ */
+auto from_file_and_overrides(
+    const std::string &base_toml_path,
+    const std::vector<std::string> &override_toml_paths) -> size_t;
+
+/**
+ * Performs spdlog configuration setup from file, reusing the binary snapshot
+ * at "<toml_path>.snapshot" if the file has not changed since the snapshot was
+ * made, which skips the TOML parsing entirely. Otherwise the file is parsed
+ * and the snapshot is (re)written on a best-effort basis.
+ * @param toml_path Path to the TOML configuration file path.
+ * @throw setup_error
+ */
+void from_file_with_snapshot(const std::string &toml_path);
+
+/**
+ * Performs spdlog configuration setup from both base and override files, with
+ * the same snapshot behaviour as from_file_with_snapshot. The merged
+ * configuration is snapshotted at "<base_toml_path>.snapshot", and is only
+ * reused if neither file has changed, been created or removed since.
+ * @param base_toml_path Path to the base TOML configuration file path.
+ * @param override_toml_path Path to the override TOML configuration file path.
+ * @return true if override file is used, otherwise false.
+ * @throw setup_error
+ */
+auto from_file_and_override_with_snapshot(
+    const std::string &base_toml_path, const std::string &override_toml_path)
+    -> bool;
+
+/**
+ * Performs spdlog configuration setup from configuration embedded at build
+ * time by spdlog_setup_embed, without any TOML parsing or file access.
+ * Normally called through the generated setup_embedded().
+ * @param nodes Start of the embedded configuration nodes.
+ * @param count Number of embedded configuration nodes.
+ * @throw setup_error
+ */
+void from_embedded(const details::embedded_node *nodes, const size_t count);
+
+/**
+ * Performs spdlog configuration setup from configuration embedded at build
+ * time by spdlog_setup_embed, with the override file merged on top if present.
+ * Normally called through the generated setup_embedded(override_toml_path).
+ * @param nodes Start of the embedded configuration nodes.
+ * @param count Number of embedded configuration nodes.
+ * @param override_toml_path Path to the override TOML configuration file path.
+ * @return true if override file is used, otherwise false.
+ * @throw setup_error
+ */
+auto from_embedded_and_override(
+    const details::embedded_node *nodes,
+    const size_t count,
+    const std::string &override_toml_path) -> bool;
+
+/**
+ * Reconfigures spdlog from file, diffing it against the configuration that is
+ * currently applied. Unchanged sinks, thread pools and loggers are kept, so
+ * that their files stay open and queued messages are not lost, and only their
+ * levels, flush levels and patterns are updated in place. Changed entities
+ * are rebuilt, and loggers no longer configured are dropped. On error, the
+ * currently applied configuration remains in place.
+ * @param toml_path Path to the TOML configuration file path.
+ * @throw setup_error
+ */
+void reconfigure_from_file(const std::string &toml_path);
+
+/**
+ * Reconfigures spdlog from both base and override files, with the same
+ * behaviour as reconfigure_from_file.
+ * @param base_toml_path Path to the base TOML configuration file path.
+ * @param override_toml_path Path to the override TOML configuration file path.
+ * @return true if override file is used, otherwise false.
+ * @throw setup_error
+ */
+auto reconfigure_from_file_and_override(
+    const std::string &base_toml_path, const std::string &override_toml_path)
+    -> bool;
+
+/**
+ * Watches the base and override files on a background thread, and
+ * reconfigures spdlog as with reconfigure_from_file_and_override whenever
+ * either file changes, after waiting for the changes to settle. The
+ * configuration should already have been set up before watching. Loggers
+ * are never locked while reloading, and a failed reload leaves the previous
+ * configuration in place and is reported through the options.
+ * @param base_toml_path Path to the base TOML configuration file path.
+ * @param override_toml_path Path to the override TOML configuration file path,
+ * which does not need to exist.
+ * @param options Options for watching.
+ * @return Handle that stops watching when destroyed.
+ * @throw setup_error
+ */
+auto watch(
+    const std::string &base_toml_path,
+    const std::string &override_toml_path,
+    watch_options options = watch_options()) -> watcher;
+
+/**
+ * Looks up the logger of the given name, which is built on this first request
+ * if the configuration applied sets lazy_loggers, together with the sinks and
+ * thread pool it uses that are not built yet. Loggers that were never
+ * requested are not registered into spdlog, so spdlog::get does not find
+ * them.
+ * @param name Name of the logger.
+ * @return Logger of the given name, nullptr if not registered nor
+ * configured.
+ * @throw setup_error
+ */
+auto get(const std::string &name) -> std::shared_ptr<spdlog::logger>;
+
+/**
+ * Returns the counts of the messages the registered logger of the given name
+ * dropped so far due to its overflow policy, which are only kept for async
+ * loggers on thread pools with queue = "lockfree", and are all zero for the
+ * other loggers.
+ * @param logger_name Name of the logger.
+ * @return Counts of dropped messages.
+ * @throw setup_error
+ */
+auto get_dropped_messages(const std::string &logger_name) -> dropped_messages;
+
+/**
+ * Takes a snapshot of the thread pools, loggers and sinks built from the
+ * configuration currently applied, together with the global thread pool.
+ * Counters are read as they are, so they may be a little behind the messages
+ * being logged concurrently, while logging is never blocked by the snapshot.
+ * @return Snapshot of the thread pools, loggers and sinks.
+ */
+auto stats() -> setup_stats;
+
+/**
+ * Shuts down logging gracefully before the deadline. Stops every logger from
+ * accepting messages and stops the periodic flushes, then waits for the
+ * global thread pool and the thread pools built from the configuration
+ * currently applied to write out their queued messages, all draining at the
+ * same time, and finally flushes every configured sink. Messages still queued
+ * once the deadline runs out are discarded by thread pools with
+ * queue = "lockfree", and are reported as dropped.
+ * @param deadline Time by which to give up waiting.
+ * @return Report of what was drained, flushed and dropped.
+ */
+auto shutdown(const std::chrono::steady_clock::time_point deadline)
+    -> shutdown_report;
+
 /**
  * Serializes the current logger level tagged with its logger name, and saves
  * into the a file. Currently only able to save the logger name and level.
@@ -77,6 +260,18 @@ void save_logger_to_file(
     const std::string &toml_path,
     const bool overwrite = false);
 
+/**
+ * Serializes the current levels of all loggers registered in spdlog, and
+ * saves them into the file in a single write, as with save_logger_to_file.
+ * For other batches of edits, use override_transaction.
+ * @param toml_path Path to save the serialized content into.
+ * @param overwrite Default false to add content into override file, true to
+ * ignore the existing file if present, and overwrite the file.
+ * @throw setup_error
+ */
+void save_loggers_to_file(
+    const std::string &toml_path, const bool overwrite = false);
+
 /**
  * Resets the given logger back to its base configuration from file, while
  * removing the entry in the override file. Throws exception if the base file
@@ -99,16 +294,16 @@ void from_file_with_tag_replacement(
     // std
     using std::exception;
     using std::forward;
-    using std::stringstream;
+    using std::string;
 
     try {
-        stringstream toml_ss;
+        string toml_buffer;
 
-        details::read_template_file_into_stringstream(
-            toml_ss, pre_toml_path, forward<Ps>(ps)...);
+        details::render_template_file(
+            toml_buffer, pre_toml_path, forward<Ps>(ps)...);
 
-        cpptoml::parser parser(toml_ss);
-        const auto config = parser.parse();
+        const auto config =
+            details::parse_toml(toml_buffer.data(), toml_buffer.size());
 
         details::setup(config);
     } catch (const setup_error &) {
@@ -126,19 +321,17 @@ auto from_file_and_override_with_tag_replacement(
 
     // std
     using std::exception;
-    using std::forward;
     using std::ifstream;
-    using std::move;
-    using std::stringstream;
+    using std::string;
 
     try {
-        stringstream base_toml_ss;
+        // shared by both files, since each is parsed before the next render
+        string toml_buffer;
 
-        details::read_template_file_into_stringstream(
-            base_toml_ss, base_pre_toml_path, ps...);
+        details::render_template_file(toml_buffer, base_pre_toml_path, ps...);
 
-        cpptoml::parser base_parser(base_toml_ss);
-        const auto merged_config = base_parser.parse();
+        const auto merged_config =
+            details::parse_toml(toml_buffer.data(), toml_buffer.size());
 
         const auto has_override = [&override_pre_toml_path] {
             ifstream istr(override_pre_toml_path);
@@ -146,13 +339,11 @@ auto from_file_and_override_with_tag_replacement(
         }();
 
         if (has_override) {
-            stringstream override_toml_ss;
-
-            details::read_template_file_into_stringstream(
-                override_toml_ss, override_pre_toml_path, ps...);
+            details::render_template_file(
+                toml_buffer, override_pre_toml_path, ps...);
 
-            cpptoml::parser override_parser(override_toml_ss);
-            const auto override_config = override_parser.parse();
+            const auto override_config =
+                details::parse_toml(toml_buffer.data(), toml_buffer.size());
 
             // merged_config is interior mutated
             details::merge_config_root(merged_config, override_config);
@@ -167,13 +358,55 @@ auto from_file_and_override_with_tag_replacement(
     }
 }
 
+inline auto compile_template_file(const std::string &pre_toml_path)
+    -> compiled_template {
+
+    // std
+    using std::exception;
+    using std::string;
+
+    try {
+        const details::mapped_file pre_toml_file(pre_toml_path);
+
+        return compiled_template(
+            string(pre_toml_file.data(), pre_toml_file.size()));
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline void from_file_with_tag_replacement(
+    const compiled_template &pre_toml,
+    const std::unordered_map<std::string, std::string> &tags) {
+
+    // std
+    using std::exception;
+    using std::string;
+
+    try {
+        string toml_buffer;
+        pre_toml.render_into(toml_buffer, tags);
+
+        const auto config =
+            details::parse_toml(toml_buffer.data(), toml_buffer.size());
+
+        details::setup(config);
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
 inline void from_file(const std::string &toml_path) {
     // std
     using std::exception;
     using std::string;
 
     try {
-        const auto config = cpptoml::parse_file(toml_path);
+        const auto config = details::parse_toml_file(toml_path);
         details::setup(config);
     } catch (const exception &e) {
         throw setup_error(e.what());
@@ -190,7 +423,7 @@ inline auto from_file_and_override(
     using std::string;
 
     try {
-        const auto merged_config = cpptoml::parse_file(base_toml_path);
+        const auto merged_config = details::parse_toml_file(base_toml_path);
 
         const auto has_override = [&override_toml_path] {
             ifstream istr(override_toml_path);
@@ -199,7 +432,7 @@ inline auto from_file_and_override(
 
         if (has_override) {
             const auto override_config =
-                cpptoml::parse_file(override_toml_path);
+                details::parse_toml_file(override_toml_path);
 
             // merged_config is interior mutated
             details::merge_config_root(merged_config, override_config);
@@ -212,79 +445,344 @@ inline auto from_file_and_override(
     }
 }
 
-inline void save_logger_to_file(
-    const std::shared_ptr<spdlog::logger> &logger,
-    const std::string &toml_path,
-    const bool overwrite) {
+inline auto from_file_and_overrides(
+    const std::string &base_toml_path,
+    const std::vector<std::string> &override_toml_paths) -> size_t {
 
-    using details::find_item_by_name;
-    using details::level_to_str;
-    using details::write_to_config_file;
-    using details::names::LEVEL;
-    using details::names::LOGGER_TABLE;
-    using details::names::NAME;
+    // std
+    using std::exception;
+    using std::ifstream;
+    using std::shared_ptr;
+    using std::vector;
 
-    // fmt
-    using fmt::format;
+    try {
+        const auto merged_config = details::parse_toml_file(base_toml_path);
+
+        vector<shared_ptr<cpptoml::table>> override_configs;
+        override_configs.reserve(override_toml_paths.size());
+
+        for (const auto &override_toml_path : override_toml_paths) {
+            const auto has_override = [&override_toml_path] {
+                ifstream istr(override_toml_path);
+                return static_cast<bool>(istr);
+            }();
+
+            if (has_override) {
+                override_configs.push_back(
+                    details::parse_toml_file(override_toml_path));
+            }
+        }
+
+        // merged_config is interior mutated
+        details::merge_config_layers(merged_config, override_configs);
+
+        details::setup(merged_config);
+        return override_configs.size();
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline void from_file_with_snapshot(const std::string &toml_path) {
+    // std
+    using std::exception;
+    using std::vector;
+
+    try {
+        const auto snapshot_path = details::snapshot_path_for(toml_path);
+        const auto source_paths = std::vector<std::string>{toml_path};
+
+        auto config = details::load_snapshot(snapshot_path, source_paths);
+
+        if (!config) {
+            vector<details::snapshot_source> sources(1);
+            config = details::parse_snapshot_source(toml_path, sources[0]);
+            details::save_snapshot(snapshot_path, sources, *config);
+        }
+
+        details::setup(config);
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline auto from_file_and_override_with_snapshot(
+    const std::string &base_toml_path, const std::string &override_toml_path)
+    -> bool {
 
     // std
     using std::exception;
-    using std::find_if;
-    using std::shared_ptr;
     using std::string;
+    using std::vector;
 
     try {
-        const auto config = ([overwrite, &toml_path] {
-            if (overwrite) {
-                return cpptoml::make_table();
+        const auto snapshot_path = details::snapshot_path_for(base_toml_path);
+        const auto source_paths =
+            vector<string>{base_toml_path, override_toml_path};
+
+        const auto has_override = details::file_exists(override_toml_path);
+        auto merged_config =
+            details::load_snapshot(snapshot_path, source_paths);
+
+        if (!merged_config) {
+            vector<details::snapshot_source> sources(2);
+
+            merged_config =
+                details::parse_snapshot_source(base_toml_path, sources[0]);
+
+            if (has_override) {
+                const auto override_config = details::parse_snapshot_source(
+                    override_toml_path, sources[1]);
+
+                // merged_config is interior mutated
+                details::merge_config_root(merged_config, override_config);
             } else {
-                return cpptoml::parse_file(toml_path);
+                sources[1] =
+                    details::missing_snapshot_source(override_toml_path);
             }
-        })();
 
-        if (!config) {
-            throw setup_error(
-                format("Unable to parse file at '{}' for saving", toml_path));
+            details::save_snapshot(snapshot_path, sources, *merged_config);
         }
 
-        auto &config_ref = *config;
+        details::setup(merged_config);
+        return has_override;
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
 
-        const auto curr_loggers = ([&config_ref] {
-            const auto curr_loggers = config_ref.get_table_array(LOGGER_TABLE);
+inline void from_embedded(
+    const details::embedded_node *nodes, const size_t count) {
 
-            if (curr_loggers) {
-                return curr_loggers;
-            } else {
-                const auto new_loggers = cpptoml::make_table_array();
-                config_ref.insert(LOGGER_TABLE, new_loggers);
-                return new_loggers;
+    // std
+    using std::exception;
+
+    try {
+        details::setup(details::table_from_embedded(nodes, count));
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline auto from_embedded_and_override(
+    const details::embedded_node *nodes,
+    const size_t count,
+    const std::string &override_toml_path) -> bool {
+
+    // std
+    using std::exception;
+
+    try {
+        const auto merged_config = details::table_from_embedded(nodes, count);
+        const auto has_override = details::file_exists(override_toml_path);
+
+        if (has_override) {
+            const auto override_config =
+                details::parse_toml_file(override_toml_path);
+
+            // merged_config is interior mutated
+            details::merge_config_root(merged_config, override_config);
+        }
+
+        details::setup(merged_config);
+        return has_override;
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline void reconfigure_from_file(const std::string &toml_path) {
+    // std
+    using std::exception;
+
+    try {
+        details::reconfigure(details::parse_toml_file(toml_path));
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline auto reconfigure_from_file_and_override(
+    const std::string &base_toml_path, const std::string &override_toml_path)
+    -> bool {
+
+    // std
+    using std::exception;
+
+    try {
+        const auto merged_config = details::parse_toml_file(base_toml_path);
+        const auto has_override = details::file_exists(override_toml_path);
+
+        if (has_override) {
+            const auto override_config =
+                details::parse_toml_file(override_toml_path);
+
+            // merged_config is interior mutated
+            details::merge_config_root(merged_config, override_config);
+        }
+
+        details::reconfigure(merged_config);
+        return has_override;
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline auto watch(
+    const std::string &base_toml_path,
+    const std::string &override_toml_path,
+    watch_options options) -> watcher {
+    return watcher(base_toml_path, override_toml_path, std::move(options));
+}
+
+inline auto get(const std::string &name) -> std::shared_ptr<spdlog::logger> {
+    // std
+    using std::exception;
+
+    // registered loggers are found without taking the configuration lock
+    if (const auto logger = spdlog::get(name)) {
+        return logger;
+    }
+
+    try {
+        return details::setup_lazy_logger(name);
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
+
+inline auto get_dropped_messages(const std::string &logger_name)
+    -> dropped_messages {
+
+    const auto logger = spdlog::get(logger_name);
+
+    if (!logger) {
+        throw setup_error(
+            fmt::format("Unable to find logger '{}'", logger_name));
+    }
+
+    return details::dropped_messages_of(logger);
+}
+
+inline auto stats() -> setup_stats {
+    // std
+    using std::sort;
+
+    setup_stats snapshot;
+
+    {
+        std::lock_guard<std::mutex> lock(details::applied_config_mutex());
+        const auto &state = details::applied_config_state();
+
+        for (const auto &pool_pair : state.thread_pools_map) {
+            snapshot.thread_pools.push_back(details::thread_pool_stats_of(
+                pool_pair.first, pool_pair.second));
+        }
+
+        for (const auto &logger_pair : state.loggers_map) {
+            if (const auto logger = logger_pair.second.lock()) {
+                logger_stats entry;
+                entry.name = logger_pair.first;
+                entry.dropped = details::dropped_messages_of(logger);
+                snapshot.loggers.push_back(std::move(entry));
+            }
+        }
+
+        for (const auto &sink_pair : state.sinks_map) {
+            const auto sink = sink_pair.second.lock();
+            const auto counters =
+                sink ? details::find_sink_counters(sink) : nullptr;
+
+            if (counters) {
+                sink_stats entry;
+                entry.name = sink_pair.first;
+                entry.messages =
+                    counters->messages.load(std::memory_order_relaxed);
+                entry.bytes = counters->bytes.load(std::memory_order_relaxed);
+                snapshot.sinks.push_back(std::move(entry));
             }
-        })();
+        }
+    }
 
-        auto &curr_loggers_ref = *curr_loggers;
+    if (const auto global_thread_pool = spdlog::thread_pool()) {
+        snapshot.thread_pools.push_back(
+            details::thread_pool_stats_of(std::string(), global_thread_pool));
+    }
+
+    sort(
+        snapshot.thread_pools.begin(),
+        snapshot.thread_pools.end(),
+        [](const thread_pool_stats &lhs, const thread_pool_stats &rhs) {
+            return lhs.name < rhs.name;
+        });
+
+    sort(
+        snapshot.loggers.begin(),
+        snapshot.loggers.end(),
+        [](const logger_stats &lhs, const logger_stats &rhs) {
+            return lhs.name < rhs.name;
+        });
+
+    sort(
+        snapshot.sinks.begin(),
+        snapshot.sinks.end(),
+        [](const sink_stats &lhs, const sink_stats &rhs) {
+            return lhs.name < rhs.name;
+        });
+
+    return snapshot;
+}
 
-        const auto found_curr_logger =
-            find_item_by_name(curr_loggers_ref, logger->name());
+inline auto shutdown(const std::chrono::steady_clock::time_point deadline)
+    -> shutdown_report {
 
-        const auto curr_logger =
-            ([&found_curr_logger, &curr_loggers_ref, &logger] {
-                if (found_curr_logger) {
-                    return found_curr_logger;
-                } else {
-                    const auto new_curr_logger = cpptoml::make_table();
-                    new_curr_logger->insert(NAME, logger->name());
+    return details::shutdown(deadline);
+}
+
+inline void save_logger_to_file(
+    const std::shared_ptr<spdlog::logger> &logger,
+    const std::string &toml_path,
+    const bool overwrite) {
+
+    // std
+    using std::exception;
 
-                    curr_loggers_ref.insert(
-                        curr_loggers_ref.end(), new_curr_logger);
+    try {
+        override_transaction transaction(toml_path, overwrite);
+        transaction.save_logger(logger);
+        transaction.commit();
+    } catch (const setup_error &) {
+        throw;
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
 
-                    return new_curr_logger;
-                }
-            }());
+inline void
+save_loggers_to_file(const std::string &toml_path, const bool overwrite) {
+    // std
+    using std::exception;
 
-        // insert can overwrite the value
-        auto &curr_logger_ref = *curr_logger;
-        curr_logger_ref.insert(LEVEL, level_to_str(logger->level()));
-        write_to_config_file(*config, toml_path);
+    try {
+        override_transaction transaction(toml_path, overwrite);
+        transaction.save_registered_loggers();
+        transaction.commit();
     } catch (const setup_error &) {
         throw;
     } catch (const exception &e) {
@@ -295,52 +793,28 @@ inline void save_logger_to_file(
 inline auto delete_logger_in_file(
     const std::string &logger_name, const std::string &toml_path) -> bool {
 
-    using details::find_item_iter_by_name;
-    using details::level_to_str;
-    using details::write_to_config_file;
-    using details::names::LEVEL;
     using details::names::LOGGER_TABLE;
-    using details::names::NAME;
 
     // fmt
     using fmt::format;
 
     // std
     using std::exception;
-    using std::find_if;
-    using std::shared_ptr;
-    using std::string;
 
     try {
-        const auto config = cpptoml::parse_file(toml_path);
+        override_transaction transaction(toml_path);
 
-        if (!config) {
-            throw setup_error(format(
-                "Unable to parse file at '{}' for deleting logger '{}'",
-                toml_path,
-                logger_name));
-        }
-
-        const auto &config_ref = *config;
-        const auto curr_loggers = config_ref.get_table_array(LOGGER_TABLE);
-
-        if (!curr_loggers) {
+        if (!transaction.config().get_table_array(LOGGER_TABLE)) {
             throw setup_error(format(
                 "Unable to find any logger table array for file at '{}'",
                 toml_path));
         }
 
-        auto &curr_loggers_ref = *curr_loggers;
-
-        const auto found_curr_logger_it =
-            find_item_iter_by_name(curr_loggers_ref, logger_name);
-
-        if (found_curr_logger_it == curr_loggers_ref.end()) {
+        if (!transaction.delete_logger(logger_name)) {
             return false;
         }
 
-        curr_loggers_ref.erase(found_curr_logger_it);
-        write_to_config_file(*config, toml_path);
+        transaction.commit();
         return true;
     } catch (const setup_error &) {
         throw;
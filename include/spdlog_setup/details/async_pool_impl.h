@@ -0,0 +1,1919 @@
+/**
+ * Implementation of thread pools with queues managed by spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "spdlog/async.h"
+#include "spdlog/async_logger.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/sinks/base_sink.h"
+#include "spdlog/spdlog.h"
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+#include <immintrin.h>
+#endif
+
+// queued messages can only own their payload from spdlog v1.5.0 onwards
+#if defined(SPDLOG_VERSION) && SPDLOG_VERSION >= 10500
+#define SPDLOG_SETUP_MANAGED_THREAD_POOL
+#include "spdlog/details/log_msg_buffer.h"
+#endif
+
+namespace spdlog_setup {
+// declaration section
+
+/**
+ * Counts of the messages an async logger dropped instead of queueing them, by
+ * the overflow policy that dropped them. Only loggers on thread pools with
+ * queue = "lockfree" keep these counts.
+ */
+struct dropped_messages {
+    /** Discarded to make room for newer messages under overrun_oldest */
+    uint64_t overrun = 0;
+
+    /** Discarded while the queue was full under discard_new */
+    uint64_t discarded = 0;
+
+    /** Discarded once the timeout ran out under block_with_timeout */
+    uint64_t timed_out = 0;
+
+    /**
+     * Discarded for being below the level while the queue was under pressure
+     * under drop_below_level
+     */
+    uint64_t below_level = 0;
+};
+
+/**
+ * Bucket of a latency histogram, counting the latencies from the upper bound
+ * of the previous bucket up to before its own upper bound.
+ */
+struct latency_bucket {
+    /** Latencies counted are below this, which is the maximum for the last */
+    std::chrono::nanoseconds upper_bound;
+
+    /** Number of latencies in the bucket */
+    uint64_t count = 0;
+};
+
+namespace details {
+/**
+ * Describes what async loggers do when the queue of their thread pool is
+ * full.
+ */
+enum class overflow_policy {
+    /** Wait for room in the queue */
+    Block,
+
+    /** Discard the oldest queued message to make room */
+    OverrunOldest,
+
+    /** Discard the new message */
+    DiscardNew,
+
+    /** Wait for room in the queue, but discard the message after a timeout */
+    BlockWithTimeout,
+
+    /**
+     * Discard new messages below a level once the queue is three quarters
+     * full, and wait for room for the rest
+     */
+    DropBelowLevel,
+};
+
+/**
+ * Describes the overflow policy of an async logger, with its parameters.
+ */
+struct overflow_handling {
+    overflow_policy policy = overflow_policy::Block;
+
+    /** Longest wait for room under BlockWithTimeout */
+    std::chrono::microseconds timeout = std::chrono::microseconds(0);
+
+    /** Lowest level that is kept under pressure under DropBelowLevel */
+    spdlog::level::level_enum level = spdlog::level::warn;
+};
+
+/**
+ * Describes how idle workers wait for messages.
+ */
+enum class wait_strategy {
+    /** Sleep on a condition variable until a producer wakes them up */
+    Block,
+
+    /** Keep polling the queues, yielding to other threads in between */
+    Yield,
+
+    /** Keep polling the queues in a busy loop, taking up a whole core */
+    Spin,
+
+    /** Keep polling the queues in a busy loop for a while before sleeping */
+    SpinThenBlock,
+};
+
+/**
+ * Describes how the workers of a managed_thread_pool take messages.
+ */
+struct managed_pool_options {
+    /** How idle workers wait for messages */
+    wait_strategy wait = wait_strategy::Block;
+
+    /**
+     * Longest time an idle worker keeps polling before sleeping under
+     * SpinThenBlock
+     */
+    std::chrono::microseconds spin_budget = std::chrono::microseconds(100);
+
+    /**
+     * Maximum number of messages a worker takes at a time, where consecutive
+     * messages of the same logger are written into each sink under a single
+     * lock of the sink, and flushed at most once
+     */
+    size_t batch_size = 1;
+
+    /**
+     * Longest time a worker waits for more messages to fill up a batch after
+     * taking the first one, zero to only take the messages already queued
+     */
+    std::chrono::microseconds max_batch_latency = std::chrono::microseconds(0);
+
+    /**
+     * Whether to give each worker its own queue, with each logger pinned to
+     * one of the queues by the hash of its name. A queue is only taken from
+     * by one worker at a time, where idle workers take over the queues of
+     * busy ones, so that each logger keeps its order across workers.
+     */
+    bool sharded = false;
+};
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+/**
+ * Hints the CPU that the calling thread is busy polling, which frees up
+ * resources for the sibling hyper-thread and saves power while spinning.
+ */
+void cpu_relax() noexcept;
+
+/**
+ * Bounded multi-producer multi-consumer ring buffer, where each slot carries a
+ * sequence number, so that producers and consumers only contend on a single
+ * atomic position each instead of a mutex.
+ */
+template <class T> class lockfree_ring {
+  public:
+    /**
+     * Constructs the ring.
+     * @param capacity Maximum number of items, at least 1.
+     */
+    explicit lockfree_ring(const size_t capacity);
+
+    lockfree_ring(const lockfree_ring &) = delete;
+    auto operator=(const lockfree_ring &) -> lockfree_ring & = delete;
+
+    /**
+     * Moves the item into the ring if not full.
+     * @param item Item, which is left untouched if the ring is full.
+     * @return true if pushed, false if the ring is full.
+     */
+    auto try_push(T &item) -> bool;
+
+    /**
+     * Moves the oldest item out of the ring if not empty.
+     * @param item Receives the item.
+     * @return true if popped, false if the ring is empty.
+     */
+    auto try_pop(T &item) -> bool;
+
+    /**
+     * Returns the number of items, which may already be outdated when
+     * returned while other threads push or pop.
+     * @return Approximate number of items.
+     */
+    auto size_approx() const noexcept -> size_t;
+
+    /**
+     * Returns the maximum number of items.
+     * @return Capacity of the ring.
+     */
+    auto capacity() const noexcept -> size_t;
+
+  private:
+    struct slot {
+        std::atomic<size_t> sequence;
+        T item;
+    };
+
+    // keeps the positions on separate cache lines
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    const size_t slots_size;
+    const std::unique_ptr<slot[]> slots;
+
+    char padding_before_push[CACHE_LINE_SIZE];
+    std::atomic<size_t> push_pos;
+    char padding_before_pop[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+    std::atomic<size_t> pop_pos;
+    char padding_after_pop[CACHE_LINE_SIZE - sizeof(std::atomic<size_t>)];
+};
+
+/**
+ * Bounded single-producer single-consumer ring buffer, where the producer and
+ * the consumer each own a position and only read the position of the other
+ * when their cached copy of it runs out, so that both sides are wait-free.
+ */
+template <class T> class spsc_ring {
+  public:
+    /**
+     * Constructs the ring.
+     * @param capacity Maximum number of items, at least 1.
+     */
+    explicit spsc_ring(const size_t capacity);
+
+    spsc_ring(const spsc_ring &) = delete;
+    auto operator=(const spsc_ring &) -> spsc_ring & = delete;
+
+    /**
+     * Moves the item into the ring if not full, only from the producer.
+     * @param item Item, which is left untouched if the ring is full.
+     * @return true if pushed, false if the ring is full.
+     */
+    auto try_push(T &item) -> bool;
+
+    /**
+     * Moves the oldest item out of the ring if not empty, only from the
+     * consumer.
+     * @param item Receives the item.
+     * @return true if popped, false if the ring is empty.
+     */
+    auto try_pop(T &item) -> bool;
+
+    /**
+     * Returns the number of items pushed so far, as seen by the consumer.
+     * @return Number of pushed items.
+     */
+    auto pushed_count() const noexcept -> size_t;
+
+    /**
+     * Returns the number of items popped so far, only from the consumer.
+     * @return Number of popped items.
+     */
+    auto popped_count() const noexcept -> size_t;
+
+    /**
+     * Returns the number of items, which may already be outdated when
+     * returned while the producer pushes or the consumer pops.
+     * @return Approximate number of items.
+     */
+    auto size_approx() const noexcept -> size_t;
+
+    /**
+     * Returns the maximum number of items.
+     * @return Capacity of the ring.
+     */
+    auto capacity() const noexcept -> size_t;
+
+  private:
+    // keeps the positions on separate cache lines
+    static constexpr size_t CACHE_LINE_SIZE = 64;
+
+    const size_t slots_size;
+    const std::unique_ptr<T[]> slots;
+
+    char padding_before_push[CACHE_LINE_SIZE];
+    std::atomic<size_t> push_pos;
+    size_t cached_pop_pos;
+
+    char padding_before_pop
+        [CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+
+    std::atomic<size_t> pop_pos;
+    size_t cached_push_pos;
+
+    char padding_after_pop
+        [CACHE_LINE_SIZE - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+};
+
+/**
+ * Condition that threads can wait on, which only costs notifiers a fence when
+ * nobody is waiting.
+ */
+class wait_event {
+  public:
+    /**
+     * Blocks until the check succeeds, which is retried whenever notified.
+     * @param check Returns true once done waiting.
+     */
+    template <class Check> void wait(Check &&check);
+
+    /**
+     * Blocks until the check succeeds, or the timeout runs out.
+     * @param timeout Longest time to wait.
+     * @param check Returns true once done waiting.
+     * @return true if the check succeeded, false if timed out.
+     */
+    template <class Rep, class Period, class Check>
+    auto wait_for(
+        const std::chrono::duration<Rep, Period> &timeout, Check &&check)
+        -> bool;
+
+    /**
+     * Wakes up one waiting thread, if any.
+     */
+    void notify_one();
+
+    /**
+     * Wakes up all waiting threads.
+     */
+    void notify_all();
+
+  private:
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<size_t> waiters{0};
+};
+
+class managed_async_logger;
+
+/**
+ * Describes the counters behind dropped_messages, which producers and workers
+ * update concurrently.
+ */
+struct drop_counters {
+    std::atomic<uint64_t> overrun{0};
+    std::atomic<uint64_t> discarded{0};
+    std::atomic<uint64_t> timed_out{0};
+    std::atomic<uint64_t> below_level{0};
+};
+
+/**
+ * Histogram of latencies with buckets doubling in width, which threads record
+ * into concurrently without locking.
+ */
+class latency_histogram {
+  public:
+    /** Number of buckets, where the last one counts all longer latencies */
+    static constexpr size_t BUCKETS_COUNT = 16;
+
+    /** Upper bound of the first bucket, in nanoseconds */
+    static constexpr int64_t FIRST_UPPER_BOUND_NS = 128;
+
+    /**
+     * Counts the latency into its bucket.
+     * @param latency Latency to count.
+     */
+    void record(const std::chrono::nanoseconds latency) noexcept;
+
+    /**
+     * Returns the counts of every bucket so far.
+     * @return Buckets in increasing order of latency.
+     */
+    auto snapshot() const -> std::vector<latency_bucket>;
+
+  private:
+    std::atomic<uint64_t> counts[BUCKETS_COUNT] = {};
+};
+
+/**
+ * Describes a message queued into a managed_thread_pool.
+ */
+struct managed_msg {
+    enum class msg_type {
+        /** Write buffer into the sinks of logger */
+        Log,
+
+        /** Flush the sinks of logger */
+        Flush,
+    };
+
+    msg_type type = msg_type::Log;
+    std::shared_ptr<managed_async_logger> logger;
+    spdlog::details::log_msg_buffer buffer;
+};
+
+/**
+ * Describes a queue of a managed_thread_pool.
+ */
+struct managed_shard {
+    explicit managed_shard(const size_t queue_size) : queue(queue_size) {}
+
+    lockfree_ring<managed_msg> queue;
+
+    /** Whether a worker is taking from the queue, only used when sharded */
+    std::atomic<bool> claimed{false};
+};
+
+/**
+ * Describes the private queue of a logger with queue = "spsc", which only the
+ * thread writing into the logger pushes into, while the workers of the pool
+ * take turns as its single consumer by claiming it.
+ */
+struct managed_spsc_queue {
+    explicit managed_spsc_queue(const size_t queue_size) : queue(queue_size) {}
+
+#ifndef NDEBUG
+    /**
+     * Records the calling thread as the producer on the first call.
+     * @return false if another thread was recorded as the producer.
+     */
+    auto claim_producer() noexcept -> bool;
+#endif
+
+    spsc_ring<managed_msg> queue;
+
+    /** Whether a worker is taking from the queue */
+    std::atomic<bool> claimed{false};
+
+    /** Whether a flush was requested since a worker last looked */
+    std::atomic<bool> flush_requested{false};
+
+    /** Attaches the queue to its pool on first use */
+    std::once_flag attached;
+
+    /** Logger owning the queue, set once attached */
+    std::weak_ptr<managed_async_logger> logger;
+
+    /** Whether a flush is due, only used by the claiming worker */
+    bool flush_pending = false;
+
+    /** Number of pushed messages to write before the flush is due */
+    size_t flush_target = 0;
+
+#ifndef NDEBUG
+    std::atomic<std::thread::id> producer{std::thread::id()};
+#endif
+};
+
+/**
+ * Describes the state of a worker of a managed_thread_pool.
+ */
+struct managed_worker {
+    explicit managed_worker(const size_t index) : index(index) {}
+
+    /** Index of the worker, which picks its own queue when sharded */
+    const size_t index;
+
+    /** Shared queue the current batch came from, if any */
+    managed_shard *shard = nullptr;
+
+    /** Private queue of a logger the current batch came from, if any */
+    managed_spsc_queue *spsc = nullptr;
+
+    /** Copy of the private queues attached to the pool */
+    std::vector<std::shared_ptr<managed_spsc_queue>> spsc_queues;
+
+    /** Version of the private queues attached when copied */
+    size_t spsc_version = 0;
+
+    /** Private queue to start looking from next */
+    size_t spsc_cursor = 0;
+
+    /** Whether the private queues are looked at before the shared ones */
+    bool spsc_first = false;
+};
+
+/**
+ * Thread pool with its own queues and workers, for async loggers built as
+ * managed_async_logger. The inherited spdlog thread pool still serves async
+ * loggers created through spdlog itself when this is the global thread pool.
+ */
+class managed_thread_pool : public spdlog::details::thread_pool {
+    friend class managed_async_logger;
+
+  public:
+    /**
+     * Constructs the pool and starts its workers.
+     * @param queue_size Maximum number of queued messages, of each worker
+     * when sharded.
+     * @param num_threads Number of worker threads.
+     * @param options How the workers take messages.
+     * @param fallback_queue_size Maximum number of queued messages of the
+     * inherited spdlog thread pool, which has a single worker.
+     * @param on_thread_start Called by each worker as it starts, including
+     * the worker of the inherited spdlog thread pool, may be empty.
+     */
+    managed_thread_pool(
+        const size_t queue_size,
+        const size_t num_threads,
+        const managed_pool_options &options,
+        const size_t fallback_queue_size,
+        std::function<void()> on_thread_start);
+
+    managed_thread_pool(const managed_thread_pool &) = delete;
+
+    auto operator=(const managed_thread_pool &)
+        -> managed_thread_pool & = delete;
+
+    /**
+     * Writes out every message queued so far before stopping the workers.
+     */
+    ~managed_thread_pool();
+
+    /**
+     * Queues a copy of the message for the logger.
+     * @param logger Logger whose sinks to write into.
+     * @param msg Message to write.
+     * @param overflow Policy when the queue is full, which counts dropped
+     * messages against their logger.
+     */
+    void post_log(
+        std::shared_ptr<managed_async_logger> logger,
+        const spdlog::details::log_msg &msg,
+        const overflow_handling &overflow);
+
+    /**
+     * Queues a flush of the sinks of the logger.
+     * @param logger Logger whose sinks to flush.
+     * @param overflow Policy when the queue is full.
+     */
+    void post_flush(
+        std::shared_ptr<managed_async_logger> logger,
+        const overflow_handling &overflow);
+
+    /**
+     * Returns the number of messages discarded to make room for newer ones.
+     * @return Number of overrun messages.
+     */
+    auto overruns() const noexcept -> size_t;
+
+    /**
+     * Returns the maximum number of queued messages over all the queues.
+     * @return Capacity of the queues.
+     */
+    auto queue_capacity() const noexcept -> size_t;
+
+    /**
+     * Returns the number of messages currently queued over all the queues.
+     * @return Approximate depth of the queues.
+     */
+    auto queue_depth() const noexcept -> size_t;
+
+    /**
+     * Returns the highest number of messages seen queued in any one queue.
+     * @return High-water mark of the queues.
+     */
+    auto high_water_mark() const noexcept -> size_t;
+
+    /**
+     * Returns the histogram of the time producers took to queue messages,
+     * including the time waiting for room, but not of dropped messages.
+     * @return Buckets of enqueue latencies.
+     */
+    auto enqueue_latency() const -> std::vector<latency_bucket>;
+
+    /**
+     * Stops queueing messages, where messages posted from now on are
+     * discarded and counted as rejected.
+     */
+    void close() noexcept;
+
+    /**
+     * Returns the number of messages discarded since the pool was closed.
+     * @return Number of rejected messages.
+     */
+    auto rejected() const noexcept -> size_t;
+
+    /**
+     * Makes the workers discard the messages still queued instead of writing
+     * them, so that the pool can be destroyed without waiting on its sinks.
+     */
+    void discard_queued() noexcept;
+
+    /**
+     * Checks if every queued message has been written, with no worker in the
+     * middle of writing.
+     * @return true if nothing is queued nor being written.
+     */
+    auto idle() const noexcept -> bool;
+
+    /**
+     * Blocks until the pool is idle, or the deadline runs out.
+     * @param deadline Time by which to give up waiting.
+     * @return true if nothing is queued nor being written.
+     */
+    auto wait_idle(const std::chrono::steady_clock::time_point deadline)
+        -> bool;
+
+  private:
+    void post(managed_msg &msg, const overflow_handling &overflow);
+
+    template <class Queue>
+    void post_into(
+        Queue &queue, managed_msg &msg, const overflow_handling &overflow);
+
+    void attach_spsc_queue(const std::shared_ptr<managed_async_logger> &logger);
+    void detach_spsc_queue(const managed_spsc_queue *spsc);
+    void refresh_spsc_queues(managed_worker &worker);
+
+    template <class Queue>
+    auto fill_batch(Queue &queue, std::vector<managed_msg> &batch) -> size_t;
+
+    auto try_take_shared_batch(
+        managed_worker &worker, std::vector<managed_msg> &batch) -> size_t;
+
+    auto try_take_spsc_batch(
+        managed_worker &worker, std::vector<managed_msg> &batch) -> size_t;
+
+    auto try_take_batch(
+        managed_worker &worker, std::vector<managed_msg> &batch) -> size_t;
+
+    auto take_batch(managed_worker &worker, std::vector<managed_msg> &batch)
+        -> size_t;
+
+    void flush_spsc_if_due(managed_spsc_queue &spsc);
+    void release_batch(managed_worker &worker);
+    auto has_takeable_shard(managed_worker &worker) -> bool;
+    void notify_not_empty();
+    void notify_not_full();
+    void worker_loop(const size_t worker_index);
+
+    const managed_pool_options options;
+    std::vector<std::unique_ptr<managed_shard>> shards;
+    mutable std::mutex spsc_mutex;
+    std::vector<std::shared_ptr<managed_spsc_queue>> spsc_queues;
+    std::atomic<size_t> spsc_version{0};
+    wait_event not_empty;
+    wait_event not_full;
+    wait_event idle_changed;
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> closed{false};
+    std::atomic<bool> discarding{false};
+    std::atomic<size_t> busy_workers{0};
+    std::atomic<size_t> rejected_count{0};
+    std::atomic<size_t> overrun_count{0};
+    std::atomic<size_t> high_water{0};
+    latency_histogram enqueue_latencies;
+    std::vector<std::thread> workers;
+};
+
+/**
+ * Async logger over a managed_thread_pool, which only holds a weak reference
+ * to the pool, as with spdlog async loggers.
+ */
+class managed_async_logger
+    : public spdlog::logger,
+      public std::enable_shared_from_this<managed_async_logger> {
+
+    friend class managed_thread_pool;
+
+  public:
+    /**
+     * Constructor accepting the sinks to write into on the workers.
+     * @param name Name of the logger.
+     * @param sinks Sinks of the logger.
+     * @param pool Pool to log through.
+     * @param overflow Policy when the queue of the pool is full, which cannot
+     * be overrun_oldest with a private queue.
+     * @param spsc_queue_size Maximum number of queued messages of a private
+     * queue that only a single thread may log into, zero to queue into the
+     * shared queues of the pool instead.
+     * @throw spdlog::spdlog_ex
+     */
+    managed_async_logger(
+        std::string name,
+        const std::vector<spdlog::sink_ptr> &sinks,
+        std::weak_ptr<managed_thread_pool> pool,
+        const overflow_handling &overflow,
+        const size_t spsc_queue_size = 0);
+
+    /**
+     * Copies the logger, except for its counts of dropped messages, which
+     * start from zero, and the messages in its private queue if any.
+     * @param other Logger to copy.
+     */
+    managed_async_logger(const managed_async_logger &other);
+
+    /**
+     * Detaches the private queue from the pool if any.
+     */
+    ~managed_async_logger() override;
+
+    auto clone(std::string logger_name)
+        -> std::shared_ptr<spdlog::logger> override;
+
+    /**
+     * Returns the counts of the messages this logger dropped so far.
+     * @return Counts of dropped messages.
+     */
+    auto dropped() const noexcept -> dropped_messages;
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    void backend_sink_batch_(const managed_msg *first, const managed_msg *last);
+    void backend_flush_();
+
+    std::weak_ptr<managed_thread_pool> pool;
+    overflow_handling overflow;
+    drop_counters drops;
+
+    /** Hash of the name, which picks the queue of a sharded pool */
+    size_t shard_key;
+
+    /** Private queue, nullptr if queueing into the shared queues */
+    std::shared_ptr<managed_spsc_queue> spsc;
+};
+
+/**
+ * Writes the messages into the sink under a single lock of the sink if it is a
+ * spdlog base_sink, otherwise one message at a time.
+ * @param sink Sink to write into.
+ * @param first First message to write.
+ * @param last One past the last message to write.
+ * @param on_error Called with the exception of each message failing to be
+ * written, after which the rest are still written.
+ */
+template <class OnError>
+void write_sink_batch(
+    spdlog::sinks::sink &sink,
+    const managed_msg *first,
+    const managed_msg *last,
+    OnError &&on_error);
+
+/**
+ * Returns the thread pool as a managed_thread_pool if it is one, tracked in
+ * the same way as numa_thread_pool instances.
+ * @param pool Thread pool.
+ * @return Same thread pool as a managed_thread_pool, nullptr if not one.
+ */
+auto as_managed_thread_pool(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool)
+    -> std::shared_ptr<managed_thread_pool>;
+
+// implementation section
+
+inline void cpu_relax() noexcept {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) ||             \
+    defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#endif
+}
+
+template <class T>
+lockfree_ring<T>::lockfree_ring(const size_t capacity)
+    : slots_size(capacity > 0 ? capacity : 1),
+      slots(new slot[capacity > 0 ? capacity : 1]), push_pos(0), pop_pos(0) {
+
+    for (size_t i = 0; i < slots_size; ++i) {
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <class T> auto lockfree_ring<T>::try_push(T &item) -> bool {
+    // std
+    using std::memory_order_acquire;
+    using std::memory_order_relaxed;
+    using std::memory_order_release;
+
+    auto pos = push_pos.load(memory_order_relaxed);
+
+    while (true) {
+        auto &target = slots[pos % slots_size];
+        const auto sequence = target.sequence.load(memory_order_acquire);
+        const auto diff =
+            static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+
+        if (diff == 0) {
+            if (push_pos.compare_exchange_weak(
+                    pos, pos + 1, memory_order_relaxed)) {
+
+                target.item = std::move(item);
+                target.sequence.store(pos + 1, memory_order_release);
+                return true;
+            }
+        } else if (diff < 0) {
+            // the slot still holds the item from a lap behind
+            return false;
+        } else {
+            pos = push_pos.load(memory_order_relaxed);
+        }
+    }
+}
+
+template <class T> auto lockfree_ring<T>::try_pop(T &item) -> bool {
+    // std
+    using std::memory_order_acquire;
+    using std::memory_order_relaxed;
+    using std::memory_order_release;
+
+    auto pos = pop_pos.load(memory_order_relaxed);
+
+    while (true) {
+        auto &target = slots[pos % slots_size];
+        const auto sequence = target.sequence.load(memory_order_acquire);
+        const auto diff =
+            static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+
+        if (diff == 0) {
+            if (pop_pos.compare_exchange_weak(
+                    pos, pos + 1, memory_order_relaxed)) {
+
+                item = std::move(target.item);
+
+                target.sequence.store(
+                    pos + slots_size, memory_order_release);
+
+                return true;
+            }
+        } else if (diff < 0) {
+            // the slot has not been pushed into yet
+            return false;
+        } else {
+            pos = pop_pos.load(memory_order_relaxed);
+        }
+    }
+}
+
+template <class T>
+auto lockfree_ring<T>::size_approx() const noexcept -> size_t {
+    // std
+    using std::memory_order_relaxed;
+
+    const auto pop = pop_pos.load(memory_order_relaxed);
+    const auto push = push_pos.load(memory_order_relaxed);
+
+    return push > pop ? push - pop : 0;
+}
+
+template <class T>
+auto lockfree_ring<T>::capacity() const noexcept -> size_t {
+    return slots_size;
+}
+
+template <class T>
+spsc_ring<T>::spsc_ring(const size_t capacity)
+    : slots_size(capacity > 0 ? capacity : 1),
+      slots(new T[capacity > 0 ? capacity : 1]), push_pos(0),
+      cached_pop_pos(0), pop_pos(0), cached_push_pos(0) {}
+
+template <class T> auto spsc_ring<T>::try_push(T &item) -> bool {
+    const auto pos = push_pos.load(std::memory_order_relaxed);
+
+    if (pos - cached_pop_pos >= slots_size) {
+        cached_pop_pos = pop_pos.load(std::memory_order_acquire);
+
+        if (pos - cached_pop_pos >= slots_size) {
+            return false;
+        }
+    }
+
+    slots[pos % slots_size] = std::move(item);
+    push_pos.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <class T> auto spsc_ring<T>::try_pop(T &item) -> bool {
+    const auto pos = pop_pos.load(std::memory_order_relaxed);
+
+    if (pos == cached_push_pos) {
+        cached_push_pos = push_pos.load(std::memory_order_acquire);
+
+        if (pos == cached_push_pos) {
+            return false;
+        }
+    }
+
+    item = std::move(slots[pos % slots_size]);
+    pop_pos.store(pos + 1, std::memory_order_release);
+    return true;
+}
+
+template <class T>
+auto spsc_ring<T>::pushed_count() const noexcept -> size_t {
+    return push_pos.load(std::memory_order_acquire);
+}
+
+template <class T>
+auto spsc_ring<T>::popped_count() const noexcept -> size_t {
+    return pop_pos.load(std::memory_order_relaxed);
+}
+
+template <class T>
+auto spsc_ring<T>::size_approx() const noexcept -> size_t {
+    // std
+    using std::memory_order_relaxed;
+
+    const auto pop = pop_pos.load(memory_order_relaxed);
+    const auto push = push_pos.load(memory_order_relaxed);
+
+    return push > pop ? push - pop : 0;
+}
+
+template <class T> auto spsc_ring<T>::capacity() const noexcept -> size_t {
+    return slots_size;
+}
+
+template <class Check> void wait_event::wait(Check &&check) {
+    // std
+    using std::memory_order_seq_cst;
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    // pairs with the fence in notify, so that either the check sees the
+    // change or the notifier sees this waiter
+    waiters.fetch_add(1, memory_order_seq_cst);
+    std::atomic_thread_fence(memory_order_seq_cst);
+
+    while (!check()) {
+        cv.wait(lock);
+    }
+
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+}
+
+template <class Rep, class Period, class Check>
+auto wait_event::wait_for(
+    const std::chrono::duration<Rep, Period> &timeout, Check &&check)
+    -> bool {
+
+    // std
+    using std::memory_order_seq_cst;
+    using std::chrono::steady_clock;
+
+    const auto deadline = steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(mutex);
+
+    waiters.fetch_add(1, memory_order_seq_cst);
+    std::atomic_thread_fence(memory_order_seq_cst);
+
+    auto done = check();
+
+    while (!done) {
+        const auto status = cv.wait_until(lock, deadline);
+        done = check();
+
+        if (status == std::cv_status::timeout) {
+            break;
+        }
+    }
+
+    waiters.fetch_sub(1, std::memory_order_relaxed);
+    return done;
+}
+
+inline void wait_event::notify_one() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+        // a waiter between its check and sleeping still holds the mutex
+        { std::lock_guard<std::mutex> lock(mutex); }
+        cv.notify_one();
+    }
+}
+
+inline void wait_event::notify_all() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (waiters.load(std::memory_order_relaxed) > 0) {
+        { std::lock_guard<std::mutex> lock(mutex); }
+        cv.notify_all();
+    }
+}
+
+/**
+ * Exposes the protected members of spdlog base sinks needed to write several
+ * messages under a single lock, through pointers to members formed within a
+ * derived class.
+ */
+template <class Mutex>
+struct base_sink_access : public spdlog::sinks::base_sink<Mutex> {
+    static auto mutex_of(spdlog::sinks::base_sink<Mutex> &sink) -> Mutex & {
+        return sink.*(&base_sink_access::mutex_);
+    }
+
+    static void sink_it(
+        spdlog::sinks::base_sink<Mutex> &sink,
+        const spdlog::details::log_msg &msg) {
+
+        (sink.*(&base_sink_access::sink_it_))(msg);
+    }
+};
+
+template <class Mutex, class OnError>
+auto write_base_sink_batch(
+    spdlog::sinks::sink &sink,
+    const managed_msg *first,
+    const managed_msg *last,
+    OnError &on_error) -> bool {
+
+    const auto base = dynamic_cast<spdlog::sinks::base_sink<Mutex> *>(&sink);
+
+    if (!base) {
+        return false;
+    }
+
+    std::lock_guard<Mutex> lock(base_sink_access<Mutex>::mutex_of(*base));
+
+    for (auto msg = first; msg != last; ++msg) {
+        if (sink.should_log(msg->buffer.level)) {
+            try {
+                base_sink_access<Mutex>::sink_it(*base, msg->buffer);
+            } catch (...) {
+                on_error(std::current_exception());
+            }
+        }
+    }
+
+    return true;
+}
+
+template <class OnError>
+void write_sink_batch(
+    spdlog::sinks::sink &sink,
+    const managed_msg *first,
+    const managed_msg *last,
+    OnError &&on_error) {
+
+    if (write_base_sink_batch<std::mutex>(sink, first, last, on_error) ||
+        write_base_sink_batch<spdlog::details::null_mutex>(
+            sink, first, last, on_error)) {
+        return;
+    }
+
+    for (auto msg = first; msg != last; ++msg) {
+        if (sink.should_log(msg->buffer.level)) {
+            try {
+                sink.log(msg->buffer);
+            } catch (...) {
+                on_error(std::current_exception());
+            }
+        }
+    }
+}
+
+inline void
+latency_histogram::record(const std::chrono::nanoseconds latency) noexcept {
+    auto bucket = static_cast<size_t>(0);
+    auto upper_bound = FIRST_UPPER_BOUND_NS;
+
+    while (bucket + 1 < BUCKETS_COUNT && latency.count() >= upper_bound) {
+        ++bucket;
+        upper_bound *= 2;
+    }
+
+    counts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+inline auto latency_histogram::snapshot() const
+    -> std::vector<latency_bucket> {
+
+    // std
+    using std::vector;
+    using std::chrono::nanoseconds;
+
+    vector<latency_bucket> buckets(BUCKETS_COUNT);
+    auto upper_bound = FIRST_UPPER_BOUND_NS;
+
+    for (size_t i = 0; i < BUCKETS_COUNT; ++i) {
+        buckets[i].upper_bound = i + 1 < BUCKETS_COUNT
+                                     ? nanoseconds(upper_bound)
+                                     : nanoseconds::max();
+
+        buckets[i].count = counts[i].load(std::memory_order_relaxed);
+        upper_bound *= 2;
+    }
+
+    return buckets;
+}
+
+#ifndef NDEBUG
+inline auto managed_spsc_queue::claim_producer() noexcept -> bool {
+    auto expected = std::thread::id();
+    const auto current = std::this_thread::get_id();
+
+    return producer.compare_exchange_strong(
+               expected, current, std::memory_order_relaxed) ||
+           expected == current;
+}
+#endif
+
+// both are leaked, since pools may be destroyed during static destruction
+
+inline auto managed_thread_pools_mutex() -> std::mutex & {
+    static const auto mutex = new std::mutex();
+    return *mutex;
+}
+
+inline auto managed_thread_pools_registry()
+    -> std::unordered_set<const spdlog::details::thread_pool *> & {
+
+    static const auto registry =
+        new std::unordered_set<const spdlog::details::thread_pool *>();
+
+    return *registry;
+}
+
+inline auto as_managed_thread_pool(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool)
+    -> std::shared_ptr<managed_thread_pool> {
+
+    std::lock_guard<std::mutex> lock(managed_thread_pools_mutex());
+
+    return managed_thread_pools_registry().count(pool.get())
+               ? std::static_pointer_cast<managed_thread_pool>(pool)
+               : nullptr;
+}
+
+inline managed_thread_pool::managed_thread_pool(
+    const size_t queue_size,
+    const size_t num_threads,
+    const managed_pool_options &options,
+    const size_t fallback_queue_size,
+    std::function<void()> on_thread_start)
+    : spdlog::details::thread_pool(
+          fallback_queue_size,
+          1,
+          on_thread_start ? on_thread_start : [] {}),
+      options(options) {
+
+    const auto shards_count = options.sharded && num_threads > 1
+                                  ? num_threads
+                                  : static_cast<size_t>(1);
+
+    for (size_t i = 0; i < shards_count; ++i) {
+        shards.emplace_back(new managed_shard(queue_size));
+    }
+
+    for (size_t i = 0; i < num_threads; ++i) {
+        workers.emplace_back([this, on_thread_start, i] {
+            if (on_thread_start) {
+                on_thread_start();
+            }
+
+            worker_loop(i);
+        });
+    }
+
+    std::lock_guard<std::mutex> lock(managed_thread_pools_mutex());
+    managed_thread_pools_registry().insert(this);
+}
+
+inline managed_thread_pool::~managed_thread_pool() {
+    {
+        std::lock_guard<std::mutex> lock(managed_thread_pools_mutex());
+        managed_thread_pools_registry().erase(this);
+    }
+
+    // workers only stop once every queue is empty
+    stopping.store(true, std::memory_order_release);
+    not_empty.notify_all();
+
+    for (auto &worker : workers) {
+        worker.join();
+    }
+}
+
+inline void managed_thread_pool::post_log(
+    std::shared_ptr<managed_async_logger> logger,
+    const spdlog::details::log_msg &msg,
+    const overflow_handling &overflow) {
+
+    managed_msg log_msg;
+    log_msg.type = managed_msg::msg_type::Log;
+    log_msg.logger = std::move(logger);
+    log_msg.buffer = spdlog::details::log_msg_buffer(msg);
+
+    post(log_msg, overflow);
+}
+
+inline void managed_thread_pool::post_flush(
+    std::shared_ptr<managed_async_logger> logger,
+    const overflow_handling &overflow) {
+
+    managed_msg flush_msg;
+    flush_msg.type = managed_msg::msg_type::Flush;
+    flush_msg.logger = std::move(logger);
+
+    post(flush_msg, overflow);
+}
+
+inline auto managed_thread_pool::overruns() const noexcept -> size_t {
+    return overrun_count.load(std::memory_order_relaxed);
+}
+
+inline auto managed_thread_pool::queue_capacity() const noexcept -> size_t {
+    size_t capacity = 0;
+
+    for (const auto &shard : shards) {
+        capacity += shard->queue.capacity();
+    }
+
+    std::lock_guard<std::mutex> lock(spsc_mutex);
+
+    for (const auto &spsc : spsc_queues) {
+        capacity += spsc->queue.capacity();
+    }
+
+    return capacity;
+}
+
+inline auto managed_thread_pool::queue_depth() const noexcept -> size_t {
+    size_t depth = 0;
+
+    for (const auto &shard : shards) {
+        depth += shard->queue.size_approx();
+    }
+
+    std::lock_guard<std::mutex> lock(spsc_mutex);
+
+    for (const auto &spsc : spsc_queues) {
+        depth += spsc->queue.size_approx();
+    }
+
+    return depth;
+}
+
+inline auto managed_thread_pool::high_water_mark() const noexcept -> size_t {
+    return high_water.load(std::memory_order_relaxed);
+}
+
+inline auto managed_thread_pool::enqueue_latency() const
+    -> std::vector<latency_bucket> {
+
+    return enqueue_latencies.snapshot();
+}
+
+inline void managed_thread_pool::close() noexcept {
+    closed.store(true, std::memory_order_release);
+}
+
+inline auto managed_thread_pool::rejected() const noexcept -> size_t {
+    return rejected_count.load(std::memory_order_relaxed);
+}
+
+inline void managed_thread_pool::discard_queued() noexcept {
+    discarding.store(true, std::memory_order_release);
+}
+
+inline auto managed_thread_pool::idle() const noexcept -> bool {
+    if (queue_depth() > 0) {
+        return false;
+    }
+
+    // workers count themselves busy before taking a message, so a message
+    // taken since the depth was read is still seen here
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    return busy_workers.load(std::memory_order_seq_cst) == 0;
+}
+
+inline auto managed_thread_pool::wait_idle(
+    const std::chrono::steady_clock::time_point deadline) -> bool {
+
+    // std
+    using std::chrono::steady_clock;
+
+    const auto now = steady_clock::now();
+
+    return idle_changed.wait_for(
+        deadline > now ? deadline - now : steady_clock::duration::zero(),
+        [this] { return idle(); });
+}
+
+inline void managed_thread_pool::post(
+    managed_msg &msg, const overflow_handling &overflow) {
+
+    if (closed.load(std::memory_order_acquire)) {
+        rejected_count.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    const auto spsc = msg.logger->spsc;
+
+    if (!spsc) {
+        post_into(
+            shards[shards.size() > 1 ? msg.logger->shard_key % shards.size()
+                                     : 0]
+                ->queue,
+            msg,
+            overflow);
+
+        return;
+    }
+
+    // the workers only look at the queue once the logger is first used
+    std::call_once(
+        spsc->attached, [this, &msg] { attach_spsc_queue(msg.logger); });
+
+    if (msg.type == managed_msg::msg_type::Flush) {
+        // flushes may come from any thread, so they only raise a flag, which
+        // the worker turns into a flush after the messages already pushed
+        spsc->flush_requested.store(true, std::memory_order_release);
+        notify_not_empty();
+        return;
+    }
+
+#ifndef NDEBUG
+    const auto single_producer = spsc->claim_producer();
+
+    assert(
+        single_producer &&
+        "logger with queue = \"spsc\" written by more than one thread");
+
+    (void)single_producer;
+#endif
+
+    post_into(spsc->queue, msg, overflow);
+}
+
+template <class Queue>
+void managed_thread_pool::post_into(
+    Queue &queue, managed_msg &msg, const overflow_handling &overflow) {
+
+    // std
+    using std::memory_order_relaxed;
+    using std::chrono::duration_cast;
+    using std::chrono::nanoseconds;
+    using std::chrono::steady_clock;
+
+    const auto start = steady_clock::now();
+
+    // only log messages are dropped and counted, while flushes still wait
+    const auto is_log = msg.type == managed_msg::msg_type::Log;
+
+    const auto count_dropped =
+        [](const managed_msg &dropped_msg,
+           std::atomic<uint64_t> drop_counters::*counter) {
+            if (dropped_msg.type == managed_msg::msg_type::Log) {
+                (dropped_msg.logger->drops.*counter)
+                    .fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+
+    const auto push = [&queue, &msg] { return queue.try_push(msg); };
+
+    switch (is_log ? overflow.policy : overflow_policy::Block) {
+    case overflow_policy::OverrunOldest:
+        while (!push()) {
+            managed_msg oldest_msg;
+
+            if (queue.try_pop(oldest_msg)) {
+                overrun_count.fetch_add(1, std::memory_order_relaxed);
+                count_dropped(oldest_msg, &drop_counters::overrun);
+            }
+        }
+
+        break;
+
+    case overflow_policy::DiscardNew:
+        if (!push()) {
+            count_dropped(msg, &drop_counters::discarded);
+            return;
+        }
+
+        break;
+
+    case overflow_policy::BlockWithTimeout:
+        if (!push() && !not_full.wait_for(overflow.timeout, push)) {
+            count_dropped(msg, &drop_counters::timed_out);
+            return;
+        }
+
+        break;
+
+    case overflow_policy::DropBelowLevel:
+        // keeps the last quarter of the queue for the more severe messages
+        if (msg.buffer.level < overflow.level &&
+            queue.size_approx() >=
+                queue.capacity() - queue.capacity() / 4) {
+
+            count_dropped(msg, &drop_counters::below_level);
+            return;
+        }
+
+        if (!push()) {
+            not_full.wait(push);
+        }
+
+        break;
+
+    case overflow_policy::Block:
+        if (!push()) {
+            not_full.wait(push);
+        }
+
+        break;
+    }
+
+    // only raised when exceeded, so producers rarely write to it
+    const auto depth = queue.size_approx();
+    auto seen_depth = high_water.load(memory_order_relaxed);
+
+    while (depth > seen_depth &&
+           !high_water.compare_exchange_weak(
+               seen_depth, depth, memory_order_relaxed)) {
+    }
+
+    notify_not_empty();
+
+    enqueue_latencies.record(
+        duration_cast<nanoseconds>(steady_clock::now() - start));
+}
+
+
+inline void managed_thread_pool::attach_spsc_queue(
+    const std::shared_ptr<managed_async_logger> &logger) {
+
+    logger->spsc->logger = logger;
+
+    std::lock_guard<std::mutex> lock(spsc_mutex);
+    spsc_queues.push_back(logger->spsc);
+    spsc_version.fetch_add(1, std::memory_order_release);
+}
+
+inline void
+managed_thread_pool::detach_spsc_queue(const managed_spsc_queue *spsc) {
+    std::lock_guard<std::mutex> lock(spsc_mutex);
+
+    for (auto it = spsc_queues.begin(); it != spsc_queues.end(); ++it) {
+        if (it->get() == spsc) {
+            spsc_queues.erase(it);
+            spsc_version.fetch_add(1, std::memory_order_release);
+            return;
+        }
+    }
+}
+
+inline void managed_thread_pool::refresh_spsc_queues(managed_worker &worker) {
+    if (worker.spsc_version == spsc_version.load(std::memory_order_acquire)) {
+        return;
+    }
+
+    std::vector<std::shared_ptr<managed_spsc_queue>> queues;
+
+    {
+        std::lock_guard<std::mutex> lock(spsc_mutex);
+        queues = spsc_queues;
+        worker.spsc_version = spsc_version.load(std::memory_order_relaxed);
+    }
+
+    // the queues detached since are only released outside of the lock
+    worker.spsc_queues.swap(queues);
+}
+
+template <class Queue>
+auto managed_thread_pool::fill_batch(
+    Queue &queue, std::vector<managed_msg> &batch) -> size_t {
+
+    const auto deadline =
+        std::chrono::steady_clock::now() + options.max_batch_latency;
+
+    size_t count = 1;
+
+    while (count < batch.size()) {
+        auto &msg = batch[count];
+
+        if (!queue.try_pop(msg)) {
+            const auto remaining = deadline - std::chrono::steady_clock::now();
+
+            if (remaining <= std::chrono::steady_clock::duration::zero() ||
+                !not_empty.wait_for(remaining, [&queue, &msg] {
+                    return queue.try_pop(msg);
+                })) {
+                break;
+            }
+        }
+
+        notify_not_full();
+        ++count;
+    }
+
+    return count;
+}
+
+inline auto managed_thread_pool::try_take_shared_batch(
+    managed_worker &worker, std::vector<managed_msg> &batch) -> size_t {
+
+    // std
+    using std::memory_order_acquire;
+    using std::memory_order_release;
+
+    // the own queue of the worker comes first, then those of the others
+    for (size_t i = 0; i < shards.size(); ++i) {
+        auto &candidate = *shards[(worker.index + i) % shards.size()];
+
+        if (shards.size() > 1 &&
+            (candidate.queue.size_approx() == 0 ||
+             candidate.claimed.exchange(true, memory_order_acquire))) {
+            continue;
+        }
+
+        if (!candidate.queue.try_pop(batch.front())) {
+            if (shards.size() > 1) {
+                candidate.claimed.store(false, memory_order_release);
+            }
+
+            continue;
+        }
+
+        notify_not_full();
+        worker.shard = &candidate;
+        return fill_batch(candidate.queue, batch);
+    }
+
+    return 0;
+}
+
+inline auto managed_thread_pool::try_take_spsc_batch(
+    managed_worker &worker, std::vector<managed_msg> &batch) -> size_t {
+
+    // std
+    using std::memory_order_acq_rel;
+    using std::memory_order_acquire;
+    using std::memory_order_release;
+
+    const auto queues_count = worker.spsc_queues.size();
+
+    for (size_t i = 0; i < queues_count; ++i) {
+        const auto index = (worker.spsc_cursor + i) % queues_count;
+        auto &candidate = *worker.spsc_queues[index];
+
+        if ((candidate.queue.size_approx() == 0 &&
+             !candidate.flush_requested.load(memory_order_acquire)) ||
+            candidate.claimed.exchange(true, memory_order_acquire)) {
+            continue;
+        }
+
+        // due once the messages pushed before the request are written
+        if (candidate.flush_requested.exchange(false, memory_order_acq_rel)) {
+            candidate.flush_pending = true;
+            candidate.flush_target = candidate.queue.pushed_count();
+        }
+
+        if (!candidate.queue.try_pop(batch.front())) {
+            flush_spsc_if_due(candidate);
+            candidate.claimed.store(false, memory_order_release);
+            continue;
+        }
+
+        notify_not_full();
+        worker.spsc = &candidate;
+        worker.spsc_cursor = index + 1;
+        return fill_batch(candidate.queue, batch);
+    }
+
+    return 0;
+}
+
+inline auto managed_thread_pool::try_take_batch(
+    managed_worker &worker, std::vector<managed_msg> &batch) -> size_t {
+
+    // std
+    using std::memory_order_seq_cst;
+
+    // released by worker_loop once the batch is written, and pairs with the
+    // fence in idle, so that a message is never seen neither queued nor busy
+    busy_workers.fetch_add(1, memory_order_seq_cst);
+    std::atomic_thread_fence(memory_order_seq_cst);
+
+    worker.shard = nullptr;
+    worker.spsc = nullptr;
+    refresh_spsc_queues(worker);
+
+    // alternates between the shared and the private queues, so that neither
+    // side starves the other while both are busy
+    worker.spsc_first = !worker.spsc_first;
+
+    auto count = worker.spsc_first ? try_take_spsc_batch(worker, batch)
+                                   : try_take_shared_batch(worker, batch);
+
+    if (count == 0) {
+        count = worker.spsc_first ? try_take_shared_batch(worker, batch)
+                                  : try_take_spsc_batch(worker, batch);
+    }
+
+    if (count == 0) {
+        busy_workers.fetch_sub(1, memory_order_seq_cst);
+        idle_changed.notify_all();
+    }
+
+    return count;
+}
+
+inline auto managed_thread_pool::take_batch(
+    managed_worker &worker, std::vector<managed_msg> &batch) -> size_t {
+
+    // std
+    using std::chrono::steady_clock;
+
+    auto spinning = false;
+    auto spin_deadline = steady_clock::time_point();
+
+    while (true) {
+        if (const auto count = try_take_batch(worker, batch)) {
+            return count;
+        }
+
+        if (stopping.load(std::memory_order_acquire)) {
+            return 0;
+        }
+
+        // polling workers never sleep, so producers never need to wake them
+        if (options.wait == wait_strategy::Yield) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        if (options.wait == wait_strategy::Spin) {
+            cpu_relax();
+            continue;
+        }
+
+        if (options.wait == wait_strategy::SpinThenBlock) {
+            const auto now = steady_clock::now();
+
+            if (!spinning) {
+                spinning = true;
+                spin_deadline = now + options.spin_budget;
+            }
+
+            if (now < spin_deadline) {
+                cpu_relax();
+                continue;
+            }
+        }
+
+        spinning = false;
+
+        not_empty.wait([this, &worker] {
+            return stopping.load(std::memory_order_acquire) ||
+                   has_takeable_shard(worker);
+        });
+    }
+}
+
+inline void managed_thread_pool::flush_spsc_if_due(managed_spsc_queue &spsc) {
+    if (!spsc.flush_pending ||
+        spsc.queue.popped_count() < spsc.flush_target) {
+        return;
+    }
+
+    spsc.flush_pending = false;
+
+    if (const auto logger = spsc.logger.lock()) {
+        logger->backend_flush_();
+    }
+}
+
+inline void managed_thread_pool::release_batch(managed_worker &worker) {
+    // std
+    using std::memory_order_relaxed;
+    using std::memory_order_release;
+
+    // the queue may have been skipped by others while claimed
+    if (worker.spsc) {
+        auto &spsc = *worker.spsc;
+        spsc.claimed.store(false, memory_order_release);
+
+        if (spsc.queue.size_approx() > 0 ||
+            spsc.flush_requested.load(memory_order_relaxed)) {
+            notify_not_empty();
+        }
+    } else if (shards.size() > 1) {
+        worker.shard->claimed.store(false, memory_order_release);
+
+        if (worker.shard->queue.size_approx() > 0) {
+            notify_not_empty();
+        }
+    }
+}
+
+inline auto managed_thread_pool::has_takeable_shard(managed_worker &worker)
+    -> bool {
+
+    for (const auto &shard : shards) {
+        if (shard->queue.size_approx() > 0 &&
+            !shard->claimed.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+
+    refresh_spsc_queues(worker);
+
+    for (const auto &spsc : worker.spsc_queues) {
+        if ((spsc->queue.size_approx() > 0 ||
+             spsc->flush_requested.load(std::memory_order_acquire)) &&
+            !spsc->claimed.load(std::memory_order_acquire)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+inline void managed_thread_pool::notify_not_empty() {
+    // the worker woken up may be busy with another queue
+    if (shards.size() > 1) {
+        not_empty.notify_all();
+    } else {
+        not_empty.notify_one();
+    }
+}
+
+inline void managed_thread_pool::notify_not_full() {
+    // producers may wait on different queues, including private ones
+    if (shards.size() > 1 ||
+        spsc_version.load(std::memory_order_relaxed) > 0) {
+        not_full.notify_all();
+    } else {
+        not_full.notify_one();
+    }
+}
+
+inline void managed_thread_pool::worker_loop(const size_t worker_index) {
+    std::vector<managed_msg> batch(
+        options.batch_size > 0 ? options.batch_size : 1);
+
+    managed_worker worker(worker_index);
+
+    while (const auto count = take_batch(worker, batch)) {
+        const auto end = batch.data() + count;
+        const auto discard = discarding.load(std::memory_order_acquire);
+
+        for (auto msg = discard ? end : batch.data(); msg != end;) {
+            if (msg->type == managed_msg::msg_type::Flush) {
+                msg->logger->backend_flush_();
+                ++msg;
+                continue;
+            }
+
+            // consecutive messages of the same logger are written together
+            auto run_end = msg + 1;
+
+            while (run_end != end &&
+                   run_end->type == managed_msg::msg_type::Log &&
+                   run_end->logger == msg->logger) {
+                ++run_end;
+            }
+
+            msg->logger->backend_sink_batch_(msg, run_end);
+            msg = run_end;
+        }
+
+        if (worker.spsc) {
+            flush_spsc_if_due(*worker.spsc);
+        }
+
+        // loggers must not be kept alive by messages already written
+        for (auto msg = batch.data(); msg != end; ++msg) {
+            msg->logger.reset();
+        }
+
+        busy_workers.fetch_sub(1, std::memory_order_seq_cst);
+        idle_changed.notify_all();
+        release_batch(worker);
+    }
+}
+
+inline managed_async_logger::managed_async_logger(
+    std::string name,
+    const std::vector<spdlog::sink_ptr> &sinks,
+    std::weak_ptr<managed_thread_pool> pool,
+    const overflow_handling &overflow,
+    const size_t spsc_queue_size)
+    : spdlog::logger(std::move(name), sinks.cbegin(), sinks.cend()),
+      pool(std::move(pool)), overflow(overflow),
+      shard_key(std::hash<std::string>()(name_)),
+      spsc(
+          spsc_queue_size > 0
+              ? std::make_shared<managed_spsc_queue>(spsc_queue_size)
+              : nullptr) {
+
+    // only the worker may take the oldest message out of a private queue
+    if (spsc && overflow.policy == overflow_policy::OverrunOldest) {
+        throw spdlog::spdlog_ex(
+            "overrun_oldest cannot be used with a single-producer queue");
+    }
+}
+
+inline managed_async_logger::managed_async_logger(
+    const managed_async_logger &other)
+    : spdlog::logger(other),
+      std::enable_shared_from_this<managed_async_logger>(), pool(other.pool),
+      overflow(other.overflow), shard_key(other.shard_key),
+      spsc(
+          other.spsc ? std::make_shared<managed_spsc_queue>(
+                           other.spsc->queue.capacity())
+                     : nullptr) {}
+
+inline managed_async_logger::~managed_async_logger() {
+    if (!spsc) {
+        return;
+    }
+
+    if (const auto locked_pool = pool.lock()) {
+        locked_pool->detach_spsc_queue(spsc.get());
+    }
+}
+
+inline auto managed_async_logger::clone(std::string logger_name)
+    -> std::shared_ptr<spdlog::logger> {
+
+    auto cloned = std::make_shared<managed_async_logger>(*this);
+    cloned->name_ = std::move(logger_name);
+    cloned->shard_key = std::hash<std::string>()(cloned->name_);
+    return cloned;
+}
+
+inline auto managed_async_logger::dropped() const noexcept
+    -> dropped_messages {
+
+    // std
+    using std::memory_order_relaxed;
+
+    dropped_messages counts;
+    counts.overrun = drops.overrun.load(memory_order_relaxed);
+    counts.discarded = drops.discarded.load(memory_order_relaxed);
+    counts.timed_out = drops.timed_out.load(memory_order_relaxed);
+    counts.below_level = drops.below_level.load(memory_order_relaxed);
+    return counts;
+}
+
+inline void
+managed_async_logger::sink_it_(const spdlog::details::log_msg &msg) {
+    const auto locked_pool = pool.lock();
+
+    if (!locked_pool) {
+        throw spdlog::spdlog_ex("async log: thread pool doesn't exist anymore");
+    }
+
+    locked_pool->post_log(shared_from_this(), msg, overflow);
+}
+
+inline void managed_async_logger::flush_() {
+    const auto locked_pool = pool.lock();
+
+    if (!locked_pool) {
+        throw spdlog::spdlog_ex(
+            "async flush: thread pool doesn't exist anymore");
+    }
+
+    locked_pool->post_flush(shared_from_this(), overflow);
+}
+
+inline void managed_async_logger::backend_sink_batch_(
+    const managed_msg *first, const managed_msg *last) {
+
+    // std
+    using std::exception;
+    using std::exception_ptr;
+    using std::rethrow_exception;
+
+    const auto on_error = [this](const exception_ptr &error) {
+        try {
+            rethrow_exception(error);
+        } catch (const exception &e) {
+            err_handler_(e.what());
+        } catch (...) {
+            err_handler_("Unknown exception in logger");
+        }
+    };
+
+    for (auto &sink : sinks_) {
+        write_sink_batch(*sink, first, last, on_error);
+    }
+
+    // flushed once for the whole batch
+    for (auto msg = first; msg != last; ++msg) {
+        if (should_flush_(msg->buffer)) {
+            backend_flush_();
+            break;
+        }
+    }
+}
+
+inline void managed_async_logger::backend_flush_() {
+    for (auto &sink : sinks_) {
+        try {
+            sink->flush();
+        } catch (const std::exception &e) {
+            err_handler_(e.what());
+        } catch (...) {
+            err_handler_("Unknown exception in logger");
+        }
+    }
+}
+#endif
+} // namespace details
+} // namespace spdlog_setup
@@ -0,0 +1,804 @@
+/**
+ * Implementation of the file sinks with large write buffers in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "stats_impl.h"
+
+#include "spdlog/common.h"
+#include "spdlog/details/log_msg.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/details/os.h"
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/sinks/base_sink.h"
+#include "spdlog/sinks/daily_file_sink.h"
+#include "spdlog/sinks/rotating_file_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <malloc.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Writes a file through a single large buffer, which is only written out once
+ * full or flushed, so that many small messages become a few large sequential
+ * writes. With direct I/O, the file bypasses the page cache, and the buffer,
+ * its size and every write out are aligned to DIRECT_IO_ALIGNMENT. A flush
+ * then writes out the last partial block padded with zero bytes, and keeps it
+ * buffered to write it over again once more bytes follow.
+ */
+class buffered_file {
+  public:
+    /** Alignment of the buffer and of the writes out with direct I/O */
+    static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;
+
+    /**
+     * Constructor accepting how to buffer the file, which is opened later.
+     * @param buffer_size Size of the buffer in bytes, rounded up to
+     * DIRECT_IO_ALIGNMENT with direct I/O.
+     * @param direct_io true to bypass the page cache where supported, which
+     * falls back to writing through the page cache otherwise.
+     */
+    buffered_file(const size_t buffer_size, const bool direct_io);
+
+    buffered_file(const buffered_file &) = delete;
+    auto operator=(const buffered_file &) -> buffered_file & = delete;
+
+    /**
+     * Writes out the buffer and closes the file.
+     */
+    ~buffered_file();
+
+    /**
+     * Opens the file at the given path, closing any file opened before.
+     * @param filename Path of the file to write into.
+     * @param truncate true to discard the existing content of the file.
+     * @throw spdlog::spdlog_ex
+     */
+    void open(const std::string &filename, const bool truncate);
+
+    /**
+     * Writes out the buffer and closes the file, if opened.
+     * @throw spdlog::spdlog_ex
+     */
+    void close();
+
+    /**
+     * Appends the given bytes to the buffer, writing it out whenever full.
+     * @param data Start of the bytes to append.
+     * @param size Number of bytes to append.
+     * @throw spdlog::spdlog_ex
+     */
+    void write(const char *data, size_t size);
+
+    /**
+     * Writes out the buffer.
+     * @throw spdlog::spdlog_ex
+     */
+    void flush();
+
+    /**
+     * Returns the size of the file, including the bytes still buffered.
+     * @return Size of the file in bytes.
+     */
+    auto size() const noexcept -> uint64_t;
+
+    /**
+     * Returns the path of the file last opened.
+     * @return Path of the file.
+     */
+    auto filename() const -> const std::string &;
+
+  private:
+    struct aligned_deleter {
+        void operator()(char *buffer) const noexcept;
+    };
+
+    auto is_open() const noexcept -> bool;
+    void write_out();
+    void write_at(const char *data, const size_t size, const uint64_t offset);
+    void truncate_at(const uint64_t size);
+
+    std::string file_path;
+    const size_t capacity;
+    const bool direct_io;
+    std::unique_ptr<char, aligned_deleter> buffer;
+
+    // whether the opened file bypasses the page cache, and needs every write
+    // out to be aligned
+    bool aligned;
+
+    // offset in the file of the start of the buffer
+    uint64_t buffer_offset;
+    size_t used;
+
+#ifdef _WIN32
+    HANDLE file_handle;
+#else
+    int fd;
+#endif
+};
+} // namespace details
+
+/**
+ * Sink that writes formatted messages into a single file through a large
+ * buffer, as basic_file_sink with buffer_size or direct_io.
+ */
+template <class Mutex>
+class buffered_file_sink : public spdlog::sinks::base_sink<Mutex> {
+  public:
+    /**
+     * Constructor accepting the file to write into.
+     * @param filename Path of the file to write into.
+     * @param buffer_size Size of the write buffer in bytes.
+     * @param direct_io true to bypass the page cache where supported.
+     * @param truncate true to discard the existing content of the file.
+     * @throw spdlog::spdlog_ex
+     */
+    buffered_file_sink(
+        const std::string &filename,
+        const size_t buffer_size,
+        const bool direct_io,
+        const bool truncate = false);
+
+    /**
+     * Returns the path of the file written into.
+     * @return Path of the file.
+     */
+    auto filename() const -> const std::string &;
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    details::buffered_file file;
+};
+
+/**
+ * Sink that writes formatted messages through a large buffer into files
+ * rotated by size, as rotating_file_sink with buffer_size or direct_io.
+ */
+template <class Mutex>
+class buffered_rotating_file_sink : public spdlog::sinks::base_sink<Mutex> {
+  public:
+    /**
+     * Constructor accepting the files to rotate.
+     * @param base_filename Path of the file written into, which the paths of
+     * the rotated files are derived from.
+     * @param max_size Size in bytes at which the file is rotated.
+     * @param max_files Number of rotated files to keep.
+     * @param buffer_size Size of the write buffer in bytes.
+     * @param direct_io true to bypass the page cache where supported.
+     * @throw spdlog::spdlog_ex
+     */
+    buffered_rotating_file_sink(
+        const std::string &base_filename,
+        const size_t max_size,
+        const size_t max_files,
+        const size_t buffer_size,
+        const bool direct_io);
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    void rotate();
+
+    const std::string base_filename;
+    const size_t max_size;
+    const size_t max_files;
+    details::buffered_file file;
+};
+
+/**
+ * Sink that writes formatted messages through a large buffer into a new file
+ * every day, as daily_file_sink with buffer_size or direct_io.
+ */
+template <class Mutex>
+class buffered_daily_file_sink : public spdlog::sinks::base_sink<Mutex> {
+  public:
+    /**
+     * Constructor accepting the files to rotate.
+     * @param base_filename Path which the dated paths of the files are derived
+     * from.
+     * @param rotation_hour Hour of the day at which to rotate.
+     * @param rotation_minute Minute of the hour at which to rotate.
+     * @param buffer_size Size of the write buffer in bytes.
+     * @param direct_io true to bypass the page cache where supported.
+     * @throw spdlog::spdlog_ex
+     */
+    buffered_daily_file_sink(
+        const std::string &base_filename,
+        const int rotation_hour,
+        const int rotation_minute,
+        const size_t buffer_size,
+        const bool direct_io);
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    auto next_rotation_time() const -> spdlog::log_clock::time_point;
+
+    const std::string base_filename;
+    const int rotation_hour;
+    const int rotation_minute;
+    spdlog::log_clock::time_point rotation_time;
+    details::buffered_file file;
+};
+
+using buffered_file_sink_mt = buffered_file_sink<std::mutex>;
+using buffered_file_sink_st = buffered_file_sink<spdlog::details::null_mutex>;
+
+using buffered_rotating_file_sink_mt = buffered_rotating_file_sink<std::mutex>;
+using buffered_rotating_file_sink_st =
+    buffered_rotating_file_sink<spdlog::details::null_mutex>;
+
+using buffered_daily_file_sink_mt = buffered_daily_file_sink<std::mutex>;
+using buffered_daily_file_sink_st =
+    buffered_daily_file_sink<spdlog::details::null_mutex>;
+
+namespace details {
+// implementation section
+
+inline void buffered_file::aligned_deleter::operator()(char *buffer) const
+    noexcept {
+#ifdef _WIN32
+    _aligned_free(buffer);
+#else
+    std::free(buffer);
+#endif
+}
+
+inline buffered_file::buffered_file(
+    const size_t buffer_size, const bool direct_io)
+    : capacity(
+          direct_io ? (std::max<size_t>(buffer_size, 1) +
+                       DIRECT_IO_ALIGNMENT - 1) /
+                          DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT
+                    : std::max<size_t>(buffer_size, 1)),
+      direct_io(direct_io), aligned(false), buffer_offset(0), used(0)
+#ifdef _WIN32
+      ,
+      file_handle(INVALID_HANDLE_VALUE)
+#else
+      ,
+      fd(-1)
+#endif
+{
+    // std
+    using std::bad_alloc;
+
+#ifdef _WIN32
+    const auto memory = static_cast<char *>(
+        _aligned_malloc(capacity, DIRECT_IO_ALIGNMENT));
+#else
+    void *allocated = nullptr;
+
+    const auto memory =
+        posix_memalign(&allocated, DIRECT_IO_ALIGNMENT, capacity) == 0
+            ? static_cast<char *>(allocated)
+            : nullptr;
+#endif
+
+    if (!memory) {
+        throw bad_alloc();
+    }
+
+    buffer.reset(memory);
+}
+
+inline buffered_file::~buffered_file() {
+    try {
+        close();
+    } catch (...) {
+        // nothing else can be done in a destructor
+    }
+}
+
+inline void
+buffered_file::open(const std::string &filename, const bool truncate) {
+    // fmt
+    using fmt::format;
+
+    close();
+
+#ifdef _WIN32
+    const auto open_file = [&filename, truncate](const DWORD flags) {
+        return CreateFileA(
+            filename.c_str(),
+            GENERIC_READ | GENERIC_WRITE,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr,
+            truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+            FILE_ATTRIBUTE_NORMAL | flags,
+            nullptr);
+    };
+
+    file_handle = direct_io ? open_file(FILE_FLAG_NO_BUFFERING)
+                            : INVALID_HANDLE_VALUE;
+
+    aligned = file_handle != INVALID_HANDLE_VALUE;
+
+    if (!aligned) {
+        file_handle = open_file(0);
+    }
+
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw spdlog::spdlog_ex(format(
+            "Failed opening file {} for writing, error {}",
+            filename,
+            GetLastError()));
+    }
+
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        const auto error = GetLastError();
+        CloseHandle(file_handle);
+        file_handle = INVALID_HANDLE_VALUE;
+
+        throw spdlog::spdlog_ex(format(
+            "Failed getting size of file {}, error {}", filename, error));
+    }
+
+    const auto existing_size = static_cast<uint64_t>(file_size.QuadPart);
+#else
+    const auto flags = O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0);
+
+#ifdef O_DIRECT
+    // file systems such as tmpfs reject O_DIRECT
+    fd = direct_io ? ::open(filename.c_str(), flags | O_DIRECT, 0644) : -1;
+    aligned = fd >= 0;
+#endif
+
+    if (fd < 0) {
+        fd = ::open(filename.c_str(), flags, 0644);
+    }
+
+    if (fd < 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed opening file {} for writing", filename), errno);
+    }
+
+#if defined(__APPLE__)
+    if (direct_io) {
+        // writes need no alignment without the page cache on macOS
+        fcntl(fd, F_NOCACHE, 1);
+    }
+#endif
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        const auto error = errno;
+        ::close(fd);
+        fd = -1;
+
+        throw spdlog::spdlog_ex(
+            format("Failed getting size of file {}", filename), error);
+    }
+
+    const auto existing_size = static_cast<uint64_t>(st.st_size);
+#endif
+
+    file_path = filename;
+    buffer_offset = existing_size;
+    used = 0;
+
+    if (!aligned || existing_size % DIRECT_IO_ALIGNMENT == 0) {
+        return;
+    }
+
+    // the partial last block is read back into the buffer, so that every
+    // write out starts at an aligned offset
+    buffer_offset = existing_size / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+    const auto tail_size = static_cast<size_t>(existing_size - buffer_offset);
+
+#ifdef _WIN32
+    OVERLAPPED overlapped = {};
+    overlapped.Offset = static_cast<DWORD>(buffer_offset);
+    overlapped.OffsetHigh = static_cast<DWORD>(buffer_offset >> 32);
+
+    DWORD read_count = 0;
+
+    const auto read_ok = ReadFile(
+        file_handle,
+        buffer.get(),
+        static_cast<DWORD>(DIRECT_IO_ALIGNMENT),
+        &read_count,
+        &overlapped);
+
+    if (!read_ok || read_count < tail_size) {
+        const auto error = GetLastError();
+        close();
+
+        throw spdlog::spdlog_ex(
+            format("Failed reading file {}, error {}", filename, error));
+    }
+#else
+    const auto read_count = pread(
+        fd,
+        buffer.get(),
+        DIRECT_IO_ALIGNMENT,
+        static_cast<off_t>(buffer_offset));
+
+    if (read_count < 0 || static_cast<size_t>(read_count) < tail_size) {
+        const auto error = errno;
+        close();
+
+        throw spdlog::spdlog_ex(
+            format("Failed reading file {}", filename), error);
+    }
+#endif
+
+    used = tail_size;
+}
+
+inline void buffered_file::close() {
+    if (!is_open()) {
+        return;
+    }
+
+    struct closer {
+        buffered_file &file;
+
+        ~closer() {
+#ifdef _WIN32
+            CloseHandle(file.file_handle);
+            file.file_handle = INVALID_HANDLE_VALUE;
+#else
+            ::close(file.fd);
+            file.fd = -1;
+#endif
+
+            file.used = 0;
+        }
+    } closer{*this};
+
+    write_out();
+}
+
+inline void buffered_file::write(const char *data, size_t size) {
+    while (size > 0) {
+        const auto count = std::min(size, capacity - used);
+        std::memcpy(buffer.get() + used, data, count);
+
+        used += count;
+        data += count;
+        size -= count;
+
+        if (used == capacity) {
+            write_out();
+        }
+    }
+}
+
+inline void buffered_file::flush() {
+    if (is_open()) {
+        write_out();
+    }
+}
+
+inline auto buffered_file::size() const noexcept -> uint64_t {
+    return buffer_offset + used;
+}
+
+inline auto buffered_file::filename() const -> const std::string & {
+    return file_path;
+}
+
+inline auto buffered_file::is_open() const noexcept -> bool {
+#ifdef _WIN32
+    return file_handle != INVALID_HANDLE_VALUE;
+#else
+    return fd >= 0;
+#endif
+}
+
+inline void buffered_file::write_out() {
+    if (used == 0) {
+        return;
+    }
+
+    if (!aligned) {
+        write_at(buffer.get(), used, buffer_offset);
+        buffer_offset += used;
+        used = 0;
+        return;
+    }
+
+    const auto padded_size = (used + DIRECT_IO_ALIGNMENT - 1) /
+                             DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+
+    std::memset(buffer.get() + used, 0, padded_size - used);
+    write_at(buffer.get(), padded_size, buffer_offset);
+
+    if (padded_size == used) {
+        buffer_offset += used;
+        used = 0;
+        return;
+    }
+
+    // drops the padding, and keeps the partial block to write it over again
+    truncate_at(buffer_offset + used);
+
+    const auto kept_offset =
+        used / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT;
+
+    std::memmove(buffer.get(), buffer.get() + kept_offset, used - kept_offset);
+    buffer_offset += kept_offset;
+    used -= kept_offset;
+}
+
+inline void buffered_file::write_at(
+    const char *data, const size_t size, const uint64_t offset) {
+
+    // fmt
+    using fmt::format;
+
+    size_t written = 0;
+
+    while (written < size) {
+        const auto position = offset + written;
+
+#ifdef _WIN32
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(position);
+        overlapped.OffsetHigh = static_cast<DWORD>(position >> 32);
+
+        DWORD count = 0;
+
+        if (!WriteFile(
+                file_handle,
+                data + written,
+                static_cast<DWORD>(size - written),
+                &count,
+                &overlapped)) {
+            throw spdlog::spdlog_ex(format(
+                "Failed writing to file {}, error {}",
+                file_path,
+                GetLastError()));
+        }
+#else
+        const auto count = pwrite(
+            fd, data + written, size - written, static_cast<off_t>(position));
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw spdlog::spdlog_ex(
+                format("Failed writing to file {}", file_path), errno);
+        }
+#endif
+
+        written += static_cast<size_t>(count);
+    }
+}
+
+inline void buffered_file::truncate_at(const uint64_t size) {
+    // fmt
+    using fmt::format;
+
+#ifdef _WIN32
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFilePointerEx(file_handle, end, nullptr, FILE_BEGIN) ||
+        !SetEndOfFile(file_handle)) {
+        throw spdlog::spdlog_ex(format(
+            "Failed truncating file {}, error {}", file_path, GetLastError()));
+    }
+#else
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed truncating file {}", file_path), errno);
+    }
+#endif
+}
+} // namespace details
+
+template <class Mutex>
+buffered_file_sink<Mutex>::buffered_file_sink(
+    const std::string &filename,
+    const size_t buffer_size,
+    const bool direct_io,
+    const bool truncate)
+    : file(buffer_size, direct_io) {
+
+    file.open(filename, truncate);
+}
+
+template <class Mutex>
+auto buffered_file_sink<Mutex>::filename() const -> const std::string & {
+    return file.filename();
+}
+
+template <class Mutex>
+void buffered_file_sink<Mutex>::sink_it_(const spdlog::details::log_msg &msg) {
+    details::formatted_buffer formatted;
+    spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
+    file.write(formatted.data(), formatted.size());
+}
+
+template <class Mutex> void buffered_file_sink<Mutex>::flush_() {
+    file.flush();
+}
+
+template <class Mutex>
+buffered_rotating_file_sink<Mutex>::buffered_rotating_file_sink(
+    const std::string &base_filename,
+    const size_t max_size,
+    const size_t max_files,
+    const size_t buffer_size,
+    const bool direct_io)
+    : base_filename(base_filename), max_size(max_size), max_files(max_files),
+      file(buffer_size, direct_io) {
+
+    if (max_size == 0) {
+        throw spdlog::spdlog_ex(
+            "rotating sink constructor: max_size arg cannot be zero");
+    }
+
+    file.open(base_filename, false);
+}
+
+template <class Mutex>
+void buffered_rotating_file_sink<Mutex>::sink_it_(
+    const spdlog::details::log_msg &msg) {
+
+    details::formatted_buffer formatted;
+    spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
+
+    // an empty file is never rotated, even for an oversized message
+    if (file.size() > 0 && file.size() + formatted.size() > max_size) {
+        rotate();
+    }
+
+    file.write(formatted.data(), formatted.size());
+}
+
+template <class Mutex> void buffered_rotating_file_sink<Mutex>::flush_() {
+    file.flush();
+}
+
+template <class Mutex> void buffered_rotating_file_sink<Mutex>::rotate() {
+    // spdlog
+    using spdlog::details::os::path_exists;
+    using spdlog::details::os::rename;
+    using spdlog::sinks::rotating_file_sink;
+
+    file.close();
+
+    // same naming and order as rotating_file_sink
+    for (auto i = max_files; i > 0; --i) {
+        const auto src =
+            rotating_file_sink<Mutex>::calc_filename(base_filename, i - 1);
+
+        if (!path_exists(src)) {
+            continue;
+        }
+
+        const auto target =
+            rotating_file_sink<Mutex>::calc_filename(base_filename, i);
+
+        if (rename(src, target) != 0) {
+            // keeps the file from growing beyond its limit anyway
+            file.open(base_filename, true);
+
+            throw spdlog::spdlog_ex(
+                "buffered_rotating_file_sink: failed renaming " + src +
+                    " to " + target,
+                errno);
+        }
+    }
+
+    file.open(base_filename, true);
+}
+
+template <class Mutex>
+buffered_daily_file_sink<Mutex>::buffered_daily_file_sink(
+    const std::string &base_filename,
+    const int rotation_hour,
+    const int rotation_minute,
+    const size_t buffer_size,
+    const bool direct_io)
+    : base_filename(base_filename), rotation_hour(rotation_hour),
+      rotation_minute(rotation_minute), file(buffer_size, direct_io) {
+
+    // spdlog
+    using spdlog::log_clock;
+    using spdlog::details::os::localtime;
+    using spdlog::sinks::daily_filename_calculator;
+
+    if (rotation_hour < 0 || rotation_hour > 23 || rotation_minute < 0 ||
+        rotation_minute > 59) {
+        throw spdlog::spdlog_ex(
+            "daily_file_sink: Invalid rotation time in ctor");
+    }
+
+    const auto now = log_clock::to_time_t(log_clock::now());
+
+    file.open(
+        daily_filename_calculator::calc_filename(
+            base_filename, localtime(now)),
+        false);
+
+    rotation_time = next_rotation_time();
+}
+
+template <class Mutex>
+void buffered_daily_file_sink<Mutex>::sink_it_(
+    const spdlog::details::log_msg &msg) {
+
+    // spdlog
+    using spdlog::log_clock;
+    using spdlog::details::os::localtime;
+    using spdlog::sinks::daily_filename_calculator;
+
+    if (msg.time >= rotation_time) {
+        const auto time = log_clock::to_time_t(msg.time);
+
+        file.open(
+            daily_filename_calculator::calc_filename(
+                base_filename, localtime(time)),
+            false);
+
+        rotation_time = next_rotation_time();
+    }
+
+    details::formatted_buffer formatted;
+    spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
+    file.write(formatted.data(), formatted.size());
+}
+
+template <class Mutex> void buffered_daily_file_sink<Mutex>::flush_() {
+    file.flush();
+}
+
+template <class Mutex>
+auto buffered_daily_file_sink<Mutex>::next_rotation_time() const
+    -> spdlog::log_clock::time_point {
+
+    // spdlog
+    using spdlog::log_clock;
+    using spdlog::details::os::localtime;
+
+    const auto now = log_clock::now();
+    auto date = localtime(log_clock::to_time_t(now));
+    date.tm_hour = rotation_hour;
+    date.tm_min = rotation_minute;
+    date.tm_sec = 0;
+
+    const auto time = log_clock::from_time_t(std::mktime(&date));
+    return time > now ? time : time + std::chrono::hours(24);
+}
+} // namespace spdlog_setup
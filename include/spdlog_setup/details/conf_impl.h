@@ -14,7 +14,15 @@
 #if defined(SPDLOG_SETUP_CPPTOML_EXTERNAL)
 #include "cpptoml.h"
 #endif
+#include "async_pool_impl.h"
+#include "buffered_sink_impl.h"
+#include "file_impl.h"
+#include "flush_impl.h"
+#include "mmap_sink_impl.h"
 #include "setup_error.h"
+#include "stats_impl.h"
+#include "topology_impl.h"
+#include "uring_sink_impl.h"
 
 // Just so that it works for v1.3.0
 #include "spdlog/spdlog.h"
@@ -22,8 +30,10 @@
 // To support all asynchronous loggers
 #include "spdlog/async.h"
 
+#include "spdlog/details/null_mutex.h"
 #include "spdlog/fmt/fmt.h"
 
+#include "spdlog/sinks/base_sink.h"
 #include "spdlog/sinks/basic_file_sink.h"
 #include "spdlog/sinks/daily_file_sink.h"
 #include "spdlog/sinks/null_sink.h"
@@ -40,15 +50,29 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
+#include <cstdlib>
 #include <exception>
+#include <functional>
 #include <fstream>
+#include <istream>
+#include <iterator>
 #include <memory>
+#include <mutex>
 #include <regex>
+#include <set>
 #include <sstream>
 #include <string>
+#include <system_error>
+#include <thread>
 #include <type_traits>
+#include <typeinfo>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -64,6 +88,11 @@
 #include <unistd.h>
 #endif
 
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#endif
+
 namespace spdlog_setup {
 namespace details {
 // declaration section
@@ -126,6 +155,18 @@ enum class sink_type {
     /** Represents daily_file_sink_mt */
     DailyFileSinkMt,
 
+    /** Represents mmap_file_sink_st */
+    MmapFileSinkSt,
+
+    /** Represents mmap_file_sink_mt */
+    MmapFileSinkMt,
+
+    /** Represents uring_file_sink_st */
+    UringFileSinkSt,
+
+    /** Represents uring_file_sink_mt */
+    UringFileSinkMt,
+
     /** Represents null_sink_st */
     NullSinkSt,
 
@@ -157,10 +198,13 @@ enum class sync_type {
 };
 
 namespace defaults {
-static constexpr auto ASYNC_OVERFLOW_POLICY =
-    spdlog::async_overflow_policy::block;
 static constexpr auto THREAD_POOL_QUEUE_SIZE = 8192;
 static constexpr auto THREAD_POOL_NUM_THREADS = 1;
+static constexpr auto SINK_SETUP_THREADS = 1;
+static constexpr auto LAZY_LOGGERS = false;
+static constexpr auto LOGGER_QUEUE_SIZE = 8192;
+static constexpr auto FILE_BUFFER_SIZE = "1M";
+static constexpr auto FILE_BUFFERS_IN_FLIGHT = 4;
 } // namespace defaults
 
 namespace names {
@@ -174,31 +218,64 @@ static constexpr auto THREAD_POOL_TABLE = "thread_pool";
 // field names
 static constexpr auto ASYNC = "async";
 static constexpr auto BASE_FILENAME = "base_filename";
+static constexpr auto BATCH_SIZE = "batch_size";
 static constexpr auto BLOCK = "block";
+static constexpr auto BLOCK_WITH_TIMEOUT = "block_with_timeout";
+static constexpr auto BLOCKING = "blocking";
+static constexpr auto BUFFER_SIZE = "buffer_size";
+static constexpr auto BUFFERS_IN_FLIGHT = "buffers_in_flight";
+static constexpr auto CHUNK_SIZE = "chunk_size";
+static constexpr auto CPU_AFFINITY = "cpu_affinity";
 static constexpr auto CREATE_PARENT_DIR = "create_parent_dir";
+static constexpr auto DIRECT_IO = "direct_io";
+static constexpr auto DISCARD_NEW = "discard_new";
+static constexpr auto DROP_BELOW_LEVEL = "drop_below_level";
 static constexpr auto FILENAME = "filename";
 static constexpr auto GLOBAL_PATTERN = "global_pattern";
 static constexpr auto IDENT = "ident";
+static constexpr auto LAZY_LOGGERS = "lazy_loggers";
 static constexpr auto LEVEL = "level";
+static constexpr auto LOCKFREE = "lockfree";
+static constexpr auto LOGGER = "logger";
+static constexpr auto FLUSH_INTERVAL = "flush_interval";
 static constexpr auto FLUSH_LEVEL = "flush_level";
+static constexpr auto MAX_BATCH_LATENCY_US = "max_batch_latency_us";
 static constexpr auto MAX_FILES = "max_files";
 static constexpr auto MAX_SIZE = "max_size";
 static constexpr auto NAME = "name";
+static constexpr auto NICE = "nice";
+static constexpr auto NUMA = "numa";
 static constexpr auto NUM_THREADS = "num_threads";
 static constexpr auto OVERRUN_OLDEST = "overrun_oldest";
+static constexpr auto OVERFLOW_LEVEL = "overflow_level";
 static constexpr auto OVERFLOW_POLICY = "overflow_policy";
+static constexpr auto OVERFLOW_TIMEOUT = "overflow_timeout";
+static constexpr auto PER_NODE = "per_node";
 static constexpr auto PATTERN = "pattern";
+static constexpr auto QUEUE = "queue";
 static constexpr auto QUEUE_SIZE = "queue_size";
 static constexpr auto ROTATION_HOUR = "rotation_hour";
 static constexpr auto ROTATION_MINUTE = "rotation_minute";
+static constexpr auto SCHED_POLICY = "sched_policy";
+static constexpr auto SCHED_PRIORITY = "sched_priority";
+static constexpr auto SINK_SETUP_THREADS = "sink_setup_threads";
+static constexpr auto SHARDING = "sharding";
+static constexpr auto SHARED = "shared";
 static constexpr auto SINKS = "sinks";
+static constexpr auto SPIN = "spin";
+static constexpr auto SPIN_BUDGET_US = "spin_budget_us";
+static constexpr auto SPIN_THEN_BLOCK = "spin_then_block";
+static constexpr auto SPSC = "spsc";
 static constexpr auto SYNC = "sync";
 static constexpr auto SYSLOG_FACILITY = "syslog_facility";
 static constexpr auto SYSLOG_OPTION = "syslog_option";
+static constexpr auto THREAD_NAME = "thread_name";
 static constexpr auto THREAD_POOL = "thread_pool";
 static constexpr auto TRUNCATE = "truncate";
 static constexpr auto TYPE = "type";
 static constexpr auto VALUE = "value";
+static constexpr auto WAIT_STRATEGY = "wait_strategy";
+static constexpr auto YIELD = "yield";
 } // namespace names
 
 const std::unordered_map<std::string, sync_type> SYNC_MAP{{
@@ -206,11 +283,147 @@ const std::unordered_map<std::string, sync_type> SYNC_MAP{{
     {names::ASYNC, sync_type::Async},
 }};
 
-const std::unordered_map<std::string, spdlog::async_overflow_policy>
-    ASYNC_OVERFLOW_POLICY_MAP{{
-        {names::BLOCK, spdlog::async_overflow_policy::block},
-        {names::OVERRUN_OLDEST, spdlog::async_overflow_policy::overrun_oldest},
-    }};
+const std::unordered_map<std::string, overflow_policy> OVERFLOW_POLICY_MAP{{
+    {names::BLOCK, overflow_policy::Block},
+    {names::OVERRUN_OLDEST, overflow_policy::OverrunOldest},
+    {names::DISCARD_NEW, overflow_policy::DiscardNew},
+    {names::BLOCK_WITH_TIMEOUT, overflow_policy::BlockWithTimeout},
+    {names::DROP_BELOW_LEVEL, overflow_policy::DropBelowLevel},
+}};
+
+/**
+ * Describes how the worker threads of a thread pool are scheduled, applied by
+ * each worker as it starts.
+ */
+struct thread_scheduling {
+    /** CPUs the workers may run on, empty to leave unchanged */
+    std::vector<int> cpus;
+
+    /** Whether nice is set */
+    bool has_nice = false;
+
+    /** Nice value of the workers */
+    int nice = 0;
+
+    /** Whether policy and priority are set */
+    bool has_policy = false;
+
+    /** Scheduling policy of the workers, such as SCHED_FIFO */
+    int policy = 0;
+
+    /** Static priority for the policy, only non-zero for real-time ones */
+    int priority = 0;
+
+    /** Name of the workers, empty to leave unchanged */
+    std::string thread_name;
+
+    /**
+     * Whether to create a pool per NUMA node, with its workers bound to the
+     * CPUs of the node
+     */
+    bool per_numa_node = false;
+};
+
+/**
+ * Describes the queue of a thread pool.
+ */
+struct thread_pool_queue {
+    /**
+     * Whether to use the lock-free ring of a managed_thread_pool instead of
+     * the blocking queue of spdlog
+     */
+    bool lockfree = false;
+
+    /** How the workers of the lock-free ring take messages */
+    managed_pool_options options;
+};
+
+/**
+ * Describes the queue of an async logger.
+ */
+struct logger_queue {
+    /**
+     * Whether the logger has a private single-producer queue that the
+     * workers of its lock-free thread pool poll, instead of the shared queues
+     * of the pool
+     */
+    bool spsc = false;
+
+    /** Maximum number of queued messages of the private queue */
+    size_t queue_size = defaults::LOGGER_QUEUE_SIZE;
+};
+
+/**
+ * Describes how a file sink buffers its writes.
+ */
+struct file_buffering {
+    /**
+     * Whether the sink writes through its own large buffer, instead of the
+     * stdio buffer of the spdlog file sink
+     */
+    bool buffered = false;
+
+    /** Size of the buffer in bytes */
+    size_t buffer_size = 0;
+
+    /** Whether the file bypasses the page cache */
+    bool direct_io = false;
+};
+
+/**
+ * Describes the configuration currently applied, together with the entities
+ * built from it, so that later reconfiguration can reuse unchanged entities.
+ * Sinks and loggers are only observed, so that dropping the loggers still
+ * releases them, while the named thread pools are owned, since async loggers
+ * only hold weak references to them.
+ */
+struct applied_config {
+    /** Merged configuration that was applied, nullptr if none */
+    std::shared_ptr<cpptoml::table> config;
+
+    /** Sinks by name */
+    std::unordered_map<std::string, std::weak_ptr<spdlog::sinks::sink>>
+        sinks_map;
+
+    /** Named thread pools by name */
+    std::unordered_map<
+        std::string,
+        std::shared_ptr<spdlog::details::thread_pool>>
+        thread_pools_map;
+
+    /** Loggers by name, as registered into spdlog */
+    std::unordered_map<std::string, std::weak_ptr<spdlog::logger>>
+        loggers_map;
+
+    /** Whether loggers are only built on first request */
+    bool lazy = false;
+
+    /**
+     * Whether the global thread pool of a lazy configuration still needs to
+     * be installed before building the first async logger using it
+     */
+    bool global_thread_pool_pending = false;
+};
+
+/**
+ * Returns the process-wide configuration currently applied.
+ * @return Applied configuration, to be accessed only while holding
+ * applied_config_mutex().
+ */
+inline auto applied_config_state() -> applied_config & {
+    static applied_config state;
+    return state;
+}
+
+/**
+ * Returns the mutex guarding applied_config_state(), which also serializes
+ * set-ups and reconfigurations against each other.
+ * @return Mutex of the applied configuration.
+ */
+inline auto applied_config_mutex() -> std::mutex & {
+    static std::mutex mutex;
+    return mutex;
+}
 
 inline auto get_parent_path(const std::string &file_path) -> std::string {
     // string
@@ -269,7 +482,8 @@ inline void create_dirs_impl(const std::string &dir_path) {
     if (!file_exists(dir_path)) {
         create_dirs_impl(get_parent_path(dir_path));
 
-        if (!native_create_dir(dir_path)) {
+        // another thread may have created the same directory in the meantime
+        if (!native_create_dir(dir_path) && !file_exists(dir_path)) {
             throw setup_error(
                 format("Unable to create directory at '{}'", dir_path));
         }
@@ -280,6 +494,127 @@ inline void create_directories(const std::string &dir_path) {
     create_dirs_impl(dir_path);
 }
 
+#ifndef _WIN32
+
+/**
+ * Makes the file path absolute and removes its dot components and repeated
+ * slashes, without resolving symbolic links.
+ * @param file_path Path of the file.
+ * @return Normalized path of the file.
+ */
+inline auto normalize_file_path(const std::string &file_path) -> std::string {
+    // std
+    using std::string;
+    using std::vector;
+
+    string full_path = file_path;
+
+    if (file_path.empty() || file_path.front() != '/') {
+        char cwd[4096];
+
+        if (getcwd(cwd, sizeof(cwd)) != nullptr) {
+            full_path = string(cwd) + '/' + file_path;
+        }
+    }
+
+    vector<string> components;
+    size_t begin = 0;
+
+    while (begin <= full_path.size()) {
+        auto end = full_path.find('/', begin);
+
+        if (end == string::npos) {
+            end = full_path.size();
+        }
+
+        const auto component = full_path.substr(begin, end - begin);
+
+        if (component == "..") {
+            if (!components.empty()) {
+                components.pop_back();
+            }
+        } else if (!component.empty() && component != ".") {
+            components.push_back(component);
+        }
+
+        begin = end + 1;
+    }
+
+    string normalized_path =
+        !full_path.empty() && full_path.front() == '/' ? "" : ".";
+
+    for (const auto &component : components) {
+        normalized_path += '/' + component;
+    }
+
+    return normalized_path;
+}
+
+#endif
+
+/**
+ * Resolves the file path into an absolute path, with symbolic links and dot
+ * components resolved on POSIX, so that different spellings of the same file
+ * compare equal. The file itself does not need to exist, only its directory.
+ * @param file_path Path of the file.
+ * @return Canonical path of the file, or the path itself if it cannot be
+ * resolved.
+ */
+inline auto canonical_file_path(const std::string &file_path) -> std::string {
+    // std
+    using std::string;
+
+#ifdef _WIN32
+    char full_path[_MAX_PATH];
+
+    return _fullpath(full_path, file_path.c_str(), _MAX_PATH) != nullptr
+               ? string(full_path)
+               : file_path;
+#else
+    const auto resolve = [](const string &path) -> string {
+        const auto resolved = realpath(path.c_str(), nullptr);
+
+        if (!resolved) {
+            return "";
+        }
+
+        const string resolved_path(resolved);
+        std::free(resolved);
+        return resolved_path;
+    };
+
+    const auto resolved_file_path = resolve(file_path);
+
+    if (!resolved_file_path.empty()) {
+        return resolved_file_path;
+    }
+
+    // resolve the directory instead for files that are not created yet
+    const auto last_slash_index = file_path.find_last_of('/');
+
+    const auto dir_path =
+        last_slash_index == string::npos
+            ? string(".")
+            : last_slash_index == 0 ? string("/")
+                                    : file_path.substr(0, last_slash_index);
+
+    const auto resolved_dir_path = resolve(dir_path);
+
+    if (resolved_dir_path.empty()) {
+        // directory not created yet, so only dot components are resolved
+        return normalize_file_path(file_path);
+    }
+
+    const auto file_name = last_slash_index == string::npos
+                               ? file_path
+                               : file_path.substr(last_slash_index + 1);
+
+    return resolved_dir_path.back() == '/'
+               ? resolved_dir_path + file_name
+               : resolved_dir_path + '/' + file_name;
+#endif
+}
+
 inline auto
 find_item_iter_by_name(cpptoml::table_array &items, const std::string &name)
     -> cpptoml::table_array::iterator {
@@ -320,103 +655,165 @@ inline void write_to_config_file(
     using fmt::format;
 
     // std
-    using std::ofstream;
-
-    ofstream override_str(toml_path);
-
-    if (!override_str) {
-        throw setup_error(format("Unable to open '{}' for writing", toml_path));
-    }
+    using std::ostringstream;
 
+    ostringstream override_str;
     auto writer = cpptoml::toml_writer(override_str);
     writer.visit(config);
+
+    // readers never see a partially written file
+    write_file_atomically(toml_path, override_str.str());
 }
 
-template <class... Ps>
-void read_template_file_into_stringstream(
-    std::stringstream &toml_ss, const std::string &file_path, Ps &&... ps) {
+inline auto parse_toml(const char *data, const size_t size)
+    -> std::shared_ptr<cpptoml::table> {
 
-    // fmt
-    using fmt::format;
+    // std
+    using std::istream;
+
+    memory_streambuf toml_buf(data, size);
+    istream toml_stream(&toml_buf);
+
+    cpptoml::parser parser(toml_stream);
+    return parser.parse();
+}
+
+inline auto parse_toml_file(const std::string &toml_path)
+    -> std::shared_ptr<cpptoml::table> {
+
+    const mapped_file toml_file(toml_path);
+    return parse_toml(toml_file.data(), toml_file.size());
+}
+
+template <class... Ps>
+void render_template_file(
+    std::string &toml_buffer, const std::string &file_path, Ps &&... ps) {
 
     // std
+    using std::back_inserter;
     using std::exception;
     using std::forward;
-    using std::ifstream;
-    using std::move;
-    using std::string;
-    using std::stringstream;
 
     try {
-        ifstream file_stream(file_path);
+        const mapped_file pre_toml_file(file_path);
 
-        if (!file_stream) {
-            throw setup_error(format("Error reading file at '{}'", file_path));
-        }
+        // the buffer is reused across files, keeping its capacity
+        toml_buffer.clear();
+        toml_buffer.reserve(pre_toml_file.size());
 
-        stringstream pre_toml_ss;
-        pre_toml_ss << file_stream.rdbuf();
+        fmt::format_to(
+            back_inserter(toml_buffer),
+            fmt::string_view(pre_toml_file.data(), pre_toml_file.size()),
+            forward<Ps>(ps)...);
+    } catch (const exception &e) {
+        throw setup_error(e.what());
+    }
+}
 
-        const auto pre_toml_content = pre_toml_ss.str();
+/**
+ * Index of table array items by their name, keeping the first item for any
+ * repeated name, which is the item find_item_by_name would return.
+ */
+using item_name_index =
+    std::unordered_map<std::string, std::shared_ptr<cpptoml::table>>;
 
-        const auto toml_content =
-            format(pre_toml_content, std::forward<Ps>(ps)...);
+inline auto index_items_by_name(const cpptoml::table_array &items)
+    -> item_name_index {
 
-        toml_ss << toml_content;
-    } catch (const exception &e) {
-        throw setup_error(e.what());
+    using names::NAME;
+
+    // std
+    using std::string;
+
+    item_name_index index;
+    index.reserve(items.get().size());
+
+    for (const auto &item : items) {
+        const auto item_name_opt = item->get_as<string>(NAME);
+
+        if (item_name_opt) {
+            index.emplace(*item_name_opt, item);
+        }
     }
+
+    return index;
 }
 
 inline void merge_config_items(
-    cpptoml::table &base_ref,
-    const std::shared_ptr<cpptoml::table_array> &base_items,
-    const std::shared_ptr<cpptoml::table_array> &ovr_items) {
+    cpptoml::table_array &base_items_ref,
+    item_name_index &base_index,
+    const cpptoml::table_array &ovr_items_ref) {
 
     using names::NAME;
 
     // std
     using std::string;
 
-    if (base_items && ovr_items) {
-        auto &base_items_ref = *base_items;
-        const auto &ovr_items_ref = *ovr_items;
+    for (const auto &ovr_item : ovr_items_ref) {
+        const auto &ovr_item_ref = *ovr_item;
+        const auto ovr_name_opt = ovr_item->get_as<string>(NAME);
+
+        if (!ovr_name_opt) {
+            throw setup_error(
+                "One of the items in override does not have a name");
+        }
+
+        const auto &ovr_name = *ovr_name_opt;
+        const auto found_base_item_it = base_index.find(ovr_name);
 
-        for (const auto &ovr_item : ovr_items_ref) {
-            const auto &ovr_item_ref = *ovr_item;
-            const auto ovr_name_opt = ovr_item->get_as<string>(NAME);
+        if (found_base_item_it != base_index.end()) {
+            // merge from override to base
+            auto &found_base_item_ref = *found_base_item_it->second;
 
-            if (!ovr_name_opt) {
-                throw setup_error(
-                    "One of the items in override does not have a name");
+            for (const auto &ovr_item_kv : ovr_item_ref) {
+                found_base_item_ref.insert(
+                    ovr_item_kv.first, ovr_item_kv.second);
             }
+        } else {
+            // insert new override item entry
+            base_items_ref.push_back(ovr_item);
+            base_index.emplace(ovr_name, ovr_item);
+        }
+    }
+}
+
+inline void merge_config_table_arrays(
+    cpptoml::table &base_ref,
+    const char table_name[],
+    const std::vector<std::shared_ptr<cpptoml::table>> &ovrs) {
 
-            const auto &ovr_name = *ovr_name_opt;
+    // std
+    using std::shared_ptr;
 
-            const auto found_base_item =
-                find_item_by_name(base_items_ref, ovr_name);
+    shared_ptr<cpptoml::table_array> base_items;
+    item_name_index base_index;
 
-            if (found_base_item) {
-                // merge from override to base
-                auto &found_base_item_ref = *found_base_item;
+    for (const auto &ovr : ovrs) {
+        const auto ovr_items = ovr->get_table_array(table_name);
 
-                for (const auto &ovr_item_kv : ovr_item_ref) {
-                    found_base_item_ref.insert(
-                        ovr_item_kv.first, ovr_item_kv.second);
-                }
+        if (!ovr_items) {
+            continue;
+        }
+
+        // the index is built once and kept up to date across all layers
+        if (!base_items) {
+            base_items = base_ref.get_table_array(table_name);
+
+            if (base_items) {
+                base_index = index_items_by_name(*base_items);
             } else {
-                // insert new override item entry
-                base_items_ref.push_back(ovr_item);
+                base_items = cpptoml::make_table_array();
+                base_ref.insert(table_name, base_items);
             }
         }
-    } else if (!base_items && ovr_items) {
-        base_ref.insert(names::LOGGER_TABLE, ovr_items);
+
+        merge_config_items(*base_items, base_index, *ovr_items);
     }
 }
 
-inline void merge_config_root(
+inline void merge_config_layers(
     const std::shared_ptr<cpptoml::table> &base,
-    const std::shared_ptr<cpptoml::table> &ovr) {
+    const std::vector<std::shared_ptr<cpptoml::table>> &ovrs) {
 
     using names::LOGGER_TABLE;
     using names::PATTERN_TABLE;
@@ -426,30 +823,26 @@ inline void merge_config_root(
         throw setup_error("Base config cannot be null for merging");
     }
 
-    if (!ovr) {
-        throw setup_error("Override config cannot be null for merging");
+    for (const auto &ovr : ovrs) {
+        if (!ovr) {
+            throw setup_error("Override config cannot be null for merging");
+        }
     }
 
     auto &base_ref = *base;
-    const auto &ovr_ref = *ovr;
 
     // directly target items to merge
+    merge_config_table_arrays(base_ref, SINK_TABLE, ovrs);
+    merge_config_table_arrays(base_ref, PATTERN_TABLE, ovrs);
+    merge_config_table_arrays(base_ref, LOGGER_TABLE, ovrs);
+}
 
-    // sinks
-    const auto base_sinks = base_ref.get_table_array(names::SINK_TABLE);
-    const auto ovr_sinks = ovr_ref.get_table_array(names::SINK_TABLE);
-    merge_config_items(base_ref, base_sinks, ovr_sinks);
-
-    // patterns
-    const auto base_patterns = base_ref.get_table_array(names::PATTERN_TABLE);
-    const auto ovr_patterns = ovr_ref.get_table_array(names::PATTERN_TABLE);
-    merge_config_items(base_ref, base_patterns, ovr_patterns);
+inline void merge_config_root(
+    const std::shared_ptr<cpptoml::table> &base,
+    const std::shared_ptr<cpptoml::table> &ovr) {
 
-    // loggers
-    const auto base_loggers = base_ref.get_table_array(names::LOGGER_TABLE);
-    const auto ovr_loggers = ovr_ref.get_table_array(names::LOGGER_TABLE);
-    merge_config_items(base_ref, base_loggers, ovr_loggers);
-} // namespace details
+    merge_config_layers(base, {ovr});
+}
 
 template <class T, class Fn>
 void if_value_from_table(
@@ -604,6 +997,52 @@ inline auto parse_max_size(const std::string &max_size_str) -> uint64_t {
     }
 }
 
+inline auto parse_duration(const std::string &duration_str)
+    -> std::chrono::microseconds {
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::regex;
+    using std::regex_match;
+    using std::smatch;
+    using std::stoull;
+    using std::string;
+    using std::chrono::duration_cast;
+    using std::chrono::hours;
+    using std::chrono::microseconds;
+    using std::chrono::milliseconds;
+    using std::chrono::minutes;
+    using std::chrono::seconds;
+
+    static const regex RE(R"_(^\s*(\d{1,12})\s*(us|ms|s|min|h)\s*$)_");
+
+    smatch matches;
+
+    if (!regex_match(duration_str, matches, RE)) {
+        throw setup_error(format(
+            "Invalid duration '{}', expected for example \"250ms\" or "
+            "\"5s\" (us | ms | s | min | h)",
+            duration_str));
+    }
+
+    const auto count = stoull(matches[1]);
+    const string unit = matches[2];
+
+    if (unit == "us") {
+        return microseconds(count);
+    } else if (unit == "ms") {
+        return duration_cast<microseconds>(milliseconds(count));
+    } else if (unit == "s") {
+        return duration_cast<microseconds>(seconds(count));
+    } else if (unit == "min") {
+        return duration_cast<microseconds>(minutes(count));
+    }
+
+    return duration_cast<microseconds>(hours(count));
+}
+
 inline auto sink_type_from_str(const std::string &type) -> sink_type {
     // fmt
     using fmt::format;
@@ -627,6 +1066,10 @@ inline auto sink_type_from_str(const std::string &type) -> sink_type {
         {"rotating_file_sink_mt", sink_type::RotatingFileSinkMt},
         {"daily_file_sink_st", sink_type::DailyFileSinkSt},
         {"daily_file_sink_mt", sink_type::DailyFileSinkMt},
+        {"mmap_file_sink_st", sink_type::MmapFileSinkSt},
+        {"mmap_file_sink_mt", sink_type::MmapFileSinkMt},
+        {"uring_file_sink_st", sink_type::UringFileSinkSt},
+        {"uring_file_sink_mt", sink_type::UringFileSinkMt},
         {"null_sink_st", sink_type::NullSinkSt},
         {"null_sink_mt", sink_type::NullSinkMt},
 #ifdef SPDLOG_ENABLE_SYSLOG
@@ -713,65 +1156,535 @@ inline auto level_to_str(const spdlog::level::level_enum level) -> std::string {
     }
 }
 
-inline void set_sink_level_if_present(
-    const std::shared_ptr<cpptoml::table> &sink_table,
-    const std::shared_ptr<spdlog::sinks::sink> &sink) {
+/**
+ * Checks if both configuration tables are structurally equal, without
+ * considering the values of the given keys.
+ * @param lhs First table.
+ * @param rhs Second table.
+ * @param ignored_keys Keys whose values are not compared.
+ * @return true if both are equal apart from the ignored keys.
+ */
+auto config_tables_equal_except(
+    const cpptoml::table &lhs,
+    const cpptoml::table &rhs,
+    const std::vector<std::string> &ignored_keys) -> bool;
 
-    using names::LEVEL;
+/**
+ * Checks if both configuration nodes are structurally equal, regardless of
+ * the order of keys within tables.
+ * @param lhs First node, may be nullptr.
+ * @param rhs Second node, may be nullptr.
+ * @return true if both are equal or both are nullptr, otherwise false.
+ */
+inline auto config_nodes_equal(
+    const std::shared_ptr<cpptoml::base> &lhs,
+    const std::shared_ptr<cpptoml::base> &rhs) -> bool {
 
     // std
+    using std::ostringstream;
     using std::string;
 
-    if_value_from_table<string>(
-        sink_table, LEVEL, [&sink](const string &level) {
-            const auto level_enum = level_from_str(level);
-            sink->set_level(level_enum);
-        });
-}
+    if (!lhs || !rhs) {
+        return lhs == rhs;
+    }
 
-template <class BasicFileSink>
-auto setup_basic_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
-    -> std::shared_ptr<spdlog::sinks::sink> {
+    if (lhs->is_table()) {
+        return rhs->is_table() &&
+               config_tables_equal_except(
+                   *lhs->as_table(), *rhs->as_table(), {});
+    }
 
-    using names::FILENAME;
-    using names::LEVEL;
-    using names::TRUNCATE;
+    if (lhs->is_table_array()) {
+        if (!rhs->is_table_array()) {
+            return false;
+        }
 
-    // fmt
-    using fmt::format;
+        const auto &lhs_items = lhs->as_table_array()->get();
+        const auto &rhs_items = rhs->as_table_array()->get();
 
-    // std
-    using std::make_shared;
-    using std::string;
+        if (lhs_items.size() != rhs_items.size()) {
+            return false;
+        }
 
-    static constexpr auto DEFAULT_TRUNCATE = false;
+        for (size_t i = 0; i < lhs_items.size(); ++i) {
+            if (!config_tables_equal_except(
+                    *lhs_items[i], *rhs_items[i], {})) {
+                return false;
+            }
+        }
 
-    const auto filename = value_from_table<string>(
-        sink_table,
-        FILENAME,
-        format(
-            "Missing '{}' field of string value for basic_file_sink",
-            FILENAME));
+        return true;
+    }
 
-    // must create the directory before creating the sink
-    create_parent_dir_if_present(sink_table, filename);
+    if (lhs->is_array()) {
+        if (!rhs->is_array()) {
+            return false;
+        }
 
-    const auto truncate =
-        value_from_table_or<bool>(sink_table, TRUNCATE, DEFAULT_TRUNCATE);
+        const auto &lhs_items = lhs->as_array()->get();
+        const auto &rhs_items = rhs->as_array()->get();
 
-    return make_shared<BasicFileSink>(filename, truncate);
-}
+        if (lhs_items.size() != rhs_items.size()) {
+            return false;
+        }
 
-template <class RotatingFileSink>
-auto setup_rotating_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
-    -> std::shared_ptr<spdlog::sinks::sink> {
+        for (size_t i = 0; i < lhs_items.size(); ++i) {
+            if (!config_nodes_equal(lhs_items[i], rhs_items[i])) {
+                return false;
+            }
+        }
 
-    using names::BASE_FILENAME;
-    using names::MAX_FILES;
-    using names::MAX_SIZE;
+        return true;
+    }
 
-    // fmt
-    using fmt::format;
+    if (!rhs->is_value()) {
+        return false;
+    }
+
+    if (const auto lhs_str = lhs->as<string>()) {
+        const auto rhs_str = rhs->as<string>();
+        return rhs_str && lhs_str->get() == rhs_str->get();
+    }
+
+    if (const auto lhs_int = lhs->as<int64_t>()) {
+        const auto rhs_int = rhs->as<int64_t>();
+        return rhs_int && lhs_int->get() == rhs_int->get();
+    }
+
+    if (const auto lhs_bool = lhs->as<bool>()) {
+        const auto rhs_bool = rhs->as<bool>();
+        return rhs_bool && lhs_bool->get() == rhs_bool->get();
+    }
+
+    // floating point and date time values are rare enough in configurations
+    // to be compared by their TOML representation
+    ostringstream lhs_ostr;
+    ostringstream rhs_ostr;
+    lhs_ostr << *lhs;
+    rhs_ostr << *rhs;
+    return lhs_ostr.str() == rhs_ostr.str();
+}
+
+inline auto config_tables_equal_except(
+    const cpptoml::table &lhs,
+    const cpptoml::table &rhs,
+    const std::vector<std::string> &ignored_keys) -> bool {
+
+    // std
+    using std::find;
+    using std::string;
+
+    const auto is_ignored = [&ignored_keys](const string &key) {
+        return find(ignored_keys.cbegin(), ignored_keys.cend(), key) !=
+               ignored_keys.cend();
+    };
+
+    size_t lhs_count = 0;
+
+    for (const auto &entry : lhs) {
+        if (is_ignored(entry.first)) {
+            continue;
+        }
+
+        if (!rhs.contains(entry.first) ||
+            !config_nodes_equal(entry.second, rhs.get(entry.first))) {
+            return false;
+        }
+
+        ++lhs_count;
+    }
+
+    size_t rhs_count = 0;
+
+    for (const auto &entry : rhs) {
+        if (!is_ignored(entry.first)) {
+            ++rhs_count;
+        }
+    }
+
+    return lhs_count == rhs_count;
+}
+
+/**
+ * Checks if both file sink tables define the same file sink, apart from the
+ * sink name, level, flush interval and the spelling of the file path.
+ * @param lhs First sink table.
+ * @param rhs Second sink table.
+ * @return true if a sink built from either table can serve both.
+ */
+inline auto
+file_sink_tables_equal(const cpptoml::table &lhs, const cpptoml::table &rhs)
+    -> bool {
+
+    using names::BASE_FILENAME;
+    using names::CREATE_PARENT_DIR;
+    using names::FILENAME;
+    using names::FLUSH_INTERVAL;
+    using names::LEVEL;
+    using names::NAME;
+
+    return config_tables_equal_except(
+        lhs,
+        rhs,
+        {NAME,
+         LEVEL,
+         FLUSH_INTERVAL,
+         CREATE_PARENT_DIR,
+         FILENAME,
+         BASE_FILENAME});
+}
+
+/**
+ * Describes an entry of the file sink registry. The entry has its own mutex so
+ * that opening one file does not hold up opening other files.
+ */
+struct file_sink_slot {
+    std::mutex mutex;
+    std::weak_ptr<spdlog::sinks::sink> sink;
+
+    /** Copy of the sink table that the sink was built from. */
+    std::shared_ptr<cpptoml::table> definition;
+};
+
+/**
+ * Returns the process-wide registry of file sinks, keyed by canonical file
+ * path.
+ * @return File sink registry, to be accessed only while holding
+ * file_sinks_mutex().
+ */
+inline auto file_sinks_registry()
+    -> std::unordered_map<std::string, std::shared_ptr<file_sink_slot>> & {
+
+    static std::unordered_map<std::string, std::shared_ptr<file_sink_slot>>
+        registry;
+
+    return registry;
+}
+
+/**
+ * Returns the mutex guarding file_sinks_registry().
+ * @return Mutex of the file sink registry.
+ */
+inline auto file_sinks_mutex() -> std::mutex & {
+    static std::mutex mutex;
+    return mutex;
+}
+
+/**
+ * Returns the file sink that is still in use for the same file if it was
+ * built from an equal definition, otherwise creates and registers a new one.
+ * Sharing the sink makes writes from every configuration go through one file
+ * handle and lock, and rotates the file only once. Single-threaded sinks have
+ * no lock, so they are never shared. A file that is still written by a sink
+ * of another type, with other file parameters, or by a single-threaded sink is
+ * never opened a second time, since the sinks would interleave their writes
+ * and could truncate or rotate the file under each other.
+ * @param sink_table Sink table the sink is defined by.
+ * @param filename Path of the file, whose directory must already exist.
+ * @param make_sink Function creating the sink when none is in use.
+ * @return Sink for the file.
+ * @throw setup_error if the file is still written by a sink that cannot be
+ * shared.
+ */
+template <class FileSink, class MakeSink>
+auto shared_file_sink(
+    const std::shared_ptr<cpptoml::table> &sink_table,
+    const std::string &filename,
+    MakeSink &&make_sink) -> std::shared_ptr<spdlog::sinks::sink> {
+
+    using names::NAME;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::is_base_of;
+    using std::lock_guard;
+    using std::make_shared;
+    using std::mutex;
+    using std::shared_ptr;
+    using std::string;
+
+    static constexpr auto SINGLE_THREADED = is_base_of<
+        spdlog::sinks::base_sink<spdlog::details::null_mutex>,
+        FileSink>::value;
+
+    const auto key = canonical_file_path(filename);
+
+    shared_ptr<file_sink_slot> slot;
+
+    {
+        lock_guard<mutex> lock(file_sinks_mutex());
+        auto &registry = file_sinks_registry();
+
+        // prune slots that are neither in use nor being filled
+        for (auto itr = registry.begin(); itr != registry.end();) {
+            if (itr->second.use_count() == 1 && itr->second->sink.expired()) {
+                itr = registry.erase(itr);
+            } else {
+                ++itr;
+            }
+        }
+
+        auto &registered_slot = registry[key];
+
+        if (!registered_slot) {
+            registered_slot = make_shared<file_sink_slot>();
+        }
+
+        slot = registered_slot;
+    }
+
+    lock_guard<mutex> slot_lock(slot->mutex);
+
+    if (auto sink = slot->sink.lock()) {
+        const auto owner_name_opt = slot->definition->get_as<string>(NAME);
+        const auto owner_name = owner_name_opt ? *owner_name_opt : string();
+
+        if (!file_sink_tables_equal(*slot->definition, *sink_table)) {
+            throw setup_error(format(
+                "File '{}' is still written by sink '{}' of another type or "
+                "with other file parameters",
+                filename,
+                owner_name));
+        }
+
+        if (SINGLE_THREADED) {
+            throw setup_error(format(
+                "File '{}' is still written by the single-threaded sink '{}', "
+                "which cannot be shared",
+                filename,
+                owner_name));
+        }
+
+        return sink;
+    }
+
+    auto sink = make_sink();
+    slot->sink = sink;
+    slot->definition = sink_table->clone()->as_table();
+    return sink;
+}
+
+inline void set_sink_level_if_present(
+    const std::shared_ptr<cpptoml::table> &sink_table,
+    const std::shared_ptr<spdlog::sinks::sink> &sink) {
+
+    using names::LEVEL;
+
+    // std
+    using std::string;
+
+    if_value_from_table<string>(
+        sink_table, LEVEL, [&sink](const string &level) {
+            const auto level_enum = level_from_str(level);
+            sink->set_level(level_enum);
+        });
+}
+
+inline auto
+file_buffering_from_table(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> file_buffering {
+
+    using names::BUFFER_SIZE;
+    using names::DIRECT_IO;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    file_buffering buffering;
+
+    buffering.direct_io =
+        value_from_table_or<bool>(sink_table, DIRECT_IO, false);
+
+    buffering.buffered =
+        buffering.direct_io || sink_table->contains(BUFFER_SIZE);
+
+    const auto buffer_size = parse_max_size(value_from_table_or<string>(
+        sink_table, BUFFER_SIZE, defaults::FILE_BUFFER_SIZE));
+
+    if (buffer_size == 0) {
+        throw setup_error(format("'{}' must be greater than 0", BUFFER_SIZE));
+    }
+
+    buffering.buffer_size = static_cast<size_t>(buffer_size);
+    return buffering;
+}
+
+template <class BasicFileSink, class BufferedFileSink>
+auto setup_basic_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> std::shared_ptr<spdlog::sinks::sink> {
+
+    using names::FILENAME;
+    using names::LEVEL;
+    using names::TRUNCATE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::make_shared;
+    using std::string;
+
+    static constexpr auto DEFAULT_TRUNCATE = false;
+
+    const auto filename = value_from_table<string>(
+        sink_table,
+        FILENAME,
+        format(
+            "Missing '{}' field of string value for basic_file_sink",
+            FILENAME));
+
+    // must create the directory before creating the sink
+    create_parent_dir_if_present(sink_table, filename);
+
+    const auto truncate =
+        value_from_table_or<bool>(sink_table, TRUNCATE, DEFAULT_TRUNCATE);
+
+    const auto buffering = file_buffering_from_table(sink_table);
+
+    if (buffering.buffered) {
+        return shared_file_sink<BufferedFileSink>(
+            sink_table, filename, [&filename, &buffering, truncate] {
+                return make_shared<BufferedFileSink>(
+                    filename,
+                    buffering.buffer_size,
+                    buffering.direct_io,
+                    truncate);
+            });
+    }
+
+    return shared_file_sink<BasicFileSink>(
+        sink_table, filename, [&filename, truncate] {
+            return make_shared<BasicFileSink>(filename, truncate);
+        });
+}
+
+template <class MmapFileSink>
+auto setup_mmap_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> std::shared_ptr<spdlog::sinks::sink> {
+
+    using names::CHUNK_SIZE;
+    using names::FILENAME;
+    using names::TRUNCATE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::make_shared;
+    using std::string;
+
+    // bounds the zero padding that readers see, and that a crash leaves
+    // behind, while remapping only once per chunk
+    static constexpr auto DEFAULT_CHUNK_SIZE = "1M";
+    static constexpr auto DEFAULT_TRUNCATE = false;
+
+    const auto filename = value_from_table<string>(
+        sink_table,
+        FILENAME,
+        format(
+            "Missing '{}' field of string value for mmap_file_sink",
+            FILENAME));
+
+    const auto chunk_size = parse_max_size(value_from_table_or<string>(
+        sink_table, CHUNK_SIZE, DEFAULT_CHUNK_SIZE));
+
+    if (chunk_size == 0) {
+        throw setup_error(format(
+            "'{}' of mmap_file_sink must be greater than 0", CHUNK_SIZE));
+    }
+
+    // must create the directory before creating the sink
+    create_parent_dir_if_present(sink_table, filename);
+
+    const auto truncate =
+        value_from_table_or<bool>(sink_table, TRUNCATE, DEFAULT_TRUNCATE);
+
+    return shared_file_sink<MmapFileSink>(
+        sink_table, filename, [&filename, chunk_size, truncate] {
+            return make_shared<MmapFileSink>(filename, chunk_size, truncate);
+        });
+}
+
+template <class UringFileSink>
+auto setup_uring_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> std::shared_ptr<spdlog::sinks::sink> {
+
+    using names::BUFFERS_IN_FLIGHT;
+    using names::FILENAME;
+    using names::TRUNCATE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::make_shared;
+    using std::string;
+
+    static constexpr auto DEFAULT_TRUNCATE = false;
+    static constexpr int64_t MAX_FILE_BUFFERS_IN_FLIGHT = 32768;
+
+    const auto filename = value_from_table<string>(
+        sink_table,
+        FILENAME,
+        format(
+            "Missing '{}' field of string value for uring_file_sink",
+            FILENAME));
+
+    const auto buffering = file_buffering_from_table(sink_table);
+
+    // the buffers of io_uring are written through the page cache
+    if (buffering.direct_io) {
+        throw setup_error(format(
+            "'{}' is not supported by uring_file_sink", names::DIRECT_IO));
+    }
+
+    const auto buffers_in_flight = value_from_table_or<int64_t>(
+        sink_table, BUFFERS_IN_FLIGHT, defaults::FILE_BUFFERS_IN_FLIGHT);
+
+    // io_uring_setup fails with EINVAL beyond its maximum number of entries
+    if (buffers_in_flight < 1 ||
+        buffers_in_flight > MAX_FILE_BUFFERS_IN_FLIGHT) {
+
+        throw setup_error(format(
+            "'{}' must be between 1 and {}, but {} found",
+            BUFFERS_IN_FLIGHT,
+            MAX_FILE_BUFFERS_IN_FLIGHT,
+            buffers_in_flight));
+    }
+
+    // must create the directory before creating the sink
+    create_parent_dir_if_present(sink_table, filename);
+
+    const auto truncate =
+        value_from_table_or<bool>(sink_table, TRUNCATE, DEFAULT_TRUNCATE);
+
+    return shared_file_sink<UringFileSink>(
+        sink_table,
+        filename,
+        [&filename, &buffering, buffers_in_flight, truncate] {
+            return make_shared<UringFileSink>(
+                filename,
+                buffering.buffer_size,
+                static_cast<size_t>(buffers_in_flight),
+                truncate);
+        });
+}
+
+template <class RotatingFileSink, class BufferedRotatingFileSink>
+auto setup_rotating_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> std::shared_ptr<spdlog::sinks::sink> {
+
+    using names::BASE_FILENAME;
+    using names::MAX_FILES;
+    using names::MAX_SIZE;
+
+    // fmt
+    using fmt::format;
 
     // std
     using std::make_shared;
@@ -803,11 +1716,30 @@ auto setup_rotating_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
             "Missing '{}' field of u64 value for rotating_file_sink",
             MAX_FILES));
 
-    return make_shared<RotatingFileSink>(
-        base_filename, max_filesize, max_files);
+    const auto buffering = file_buffering_from_table(sink_table);
+
+    if (buffering.buffered) {
+        return shared_file_sink<BufferedRotatingFileSink>(
+            sink_table,
+            base_filename,
+            [&base_filename, &buffering, max_filesize, max_files] {
+                return make_shared<BufferedRotatingFileSink>(
+                    base_filename,
+                    max_filesize,
+                    max_files,
+                    buffering.buffer_size,
+                    buffering.direct_io);
+            });
+    }
+
+    return shared_file_sink<RotatingFileSink>(
+        sink_table, base_filename, [&base_filename, max_filesize, max_files] {
+            return make_shared<RotatingFileSink>(
+                base_filename, max_filesize, max_files);
+        });
 }
 
-template <class DailyFileSink>
+template <class DailyFileSink, class BufferedDailyFileSink>
 auto setup_daily_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
     -> std::shared_ptr<spdlog::sinks::sink> {
 
@@ -846,13 +1778,34 @@ auto setup_daily_file_sink(const std::shared_ptr<cpptoml::table> &sink_table)
             "Missing '{}' field of string value for daily_file_sink",
             ROTATION_MINUTE));
 
-    return make_shared<DailyFileSink>(
-        base_filename, rotation_hour, rotation_minute);
-}
-
-#ifdef SPDLOG_ENABLE_SYSLOG
+    const auto buffering = file_buffering_from_table(sink_table);
 
-template <class SyslogSink>
+    if (buffering.buffered) {
+        return shared_file_sink<BufferedDailyFileSink>(
+            sink_table,
+            base_filename,
+            [&base_filename, &buffering, rotation_hour, rotation_minute] {
+                return make_shared<BufferedDailyFileSink>(
+                    base_filename,
+                    rotation_hour,
+                    rotation_minute,
+                    buffering.buffer_size,
+                    buffering.direct_io);
+            });
+    }
+
+    return shared_file_sink<DailyFileSink>(
+        sink_table,
+        base_filename,
+        [&base_filename, rotation_hour, rotation_minute] {
+            return make_shared<DailyFileSink>(
+                base_filename, rotation_hour, rotation_minute);
+        });
+}
+
+#ifdef SPDLOG_ENABLE_SYSLOG
+
+template <class SyslogSink>
 auto setup_syslog_sink(const std::shared_ptr<cpptoml::table> &sink_table)
     -> std::shared_ptr<spdlog::sinks::sink> {
 
@@ -953,186 +1906,1313 @@ inline auto sink_from_sink_type(
     case sink_type::ColorStderrSinkMt:
         return make_shared<color_stderr_sink_mt>();
 
-    case sink_type::BasicFileSinkSt:
-        return setup_basic_file_sink<basic_file_sink_st>(sink_table);
+    case sink_type::BasicFileSinkSt:
+        return setup_basic_file_sink<basic_file_sink_st, buffered_file_sink_st>(
+            sink_table);
+
+    case sink_type::BasicFileSinkMt:
+        return setup_basic_file_sink<basic_file_sink_mt, buffered_file_sink_mt>(
+            sink_table);
+
+    case sink_type::RotatingFileSinkSt:
+        return setup_rotating_file_sink<
+            rotating_file_sink_st,
+            buffered_rotating_file_sink_st>(sink_table);
+
+    case sink_type::RotatingFileSinkMt:
+        return setup_rotating_file_sink<
+            rotating_file_sink_mt,
+            buffered_rotating_file_sink_mt>(sink_table);
+
+    case sink_type::DailyFileSinkSt:
+        return setup_daily_file_sink<
+            daily_file_sink_st,
+            buffered_daily_file_sink_st>(sink_table);
+
+    case sink_type::DailyFileSinkMt:
+        return setup_daily_file_sink<
+            daily_file_sink_mt,
+            buffered_daily_file_sink_mt>(sink_table);
+
+    case sink_type::MmapFileSinkSt:
+        return setup_mmap_file_sink<mmap_file_sink_st>(sink_table);
+
+    case sink_type::MmapFileSinkMt:
+        return setup_mmap_file_sink<mmap_file_sink_mt>(sink_table);
+
+    case sink_type::UringFileSinkSt:
+        return setup_uring_file_sink<uring_file_sink_st>(sink_table);
+
+    case sink_type::UringFileSinkMt:
+        return setup_uring_file_sink<uring_file_sink_mt>(sink_table);
+
+    case sink_type::NullSinkSt:
+        return make_shared<null_sink_st>();
+
+    case sink_type::NullSinkMt:
+        return make_shared<null_sink_mt>();
+
+#ifdef SPDLOG_ENABLE_SYSLOG
+    case sink_type::SyslogSinkSt:
+        return setup_syslog_sink<syslog_sink_st>(sink_table);
+
+    case sink_type::SyslogSinkMt:
+        return setup_syslog_sink<syslog_sink_mt>(sink_table);
+#endif
+
+#ifdef _WIN32
+    case sink_type::MSVCSinkSt:
+        return make_shared<msvc_sink_st>();
+    case sink_type::MSVCSinkMt:
+        return make_shared<msvc_sink_mt>();
+#endif
+
+    default:
+        throw setup_error(format(
+            "Unexpected sink error with sink enum value '{}'",
+            static_cast<int>(sink_val)));
+    }
+}
+
+inline void set_logger_level_if_present(
+    const std::shared_ptr<cpptoml::table> &logger_table,
+    const std::shared_ptr<spdlog::logger> &logger) {
+
+    using names::LEVEL;
+
+    // std
+    using std::string;
+
+    if_value_from_table<string>(
+        logger_table, LEVEL, [&logger](const string &level) {
+            const auto level_enum = level_from_str(level);
+            logger->set_level(level_enum);
+        });
+}
+
+inline void set_logger_flush_level_if_present(
+    const std::shared_ptr<cpptoml::table> &logger_table,
+    const std::shared_ptr<spdlog::logger> &logger) {
+
+    using names::FLUSH_LEVEL;
+
+    // std
+    using std::string;
+
+    if_value_from_table<string>(
+        logger_table, FLUSH_LEVEL, [&logger](const string &flush_level) {
+            const auto level_enum = level_from_str(flush_level);
+            logger->flush_on(level_enum);
+        });
+}
+
+inline auto setup_sink(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> std::shared_ptr<spdlog::sinks::sink> {
+
+    using names::TYPE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::move;
+    using std::string;
+
+    const auto type_val = value_from_table<string>(
+        sink_table, TYPE, format("Sink missing '{}' field", TYPE));
+
+    const auto sink_val = sink_type_from_str(type_val);
+    auto sink = sink_from_sink_type(sink_val, sink_table);
+
+    // set optional parts and return back the same sink
+    set_sink_level_if_present(sink_table, sink);
+    track_sink(sink);
+
+    return sink;
+}
+
+inline auto is_blocking_sink_type(const sink_type sink_val) -> bool {
+    switch (sink_val) {
+    case sink_type::BasicFileSinkSt:
+    case sink_type::BasicFileSinkMt:
+    case sink_type::RotatingFileSinkSt:
+    case sink_type::RotatingFileSinkMt:
+    case sink_type::DailyFileSinkSt:
+    case sink_type::DailyFileSinkMt:
+    case sink_type::MmapFileSinkSt:
+    case sink_type::MmapFileSinkMt:
+    case sink_type::UringFileSinkSt:
+    case sink_type::UringFileSinkMt:
+        return true;
+
+    default:
+        // syslog sinks call the process-wide openlog, so are never built
+        // concurrently
+        return false;
+    }
+}
+
+inline auto is_single_threaded_file_sink_type(const sink_type sink_val)
+    -> bool {
+    switch (sink_val) {
+    case sink_type::BasicFileSinkSt:
+    case sink_type::RotatingFileSinkSt:
+    case sink_type::DailyFileSinkSt:
+    case sink_type::MmapFileSinkSt:
+    case sink_type::UringFileSinkSt:
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+inline auto
+is_single_threaded_file_sink_table(const cpptoml::table &sink_table) -> bool {
+    using names::TYPE;
+
+    // std
+    using std::string;
+
+    const auto type_opt = sink_table.get_as<string>(TYPE);
+
+    if (!type_opt) {
+        return false;
+    }
+
+    try {
+        return is_single_threaded_file_sink_type(
+            sink_type_from_str(*type_opt));
+    } catch (const setup_error &) {
+        // invalid type is reported when the sink is built
+        return false;
+    }
+}
+
+inline auto
+is_blocking_sink_table(const std::shared_ptr<cpptoml::table> &sink_table)
+    -> bool {
+
+    using names::TYPE;
+
+    // std
+    using std::string;
+
+    const auto type_opt = sink_table->get_as<string>(TYPE);
+
+    if (!type_opt) {
+        return false;
+    }
+
+    try {
+        return is_blocking_sink_type(sink_type_from_str(*type_opt));
+    } catch (const setup_error &) {
+        // invalid type is reported when the sink is built
+        return false;
+    }
+}
+
+/**
+ * Checks that sink tables naming the same file can share one file sink, which
+ * requires them to have the same type, level and file parameters, and to be
+ * used by loggers with the same patterns. Otherwise the level and pattern set
+ * last, and the file parameters of the sink built first, would silently apply
+ * to every table. Single-threaded file sinks have no lock, so they may neither
+ * share their file nor be used by more than one logger.
+ * @param config Configuration whose sink tables are checked.
+ * @throw setup_error
+ */
+inline void check_shared_file_sinks(const cpptoml::table &config) {
+    using names::BASE_FILENAME;
+    using names::CREATE_PARENT_DIR;
+    using names::FILENAME;
+    using names::FLUSH_INTERVAL;
+    using names::GLOBAL_PATTERN;
+    using names::LOGGER_TABLE;
+    using names::NAME;
+    using names::PATTERN;
+    using names::PATTERN_TABLE;
+    using names::SINK_TABLE;
+    using names::SINKS;
+    using names::VALUE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::set;
+    using std::shared_ptr;
+    using std::string;
+    using std::unordered_map;
+
+    const auto sinks = config.get_table_array(SINK_TABLE);
+
+    if (!sinks) {
+        return;
+    }
+
+    unordered_map<string, string> pattern_values;
+
+    if (const auto patterns = config.get_table_array(PATTERN_TABLE)) {
+        for (const auto &pattern_table : *patterns) {
+            const auto name_opt = pattern_table->get_as<string>(NAME);
+            const auto value_opt = pattern_table->get_as<string>(VALUE);
+
+            if (name_opt && value_opt) {
+                pattern_values.emplace(*name_opt, *value_opt);
+            }
+        }
+    }
+
+    // patterns that the loggers set on each sink, where the empty string
+    // stands for the default pattern of spdlog
+    const auto global_pattern_opt = config.get_as<string>(GLOBAL_PATTERN);
+    unordered_map<string, set<string>> sink_patterns;
+    unordered_map<string, size_t> sink_users;
+
+    if (const auto loggers = config.get_table_array(LOGGER_TABLE)) {
+        for (const auto &logger_table : *loggers) {
+            const auto sink_names = logger_table->get_array_of<string>(SINKS);
+
+            if (!sink_names) {
+                continue;
+            }
+
+            const auto pattern_name_opt = logger_table->get_as<string>(PATTERN);
+            string pattern = global_pattern_opt ? *global_pattern_opt : "";
+
+            if (pattern_name_opt) {
+                const auto pattern_itr = pattern_values.find(*pattern_name_opt);
+
+                pattern = pattern_itr != pattern_values.cend()
+                              ? pattern_itr->second
+                              : *pattern_name_opt;
+            }
+
+            for (const auto &sink_name : *sink_names) {
+                sink_patterns[sink_name].insert(pattern);
+                ++sink_users[sink_name];
+            }
+        }
+    }
+
+    unordered_map<string, shared_ptr<cpptoml::table>> sinks_by_file;
+
+    for (const auto &sink_table : *sinks) {
+        const auto name_opt = sink_table->get_as<string>(NAME);
+
+        if (!name_opt || !is_blocking_sink_table(sink_table)) {
+            continue;
+        }
+
+        auto filename_opt = sink_table->get_as<string>(FILENAME);
+
+        if (!filename_opt) {
+            filename_opt = sink_table->get_as<string>(BASE_FILENAME);
+        }
+
+        // missing fields are reported when the sink is built
+        if (!filename_opt) {
+            continue;
+        }
+
+        const auto single_threaded =
+            is_single_threaded_file_sink_table(*sink_table);
+
+        if (single_threaded && sink_users[*name_opt] > 1) {
+            throw setup_error(format(
+                "Single-threaded sink '{}' cannot be used by more than one "
+                "logger",
+                *name_opt));
+        }
+
+        const auto file_path = canonical_file_path(*filename_opt);
+        const auto first_itr = sinks_by_file.find(file_path);
+
+        if (first_itr == sinks_by_file.cend()) {
+            sinks_by_file.emplace(file_path, sink_table);
+            continue;
+        }
+
+        const auto &first_table = first_itr->second;
+        const auto first_name = *first_table->get_as<string>(NAME);
+        const auto &first_patterns = sink_patterns[first_name];
+        const auto &patterns = sink_patterns[*name_opt];
+
+        if (single_threaded ||
+            is_single_threaded_file_sink_table(*first_table)) {
+            throw setup_error(format(
+                "Sinks '{}' and '{}' share the file '{}', but a "
+                "single-threaded sink cannot share its file",
+                first_name,
+                *name_opt,
+                *filename_opt));
+        }
+
+        const auto same_definition = config_tables_equal_except(
+            *first_table,
+            *sink_table,
+            {NAME, FLUSH_INTERVAL, CREATE_PARENT_DIR, FILENAME, BASE_FILENAME});
+
+        // sinks not used by any logger keep whatever pattern is set
+        const auto same_patterns = first_patterns.empty() ||
+                                   patterns.empty() ||
+                                   first_patterns == patterns;
+
+        if (!same_definition || !same_patterns) {
+            throw setup_error(format(
+                "Sinks '{}' and '{}' share the file '{}', but differ in type, "
+                "level, file parameters or logger patterns",
+                first_name,
+                *name_opt,
+                *filename_opt));
+        }
+    }
+}
+
+template <class Fn>
+void run_indices_in_parallel(
+    const std::vector<size_t> &indices, const size_t max_threads, Fn &&fn) {
+
+    // std
+    using std::atomic;
+    using std::max;
+    using std::min;
+    using std::system_error;
+    using std::thread;
+    using std::vector;
+
+    // also keeps the count of extra threads below from wrapping around
+    if (indices.empty()) {
+        return;
+    }
+
+    atomic<size_t> next(0);
+
+    const auto work = [&indices, &next, &fn] {
+        for (auto i = next++; i < indices.size(); i = next++) {
+            fn(indices[i]);
+        }
+    };
+
+    // the calling thread also takes part in the work
+    const auto extra_threads_count =
+        min(max<size_t>(max_threads, 1), indices.size()) - 1;
+
+    vector<thread> threads;
+    threads.reserve(extra_threads_count);
+
+    for (size_t i = 0; i < extra_threads_count; ++i) {
+        try {
+            threads.emplace_back(work);
+        } catch (const system_error &) {
+            // make do with the threads that could be started
+            break;
+        }
+    }
+
+    work();
+
+    for (auto &t : threads) {
+        t.join();
+    }
+}
+
+inline auto setup_sinks_in_parallel(
+    const cpptoml::table_array &sinks, const size_t max_threads)
+    -> std::unordered_map<std::string, std::shared_ptr<spdlog::sinks::sink>> {
+
+    using names::NAME;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::current_exception;
+    using std::exception_ptr;
+    using std::move;
+    using std::rethrow_exception;
+    using std::shared_ptr;
+    using std::string;
+    using std::unordered_map;
+    using std::vector;
+
+    const auto &sink_tables = sinks.get();
+    const auto count = sink_tables.size();
+
+    vector<string> names(count);
+    vector<shared_ptr<spdlog::sinks::sink>> built_sinks(count);
+    vector<exception_ptr> errors(count);
+    vector<size_t> blocking_indices;
+
+    const auto build = [&sink_tables, &names, &built_sinks, &errors](
+                           const size_t i) {
+        try {
+            const auto &name = names[i];
+            const auto &sink_table = sink_tables[i];
+
+            built_sinks[i] = add_msg_on_err(
+                [&sink_table] { return setup_sink(sink_table); },
+                [&name](const string &err_msg) {
+                    return format("Sink '{}' error:\n > {}", name, err_msg);
+                });
+        } catch (...) {
+            errors[i] = current_exception();
+        }
+    };
+
+    // sinks that are cheap or unsafe to build concurrently are built here,
+    // while the rest is deferred to the worker threads
+    for (size_t i = 0; i < count; ++i) {
+        try {
+            const auto &sink_table = sink_tables[i];
+
+            names[i] = value_from_table<string>(
+                sink_table,
+                NAME,
+                format("One of the sinks does not have a '{}' field", NAME));
+        } catch (...) {
+            errors[i] = current_exception();
+            continue;
+        }
+
+        if (is_blocking_sink_table(sink_tables[i])) {
+            blocking_indices.push_back(i);
+        } else {
+            build(i);
+        }
+    }
+
+    run_indices_in_parallel(blocking_indices, max_threads, build);
+
+    unordered_map<string, shared_ptr<spdlog::sinks::sink>> sinks_map;
+
+    for (size_t i = 0; i < count; ++i) {
+        // report the first failing sink in file order
+        if (errors[i]) {
+            rethrow_exception(errors[i]);
+        }
+
+        sinks_map.emplace(move(names[i]), move(built_sinks[i]));
+    }
+
+    return sinks_map;
+}
+
+inline auto setup_sinks(const std::shared_ptr<cpptoml::table> &config)
+    -> std::unordered_map<std::string, std::shared_ptr<spdlog::sinks::sink>> {
+
+    using names::NAME;
+    using names::SINK_SETUP_THREADS;
+    using names::SINK_TABLE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::move;
+    using std::shared_ptr;
+    using std::string;
+    using std::unordered_map;
+
+    const auto sinks = config->get_table_array(SINK_TABLE);
+
+    if (!sinks) {
+        throw setup_error("No sinks configured for set-up");
+    }
+
+    check_shared_file_sinks(*config);
+
+    const auto sink_setup_threads = value_from_table_or<size_t>(
+        config, SINK_SETUP_THREADS, defaults::SINK_SETUP_THREADS);
+
+    if (sink_setup_threads > 1) {
+        return setup_sinks_in_parallel(*sinks, sink_setup_threads);
+    }
+
+    unordered_map<string, shared_ptr<spdlog::sinks::sink>> sinks_map;
+
+    for (const auto &sink_table : *sinks) {
+        auto name = value_from_table<string>(
+            sink_table,
+            NAME,
+            format("One of the sinks does not have a '{}' field", NAME));
+
+        auto sink = add_msg_on_err(
+            [&sink_table] { return setup_sink(sink_table); },
+            [&name](const string &err_msg) {
+                return format("Sink '{}' error:\n > {}", name, err_msg);
+            });
+
+        sinks_map.emplace(move(name), move(sink));
+    }
+
+    return sinks_map;
+}
+
+inline auto setup_patterns(const std::shared_ptr<cpptoml::table> &config)
+    -> std::unordered_map<std::string, std::string> {
+
+    using names::NAME;
+    using names::PATTERN_TABLE;
+    using names::VALUE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::move;
+    using std::string;
+    using std::unordered_map;
+
+    // possible to return an entire empty pattern map
+    unordered_map<string, string> patterns_map;
+
+    const auto patterns = config->get_table_array(PATTERN_TABLE);
+
+    if (patterns) {
+        for (const auto &pattern_table : *patterns) {
+            auto name = value_from_table<string>(
+                pattern_table,
+                NAME,
+                format("One of the patterns does not have a '{}' field", NAME));
+
+            auto value = value_from_table<string>(
+                pattern_table,
+                VALUE,
+                format("Pattern '{}' does not have '{}' field", name, VALUE));
+
+            patterns_map.emplace(move(name), move(value));
+        }
+    }
+
+    return patterns_map;
+}
+
+inline auto sched_policy_from_str(const std::string &policy) -> int {
+    // fmt
+    using fmt::format;
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+    if (policy == "other") {
+        return SCHED_OTHER;
+    } else if (policy == "batch") {
+        return SCHED_BATCH;
+    } else if (policy == "idle") {
+        return SCHED_IDLE;
+    } else if (policy == "fifo") {
+        return SCHED_FIFO;
+    } else if (policy == "rr") {
+        return SCHED_RR;
+    }
+#endif
+
+    throw setup_error(format("Invalid scheduling policy '{}' found", policy));
+}
+
+inline auto thread_scheduling_from_table(
+    const std::shared_ptr<cpptoml::table> &thread_pool_table)
+    -> thread_scheduling {
+
+    using names::CPU_AFFINITY;
+    using names::NICE;
+    using names::NUMA;
+    using names::SCHED_POLICY;
+    using names::SCHED_PRIORITY;
+    using names::THREAD_NAME;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    thread_scheduling scheduling;
+
+#ifndef SPDLOG_SETUP_THREAD_SCHEDULING
+    for (const auto field :
+         {CPU_AFFINITY,
+          NICE,
+          NUMA,
+          SCHED_POLICY,
+          SCHED_PRIORITY,
+          THREAD_NAME}) {
+
+        if (thread_pool_table->contains(field)) {
+            throw setup_error(format(
+                "'{}' is only supported on Linux with spdlog v1.5.0 onwards",
+                field));
+        }
+    }
+
+    return scheduling;
+#else
+    // either a list of CPU numbers or a string of ranges
+    const auto cpus = thread_pool_table->get_array_of<int64_t>(CPU_AFFINITY);
+
+    if (cpus) {
+        scheduling.cpus.assign(cpus->cbegin(), cpus->cend());
+    } else if (
+        const auto cpu_list_opt =
+            thread_pool_table->get_as<string>(CPU_AFFINITY)) {
+
+        scheduling.cpus = parse_cpu_list(*cpu_list_opt);
+    } else if (thread_pool_table->contains(CPU_AFFINITY)) {
+        throw setup_error(format(
+            "'{}' must be either an array of CPU numbers or a string of "
+            "CPU ranges",
+            CPU_AFFINITY));
+    }
+
+    for (const auto cpu : scheduling.cpus) {
+        if (cpu < 0 || cpu >= CPU_SETSIZE) {
+            throw setup_error(
+                format("CPU {} in '{}' is out of range", cpu, CPU_AFFINITY));
+        }
+    }
+
+    if_value_from_table<int>(
+        thread_pool_table, NICE, [&scheduling](const int nice) {
+            if (nice < -20 || nice > 19) {
+                throw setup_error(format(
+                    "'{}' must be within -20 to 19, but {} found", NICE, nice));
+            }
+
+            scheduling.has_nice = true;
+            scheduling.nice = nice;
+        });
+
+    if_value_from_table<string>(
+        thread_pool_table, SCHED_POLICY, [&scheduling](const string &policy) {
+            scheduling.has_policy = true;
+            scheduling.policy = sched_policy_from_str(policy);
+        });
+
+    scheduling.priority =
+        value_from_table_or<int>(thread_pool_table, SCHED_PRIORITY, 0);
+
+    if (thread_pool_table->contains(SCHED_PRIORITY) && !scheduling.has_policy) {
+        throw setup_error(format(
+            "'{}' requires '{}' to be set", SCHED_PRIORITY, SCHED_POLICY));
+    }
+
+    if (scheduling.has_policy) {
+        const auto min_priority = sched_get_priority_min(scheduling.policy);
+        const auto max_priority = sched_get_priority_max(scheduling.policy);
+
+        if (scheduling.priority < min_priority ||
+            scheduling.priority > max_priority) {
+            throw setup_error(format(
+                "'{}' must be within {} to {} for the policy, but {} found",
+                SCHED_PRIORITY,
+                min_priority,
+                max_priority,
+                scheduling.priority));
+        }
+    }
+
+    scheduling.thread_name =
+        value_from_table_or<string>(thread_pool_table, THREAD_NAME, "");
+
+    if_value_from_table<string>(
+        thread_pool_table, NUMA, [&scheduling](const string &numa) {
+            if (numa == names::PER_NODE) {
+                scheduling.per_numa_node = true;
+            } else if (numa != "off") {
+                throw setup_error(format(
+                    "Invalid '{}' value '{}', expected '{}' or 'off'",
+                    NUMA,
+                    numa,
+                    names::PER_NODE));
+            }
+        });
+
+    // workers are already bound to the CPUs of their node
+    if (scheduling.per_numa_node && !scheduling.cpus.empty()) {
+        throw setup_error(format(
+            "'{}' cannot be combined with '{} = \"{}\"'",
+            CPU_AFFINITY,
+            NUMA,
+            names::PER_NODE));
+    }
+
+    return scheduling;
+#endif
+}
+
+inline auto has_thread_scheduling(const thread_scheduling &scheduling) -> bool {
+    return !scheduling.cpus.empty() || scheduling.has_nice ||
+           scheduling.has_policy || !scheduling.thread_name.empty() ||
+           scheduling.per_numa_node;
+}
+
+inline auto thread_pool_queue_from_table(
+    const std::shared_ptr<cpptoml::table> &thread_pool_table)
+    -> thread_pool_queue {
+
+    using names::BATCH_SIZE;
+    using names::BLOCK;
+    using names::BLOCKING;
+    using names::LOCKFREE;
+    using names::LOGGER;
+    using names::MAX_BATCH_LATENCY_US;
+    using names::NUMA;
+    using names::PER_NODE;
+    using names::QUEUE;
+    using names::SHARDING;
+    using names::SPIN;
+    using names::SPIN_BUDGET_US;
+    using names::SPIN_THEN_BLOCK;
+    using names::WAIT_STRATEGY;
+    using names::YIELD;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    thread_pool_queue pool_queue;
+
+    if_value_from_table<string>(
+        thread_pool_table, QUEUE, [&pool_queue](const string &queue) {
+            if (queue == LOCKFREE) {
+                pool_queue.lockfree = true;
+            } else if (queue != BLOCKING) {
+                throw setup_error(format(
+                    "Invalid '{}' value '{}', expected '{}' or '{}'",
+                    QUEUE,
+                    queue,
+                    BLOCKING,
+                    LOCKFREE));
+            }
+        });
+
+#ifndef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    if (pool_queue.lockfree) {
+        throw setup_error(format(
+            "'{} = \"{}\"' is only supported with spdlog v1.5.0 onwards",
+            QUEUE,
+            LOCKFREE));
+    }
+#endif
+
+    if_value_from_table<string>(
+        thread_pool_table,
+        WAIT_STRATEGY,
+        [&pool_queue](const string &wait) {
+            if (wait == YIELD) {
+                pool_queue.options.wait = wait_strategy::Yield;
+            } else if (wait == SPIN) {
+                pool_queue.options.wait = wait_strategy::Spin;
+            } else if (wait == SPIN_THEN_BLOCK) {
+                pool_queue.options.wait = wait_strategy::SpinThenBlock;
+            } else if (wait != BLOCK) {
+                throw setup_error(format(
+                    "Invalid '{}' value '{}', expected '{}', '{}', '{}' or "
+                    "'{}'",
+                    WAIT_STRATEGY,
+                    wait,
+                    BLOCK,
+                    YIELD,
+                    SPIN,
+                    SPIN_THEN_BLOCK));
+            }
+        });
+
+    if_value_from_table<int64_t>(
+        thread_pool_table,
+        SPIN_BUDGET_US,
+        [&pool_queue](const int64_t budget) {
+            if (budget < 0) {
+                throw setup_error(format(
+                    "'{}' must not be negative, but {} found",
+                    SPIN_BUDGET_US,
+                    budget));
+            }
+
+            pool_queue.options.spin_budget = std::chrono::microseconds(budget);
+        });
+
+    // only spin_then_block stops spinning
+    if (thread_pool_table->contains(SPIN_BUDGET_US) &&
+        pool_queue.options.wait != wait_strategy::SpinThenBlock) {
+
+        throw setup_error(format(
+            "'{}' requires '{} = \"{}\"'",
+            SPIN_BUDGET_US,
+            WAIT_STRATEGY,
+            SPIN_THEN_BLOCK));
+    }
+
+    if_value_from_table<int64_t>(
+        thread_pool_table, BATCH_SIZE, [&pool_queue](const int64_t size) {
+            if (size < 1) {
+                throw setup_error(format(
+                    "'{}' must be at least 1, but {} found", BATCH_SIZE, size));
+            }
+
+            pool_queue.options.batch_size = static_cast<size_t>(size);
+        });
+
+    if_value_from_table<int64_t>(
+        thread_pool_table,
+        MAX_BATCH_LATENCY_US,
+        [&pool_queue](const int64_t latency) {
+            if (latency < 0) {
+                throw setup_error(format(
+                    "'{}' must not be negative, but {} found",
+                    MAX_BATCH_LATENCY_US,
+                    latency));
+            }
+
+            pool_queue.options.max_batch_latency =
+                std::chrono::microseconds(latency);
+        });
+
+    if_value_from_table<string>(
+        thread_pool_table, SHARDING, [&pool_queue](const string &sharding) {
+            if (sharding == LOGGER) {
+                pool_queue.options.sharded = true;
+            } else if (sharding != "none") {
+                throw setup_error(format(
+                    "Invalid '{}' value '{}', expected '{}' or 'none'",
+                    SHARDING,
+                    sharding,
+                    LOGGER));
+            }
+        });
+
+    // spdlog workers always block on a condition variable, and take one
+    // message at a time from a single queue
+    for (const auto field :
+         {WAIT_STRATEGY,
+          SPIN_BUDGET_US,
+          BATCH_SIZE,
+          MAX_BATCH_LATENCY_US,
+          SHARDING}) {
+        if (thread_pool_table->contains(field) && !pool_queue.lockfree) {
+            throw setup_error(format(
+                "'{}' requires '{} = \"{}\"'", field, QUEUE, LOCKFREE));
+        }
+    }
+
+    if (pool_queue.lockfree &&
+        value_from_table_or<string>(thread_pool_table, NUMA, "") == PER_NODE) {
+
+        throw setup_error(format(
+            "'{} = \"{}\"' cannot be combined with '{} = \"{}\"'",
+            QUEUE,
+            LOCKFREE,
+            NUMA,
+            PER_NODE));
+    }
+
+    return pool_queue;
+}
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+/**
+ * Applies the scheduling to the calling thread.
+ * @param scheduling Scheduling to apply.
+ * @return Error message, empty if successful.
+ */
+inline auto apply_thread_scheduling(const thread_scheduling &scheduling)
+    -> std::string {
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+    using std::system_category;
+
+    const auto thread = pthread_self();
+
+    if (!scheduling.cpus.empty()) {
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+
+        for (const auto cpu : scheduling.cpus) {
+            CPU_SET(cpu, &cpu_set);
+        }
+
+        const auto err =
+            pthread_setaffinity_np(thread, sizeof(cpu_set), &cpu_set);
+
+        if (err != 0) {
+            return format(
+                "Unable to set CPU affinity: {}",
+                system_category().message(err));
+        }
+    }
+
+    if (scheduling.has_policy) {
+        sched_param param{};
+        param.sched_priority = scheduling.priority;
+
+        const auto err =
+            pthread_setschedparam(thread, scheduling.policy, &param);
+
+        if (err != 0) {
+            return format(
+                "Unable to set scheduling policy: {}",
+                system_category().message(err));
+        }
+    }
+
+    // nice applies to the thread alone on Linux
+    if (scheduling.has_nice &&
+        setpriority(
+            PRIO_PROCESS,
+            static_cast<id_t>(syscall(SYS_gettid)),
+            scheduling.nice) != 0) {
+
+        return format(
+            "Unable to set nice value: {}", system_category().message(errno));
+    }
+
+    if (!scheduling.thread_name.empty()) {
+        // names are limited to 15 characters
+        const auto thread_name = scheduling.thread_name.substr(0, 15);
+        const auto err = pthread_setname_np(thread, thread_name.c_str());
+
+        if (err != 0) {
+            return format(
+                "Unable to set thread name: {}",
+                system_category().message(err));
+        }
+    }
+
+    return "";
+}
+#endif
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+/**
+ * Describes how many workers of a thread pool have started so far, and the
+ * first error in applying their scheduling.
+ */
+struct thread_start_report {
+    std::mutex mutex;
+    std::condition_variable started_cv;
+    size_t started = 0;
+    std::string err_msg;
+};
 
-    case sink_type::BasicFileSinkMt:
-        return setup_basic_file_sink<basic_file_sink_mt>(sink_table);
+inline auto scheduled_thread_start(
+    const std::shared_ptr<thread_start_report> &report,
+    const thread_scheduling &scheduling) -> std::function<void()> {
 
-    case sink_type::RotatingFileSinkSt:
-        return setup_rotating_file_sink<rotating_file_sink_st>(sink_table);
+    // std
+    using std::lock_guard;
+    using std::mutex;
 
-    case sink_type::RotatingFileSinkMt:
-        return setup_rotating_file_sink<rotating_file_sink_mt>(sink_table);
+    return [report, scheduling] {
+        const auto err_msg = apply_thread_scheduling(scheduling);
 
-    case sink_type::DailyFileSinkSt:
-        return setup_daily_file_sink<daily_file_sink_st>(sink_table);
+        {
+            lock_guard<mutex> lock(report->mutex);
+            ++report->started;
 
-    case sink_type::DailyFileSinkMt:
-        return setup_daily_file_sink<daily_file_sink_mt>(sink_table);
+            if (report->err_msg.empty()) {
+                report->err_msg = err_msg;
+            }
+        }
 
-    case sink_type::NullSinkSt:
-        return make_shared<null_sink_st>();
+        report->started_cv.notify_all();
+    };
+}
 
-    case sink_type::NullSinkMt:
-        return make_shared<null_sink_mt>();
+inline void wait_thread_starts(
+    thread_start_report &report,
+    const size_t num_threads,
+    const std::string &owner) {
 
-#ifdef SPDLOG_ENABLE_SYSLOG
-    case sink_type::SyslogSinkSt:
-        return setup_syslog_sink<syslog_sink_st>(sink_table);
+    // std
+    using std::mutex;
+    using std::unique_lock;
 
-    case sink_type::SyslogSinkMt:
-        return setup_syslog_sink<syslog_sink_mt>(sink_table);
-#endif
+    unique_lock<mutex> lock(report.mutex);
 
-#ifdef _WIN32
-    case sink_type::MSVCSinkSt:
-        return make_shared<msvc_sink_st>();
-    case sink_type::MSVCSinkMt:
-        return make_shared<msvc_sink_mt>();
-#endif
+    report.started_cv.wait(lock, [&report, num_threads] {
+        return report.started >= num_threads;
+    });
 
-    default:
-        throw setup_error(format(
-            "Unexpected sink error with sink enum value '{}'",
-            static_cast<int>(sink_val)));
+    if (!report.err_msg.empty()) {
+        throw setup_error(
+            fmt::format("{} error:\n > {}", owner, report.err_msg));
     }
 }
 
-inline void set_logger_level_if_present(
-    const std::shared_ptr<cpptoml::table> &logger_table,
-    const std::shared_ptr<spdlog::logger> &logger) {
-
-    using names::LEVEL;
+/**
+ * Calls the function on a thread bound to the CPUs, so that memory first
+ * touched by the function is allocated on the NUMA node of the CPUs.
+ * @param cpus CPUs to run on, empty to run on any CPU.
+ * @param fn Function to call.
+ * @return Result of the function.
+ */
+template <class Fn>
+auto run_on_cpus(const std::vector<int> &cpus, Fn &&fn) ->
+    typename std::result_of<Fn()>::type {
 
     // std
-    using std::string;
+    using std::current_exception;
+    using std::exception_ptr;
+    using std::rethrow_exception;
+    using std::thread;
 
-    if_value_from_table<string>(
-        logger_table, LEVEL, [&logger](const string &level) {
-            const auto level_enum = level_from_str(level);
-            logger->set_level(level_enum);
-        });
-}
+    typename std::result_of<Fn()>::type result;
+    exception_ptr error;
 
-inline void set_logger_flush_level_if_present(
-    const std::shared_ptr<cpptoml::table> &logger_table,
-    const std::shared_ptr<spdlog::logger> &logger) {
+    thread runner([&cpus, &fn, &result, &error] {
+        try {
+            thread_scheduling scheduling;
+            scheduling.cpus = cpus;
 
-    using names::FLUSH_LEVEL;
+            const auto err_msg = apply_thread_scheduling(scheduling);
 
-    // std
-    using std::string;
+            if (!err_msg.empty()) {
+                throw setup_error(err_msg);
+            }
 
-    if_value_from_table<string>(
-        logger_table, FLUSH_LEVEL, [&logger](const string &flush_level) {
-            const auto level_enum = level_from_str(flush_level);
-            logger->flush_on(level_enum);
-        });
-}
+            result = fn();
+        } catch (...) {
+            error = current_exception();
+        }
+    });
 
-inline auto setup_sink(const std::shared_ptr<cpptoml::table> &sink_table)
-    -> std::shared_ptr<spdlog::sinks::sink> {
+    runner.join();
 
-    using names::TYPE;
+    if (error) {
+        rethrow_exception(error);
+    }
+
+    return result;
+}
+#endif
+
+/**
+ * Creates the thread pool, whose workers apply the scheduling of the table as
+ * they start. Waits for every worker to start, so that failing to apply the
+ * scheduling is reported here instead of going unnoticed.
+ * @param owner Description of the thread pool for error messages.
+ * @param queue_size Maximum number of queued messages.
+ * @param num_threads Number of worker threads.
+ * @param fallback_queue_size Maximum number of queued messages of the spdlog
+ * thread pool underlying a lock-free one, which only serves async loggers
+ * created through spdlog itself.
+ * @param thread_pool_table Table of the thread pool.
+ * @return Thread pool, which is a numa_thread_pool for numa = "per_node", or
+ * a managed_thread_pool for queue = "lockfree".
+ * @throw setup_error
+ */
+inline auto make_thread_pool(
+    const std::string &owner,
+    const size_t queue_size,
+    const size_t num_threads,
+    const size_t fallback_queue_size,
+    const std::shared_ptr<cpptoml::table> &thread_pool_table)
+    -> std::shared_ptr<spdlog::details::thread_pool> {
 
     // fmt
     using fmt::format;
 
+    // spdlog
+    using spdlog::details::thread_pool;
+
     // std
+    using std::make_shared;
     using std::move;
+    using std::shared_ptr;
     using std::string;
+    using std::vector;
 
-    const auto type_val = value_from_table<string>(
-        sink_table, TYPE, format("Sink missing '{}' field", TYPE));
+    const auto add_owner_msg = [&owner](const string &err_msg) {
+        return format("{} error:\n > {}", owner, err_msg);
+    };
 
-    const auto sink_val = sink_type_from_str(type_val);
-    auto sink = sink_from_sink_type(sink_val, sink_table);
+    const auto scheduling = add_msg_on_err(
+        [&thread_pool_table] {
+            return thread_scheduling_from_table(thread_pool_table);
+        },
+        add_owner_msg);
 
-    // set optional parts and return back the same sink
-    set_sink_level_if_present(sink_table, sink);
+    const auto pool_queue = add_msg_on_err(
+        [&thread_pool_table] {
+            return thread_pool_queue_from_table(thread_pool_table);
+        },
+        add_owner_msg);
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    if (pool_queue.lockfree) {
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+        if (has_thread_scheduling(scheduling)) {
+            const auto report = make_shared<thread_start_report>();
+
+            const auto pool = make_shared<managed_thread_pool>(
+                queue_size,
+                num_threads,
+                pool_queue.options,
+                fallback_queue_size,
+                scheduled_thread_start(report, scheduling));
+
+            // including the worker of the underlying spdlog thread pool
+            wait_thread_starts(*report, num_threads + 1, owner);
+            return pool;
+        }
+#endif
 
-    return sink;
-}
+        return make_shared<managed_thread_pool>(
+            queue_size,
+            num_threads,
+            pool_queue.options,
+            fallback_queue_size,
+            nullptr);
+    }
+#else
+    static_cast<void>(pool_queue);
+    static_cast<void>(fallback_queue_size);
+#endif
 
-inline auto setup_sinks(const std::shared_ptr<cpptoml::table> &config)
-    -> std::unordered_map<std::string, std::shared_ptr<spdlog::sinks::sink>> {
+    if (!has_thread_scheduling(scheduling)) {
+        return make_shared<thread_pool>(queue_size, num_threads);
+    }
 
-    using names::NAME;
-    using names::SINK_TABLE;
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+    const auto report = make_shared<thread_start_report>();
 
-    // fmt
-    using fmt::format;
+    if (!scheduling.per_numa_node) {
+        const auto pool = make_shared<thread_pool>(
+            queue_size,
+            num_threads,
+            scheduled_thread_start(report, scheduling));
 
-    // std
-    using std::move;
-    using std::shared_ptr;
-    using std::string;
-    using std::unordered_map;
+        wait_thread_starts(*report, num_threads, owner);
+        return pool;
+    }
 
-    const auto sinks = config->get_table_array(SINK_TABLE);
+    const auto &node_cpus = system_numa_topology().node_cpus;
 
-    if (!sinks) {
-        throw setup_error("No sinks configured for set-up");
+    // each pool is created on its node, so that its queue is allocated there
+    const auto make_node_pool = [&](const size_t node) {
+        auto node_scheduling = scheduling;
+        node_scheduling.cpus = node_cpus[node];
+
+        return run_on_cpus(node_cpus[node], [&] {
+            return make_shared<thread_pool>(
+                queue_size,
+                num_threads,
+                scheduled_thread_start(report, node_scheduling));
+        });
+    };
+
+    vector<shared_ptr<thread_pool>> other_node_pools;
+
+    for (size_t node = 1; node < node_cpus.size(); ++node) {
+        other_node_pools.push_back(make_node_pool(node));
     }
 
-    unordered_map<string, shared_ptr<spdlog::sinks::sink>> sinks_map;
+    auto first_node_scheduling = scheduling;
+    first_node_scheduling.cpus = node_cpus.front();
 
-    for (const auto &sink_table : *sinks) {
-        auto name = value_from_table<string>(
-            sink_table,
-            NAME,
-            format("One of the sinks does not have a '{}' field", NAME));
+    const auto pool = run_on_cpus(node_cpus.front(), [&] {
+        return shared_ptr<thread_pool>(make_shared<numa_thread_pool>(
+            queue_size,
+            num_threads,
+            scheduled_thread_start(report, first_node_scheduling),
+            move(other_node_pools)));
+    });
 
-        auto sink = add_msg_on_err(
-            [&sink_table] { return setup_sink(sink_table); },
-            [&name](const string &err_msg) {
-                return format("Sink '{}' error:\n > {}", name, err_msg);
-            });
+    wait_thread_starts(*report, num_threads * node_cpus.size(), owner);
+    return pool;
+#else
+    // unreachable, since scheduling is rejected when unsupported
+    return make_shared<thread_pool>(queue_size, num_threads);
+#endif
+}
 
-        sinks_map.emplace(move(name), move(sink));
+/**
+ * Rejects the options that are only supported for named thread pools.
+ * @param global_thread_pool_table Table of the global thread pool.
+ * @throw setup_error
+ */
+inline void check_global_thread_pool_table(
+    const std::shared_ptr<cpptoml::table> &global_thread_pool_table) {
+
+    // loggers made through spdlog itself would bypass the routing
+    if (global_thread_pool_table->contains(names::NUMA)) {
+        throw setup_error(fmt::format(
+            "Global thread pool error:\n > '{}' is only supported for named "
+            "thread pools",
+            names::NUMA));
     }
-
-    return sinks_map;
 }
 
-inline auto setup_patterns(const std::shared_ptr<cpptoml::table> &config)
-    -> std::unordered_map<std::string, std::string> {
+inline auto setup_thread_pool(
+    const std::string &name,
+    const std::shared_ptr<cpptoml::table> &thread_pool_table)
+    -> std::shared_ptr<spdlog::details::thread_pool> {
 
-    using names::NAME;
-    using names::PATTERN_TABLE;
-    using names::VALUE;
+    using names::NUM_THREADS;
+    using names::QUEUE_SIZE;
 
     // fmt
     using fmt::format;
 
-    // std
-    using std::move;
-    using std::string;
-    using std::unordered_map;
+    // spdlog
+    using spdlog::details::thread_pool;
 
-    // possible to return an entire empty pattern map
-    unordered_map<string, string> patterns_map;
+    const auto queue_size = value_from_table<size_t>(
+        thread_pool_table,
+        QUEUE_SIZE,
+        format("Thread pool '{}' does not have '{}' field", name, QUEUE_SIZE));
+
+    const auto num_threads = value_from_table<size_t>(
+        thread_pool_table,
+        NUM_THREADS,
+        format("Thread pool '{}' does not have '{}' field", name, NUM_THREADS));
+
+    // only the loggers of this library can refer to named thread pools
+    auto pool = make_thread_pool(
+        format("Thread pool '{}'", name),
+        queue_size,
+        num_threads,
+        1,
+        thread_pool_table);
+
+    track_thread_pool(pool, queue_size, num_threads);
+    return pool;
+}
 
-    const auto patterns = config->get_table_array(PATTERN_TABLE);
+inline auto setup_global_thread_pool(
+    const std::shared_ptr<cpptoml::table> &global_thread_pool_table)
+    -> std::shared_ptr<spdlog::details::thread_pool> {
 
-    if (patterns) {
-        for (const auto &pattern_table : *patterns) {
-            auto name = value_from_table<string>(
-                pattern_table,
-                NAME,
-                format("One of the patterns does not have a '{}' field", NAME));
+    using names::NUM_THREADS;
+    using names::QUEUE_SIZE;
 
-            auto value = value_from_table<string>(
-                pattern_table,
-                VALUE,
-                format("Pattern '{}' does not have '{}' field", name, VALUE));
+    const auto queue_size = value_from_table_or<size_t>(
+        global_thread_pool_table,
+        QUEUE_SIZE,
+        defaults::THREAD_POOL_QUEUE_SIZE);
 
-            patterns_map.emplace(move(name), move(value));
-        }
-    }
+    const auto num_threads = value_from_table_or<size_t>(
+        global_thread_pool_table,
+        NUM_THREADS,
+        defaults::THREAD_POOL_NUM_THREADS);
 
-    return patterns_map;
+    check_global_thread_pool_table(global_thread_pool_table);
+
+    auto pool = make_thread_pool(
+        "Global thread pool",
+        queue_size,
+        num_threads,
+        queue_size,
+        global_thread_pool_table);
+
+    track_thread_pool(pool, queue_size, num_threads);
+    return pool;
 }
 
 inline auto
@@ -1141,19 +3221,16 @@ setup_thread_pools(const std::shared_ptr<cpptoml::table> &config) -> std::
 
     using names::GLOBAL_THREAD_POOL_TABLE;
     using names::NAME;
-    using names::NUM_THREADS;
-    using names::QUEUE_SIZE;
     using names::THREAD_POOL_TABLE;
 
     // fmt
     using fmt::format;
 
     // spdlog
-    using spdlog::init_thread_pool;
+    using spdlog::details::registry;
     using spdlog::details::thread_pool;
 
     // std
-    using std::make_shared;
     using std::move;
     using std::shared_ptr;
     using std::string;
@@ -1164,17 +3241,8 @@ setup_thread_pools(const std::shared_ptr<cpptoml::table> &config) -> std::
         config->get_table(GLOBAL_THREAD_POOL_TABLE);
 
     if (global_thread_pool_table) {
-        const auto queue_size = value_from_table_or<size_t>(
-            global_thread_pool_table,
-            QUEUE_SIZE,
-            defaults::THREAD_POOL_QUEUE_SIZE);
-
-        const auto num_threads = value_from_table_or<size_t>(
-            global_thread_pool_table,
-            NUM_THREADS,
-            defaults::THREAD_POOL_NUM_THREADS);
-
-        init_thread_pool(queue_size, num_threads);
+        registry::instance().set_tp(
+            setup_global_thread_pool(global_thread_pool_table));
     }
 
     // possible to return an entire empty thread pools map
@@ -1191,28 +3259,183 @@ setup_thread_pools(const std::shared_ptr<cpptoml::table> &config) -> std::
                     "One of the thread pools does not have a '{}' field",
                     NAME));
 
-            const auto queue_size = value_from_table<size_t>(
-                thread_pool_table,
-                QUEUE_SIZE,
-                format(
-                    "Thread pool '{}' does not have '{}' field",
-                    name,
-                    QUEUE_SIZE));
+            auto pool = setup_thread_pool(name, thread_pool_table);
+            thread_pools_map.emplace(move(name), move(pool));
+        }
+    }
 
-            const auto num_threads = value_from_table<size_t>(
-                thread_pool_table,
-                NUM_THREADS,
+    return thread_pools_map;
+}
+
+inline auto overflow_handling_from_table(
+    const std::shared_ptr<cpptoml::table> &logger_table)
+    -> overflow_handling {
+
+    using names::BLOCK_WITH_TIMEOUT;
+    using names::DROP_BELOW_LEVEL;
+    using names::OVERFLOW_LEVEL;
+    using names::OVERFLOW_POLICY;
+    using names::OVERFLOW_TIMEOUT;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    overflow_handling overflow;
+
+    if_value_from_table<string>(
+        logger_table, OVERFLOW_POLICY, [&overflow](const string &policy) {
+            overflow.policy = find_value_from_map(
+                OVERFLOW_POLICY_MAP,
+                policy,
                 format(
-                    "Thread pool '{}' does not have '{}' field",
-                    name,
-                    NUM_THREADS));
+                    "Invalid async overflow policy type given '{}'", policy));
+        });
 
-            thread_pools_map.emplace(
-                move(name), make_shared<thread_pool>(queue_size, num_threads));
-        }
+    const auto has_timeout = logger_table->contains(OVERFLOW_TIMEOUT);
+
+    if (overflow.policy == overflow_policy::BlockWithTimeout) {
+        overflow.timeout = parse_duration(value_from_table<string>(
+            logger_table,
+            OVERFLOW_TIMEOUT,
+            format(
+                "'{} = \"{}\"' requires a '{}' field",
+                OVERFLOW_POLICY,
+                BLOCK_WITH_TIMEOUT,
+                OVERFLOW_TIMEOUT)));
+    } else if (has_timeout) {
+        throw setup_error(format(
+            "'{}' requires '{} = \"{}\"'",
+            OVERFLOW_TIMEOUT,
+            OVERFLOW_POLICY,
+            BLOCK_WITH_TIMEOUT));
     }
 
-    return thread_pools_map;
+    const auto level_opt =
+        value_from_table_opt<string>(logger_table, OVERFLOW_LEVEL);
+
+    if (level_opt && overflow.policy != overflow_policy::DropBelowLevel) {
+        throw setup_error(format(
+            "'{}' requires '{} = \"{}\"'",
+            OVERFLOW_LEVEL,
+            OVERFLOW_POLICY,
+            DROP_BELOW_LEVEL));
+    } else if (level_opt) {
+        overflow.level = level_from_str(*level_opt);
+    }
+
+    return overflow;
+}
+
+inline auto logger_queue_from_table(
+    const std::shared_ptr<cpptoml::table> &logger_table,
+    const overflow_handling &overflow) -> logger_queue {
+
+    using names::ASYNC;
+    using names::OVERFLOW_POLICY;
+    using names::OVERRUN_OLDEST;
+    using names::QUEUE;
+    using names::QUEUE_SIZE;
+    using names::SHARED;
+    using names::SPSC;
+    using names::SYNC;
+    using names::TYPE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    logger_queue queue;
+
+    if_value_from_table<string>(
+        logger_table, QUEUE, [&queue](const string &queue_type) {
+            if (queue_type == SPSC) {
+                queue.spsc = true;
+            } else if (queue_type != SHARED) {
+                throw setup_error(format(
+                    "Invalid '{}' value '{}', expected '{}' or '{}'",
+                    QUEUE,
+                    queue_type,
+                    SHARED,
+                    SPSC));
+            }
+        });
+
+    if_value_from_table<int64_t>(
+        logger_table, QUEUE_SIZE, [&queue](const int64_t size) {
+            if (size < 1) {
+                throw setup_error(format(
+                    "'{}' must be at least 1, but {} found", QUEUE_SIZE, size));
+            }
+
+            queue.queue_size = static_cast<size_t>(size);
+        });
+
+    if (logger_table->contains(QUEUE_SIZE) && !queue.spsc) {
+        throw setup_error(
+            format("'{}' requires '{} = \"{}\"'", QUEUE_SIZE, QUEUE, SPSC));
+    }
+
+    if (!queue.spsc) {
+        return queue;
+    }
+
+    if (value_from_table_or<string>(logger_table, TYPE, SYNC) != ASYNC) {
+        throw setup_error(format(
+            "'{} = \"{}\"' requires '{} = \"{}\"'", QUEUE, SPSC, TYPE, ASYNC));
+    }
+
+    // only the worker may take the oldest message out of a private queue
+    if (overflow.policy == overflow_policy::OverrunOldest) {
+        throw setup_error(format(
+            "'{} = \"{}\"' cannot be combined with '{} = \"{}\"'",
+            QUEUE,
+            SPSC,
+            OVERFLOW_POLICY,
+            OVERRUN_OLDEST));
+    }
+
+#ifndef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    throw setup_error(format(
+        "'{} = \"{}\"' is only supported with spdlog v1.5.0 onwards",
+        QUEUE,
+        SPSC));
+#endif
+
+    return queue;
+}
+
+/**
+ * Returns the spdlog overflow policy for async loggers built on spdlog thread
+ * pools, which only support block and overrun_oldest.
+ * @param overflow Overflow policy of the logger.
+ * @return spdlog overflow policy.
+ * @throw setup_error
+ */
+inline auto to_spdlog_overflow_policy(const overflow_handling &overflow)
+    -> spdlog::async_overflow_policy {
+
+    switch (overflow.policy) {
+    case overflow_policy::Block:
+        return spdlog::async_overflow_policy::block;
+
+    case overflow_policy::OverrunOldest:
+        return spdlog::async_overflow_policy::overrun_oldest;
+
+    default:
+        throw setup_error(fmt::format(
+            "'{}' other than '{}' and '{}' requires a thread pool with "
+            "'{} = \"{}\"'",
+            names::OVERFLOW_POLICY,
+            names::BLOCK,
+            names::OVERRUN_OLDEST,
+            names::QUEUE,
+            names::LOCKFREE));
+    }
 }
 
 inline auto setup_sync_logger(
@@ -1229,8 +3452,9 @@ inline auto setup_async_logger(
     const std::vector<std::shared_ptr<spdlog::sinks::sink>> &logger_sinks,
     const std::unordered_map<
         std::string,
-        std::shared_ptr<spdlog::details::thread_pool>> &thread_pools_map)
-    -> std::shared_ptr<spdlog::logger> {
+        std::shared_ptr<spdlog::details::thread_pool>> &thread_pools_map,
+    const std::shared_ptr<spdlog::details::thread_pool> &global_thread_pool =
+        nullptr) -> std::shared_ptr<spdlog::logger> {
     const auto &thread_pool_name_opt =
         value_from_table_opt<std::string>(logger_table, names::THREAD_POOL);
 
@@ -1246,25 +3470,55 @@ inline auto setup_async_logger(
                             thread_pool_name,
                             name));
                 }()
-                : spdlog::thread_pool();
+                : global_thread_pool ? global_thread_pool
+                                     : spdlog::thread_pool();
+
+    const auto add_logger_msg = [&name](const std::string &err_msg) {
+        return fmt::format("Logger '{}' error:\n > {}", name, err_msg);
+    };
 
-    const auto &async_overflow_policy_raw_opt =
-        value_from_table_opt<std::string>(logger_table, names::OVERFLOW_POLICY);
+    const auto overflow = add_msg_on_err(
+        [&logger_table] { return overflow_handling_from_table(logger_table); },
+        add_logger_msg);
 
-    const auto async_overflow_policy = static_cast<bool>(async_overflow_policy_raw_opt)
-                ? [&async_overflow_policy_raw_opt, &name]() {
-                    const auto &async_overflow_policy_raw = *async_overflow_policy_raw_opt;
+    const auto queue = add_msg_on_err(
+        [&logger_table, &overflow] {
+            return logger_queue_from_table(logger_table, overflow);
+        },
+        add_logger_msg);
 
-                    return find_value_from_map(
-                        ASYNC_OVERFLOW_POLICY_MAP,
-                        async_overflow_policy_raw,
-                        fmt::format(
-                            "Invalid async overflow policy type given '{}' for logger '{}'",
-                            async_overflow_policy_raw,
-                            name)
-                    );
-                }()
-                : defaults::ASYNC_OVERFLOW_POLICY;
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    if (const auto managed_pool = as_managed_thread_pool(thread_pool)) {
+        return std::make_shared<managed_async_logger>(
+            name,
+            logger_sinks,
+            managed_pool,
+            overflow,
+            queue.spsc ? queue.queue_size : 0);
+    }
+#endif
+
+    // only the workers of lock-free thread pools poll private queues
+    if (queue.spsc) {
+        throw setup_error(add_logger_msg(fmt::format(
+            "'{} = \"{}\"' requires a thread pool with '{} = \"{}\"'",
+            names::QUEUE,
+            names::SPSC,
+            names::QUEUE,
+            names::LOCKFREE)));
+    }
+
+    const auto async_overflow_policy = add_msg_on_err(
+        [&overflow] { return to_spdlog_overflow_policy(overflow); },
+        add_logger_msg);
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+    // routes each message to the pool of the node of the producing thread
+    if (const auto numa_pool = as_numa_thread_pool(thread_pool)) {
+        return std::make_shared<numa_async_logger>(
+            name, logger_sinks, numa_pool, async_overflow_policy);
+    }
+#endif
 
     return std::make_shared<spdlog::async_logger>(
         name,
@@ -1282,8 +3536,10 @@ inline auto setup_logger(
     const std::unordered_map<
         std::string,
         std::shared_ptr<spdlog::details::thread_pool>> &thread_pools_map,
-    const cpptoml::option<std::string> &global_pattern_opt)
-    -> std::shared_ptr<spdlog::logger> {
+    const cpptoml::option<std::string> &global_pattern_opt,
+    const std::shared_ptr<spdlog::details::thread_pool> &global_thread_pool =
+        nullptr,
+    const bool apply_pattern = true) -> std::shared_ptr<spdlog::logger> {
 
     using fmt::format;
     using names::PATTERN;
@@ -1334,12 +3590,25 @@ inline auto setup_logger(
 
     switch (sync) {
     case sync_type::Sync:
+        // rejects the private queues of async loggers
+        add_msg_on_err(
+            [&logger_table] {
+                logger_queue_from_table(logger_table, overflow_handling());
+            },
+            [&name](const string &err_msg) {
+                return format("Logger '{}' error:\n > {}", name, err_msg);
+            });
+
         logger = setup_sync_logger(name, logger_sinks);
         break;
 
     case sync_type::Async:
         logger = setup_async_logger(
-            name, logger_table, logger_sinks, thread_pools_map);
+            name,
+            logger_table,
+            logger_sinks,
+            thread_pools_map,
+            global_thread_pool);
         break;
 
     default:
@@ -1398,8 +3667,9 @@ inline auto setup_logger(
         pattern_value_opt ? move(pattern_value_opt) : global_pattern_opt;
 
     try {
-        if (selected_pattern_opt) {
-            logger->set_pattern(*selected_pattern_opt);
+        // the caller may set the pattern later, since the sinks may be shared
+        if (selected_pattern_opt && apply_pattern) {
+            set_counted_pattern(*logger, *selected_pattern_opt);
         }
     } catch (const exception &e) {
         throw setup_error(format(
@@ -1411,20 +3681,23 @@ inline auto setup_logger(
     return logger;
 }
 
-inline void setup_loggers(
+inline auto setup_loggers(
     const std::shared_ptr<cpptoml::table> &config,
     const std::unordered_map<std::string, std::shared_ptr<spdlog::sinks::sink>>
         &sinks_map,
     const std::unordered_map<std::string, std::string> &patterns_map,
     const std::unordered_map<
         std::string,
-        std::shared_ptr<spdlog::details::thread_pool>> &thread_pools_map) {
+        std::shared_ptr<spdlog::details::thread_pool>> &thread_pools_map)
+    -> std::unordered_map<std::string, std::shared_ptr<spdlog::logger>> {
 
     using names::GLOBAL_PATTERN;
     using names::LOGGER_TABLE;
 
     // std
+    using std::shared_ptr;
     using std::string;
+    using std::unordered_map;
 
     const auto loggers = config->get_table_array(LOGGER_TABLE);
 
@@ -1436,6 +3709,8 @@ inline void setup_loggers(
     const auto global_pattern_opt =
         value_from_table_opt<string>(config, GLOBAL_PATTERN);
 
+    unordered_map<string, shared_ptr<spdlog::logger>> loggers_map;
+
     for (const auto &logger_table : *loggers) {
         const auto logger = setup_logger(
             logger_table,
@@ -1445,10 +3720,410 @@ inline void setup_loggers(
             global_pattern_opt);
 
         spdlog::register_logger(logger);
+        loggers_map.emplace(logger->name(), logger);
+    }
+
+    return loggers_map;
+}
+
+/**
+ * Reads the optional flush interval of the table.
+ * @param table Table of the configuration, a sink or a logger.
+ * @return Flush interval, zero if not present.
+ * @throw setup_error
+ */
+inline auto flush_interval_from_table(const cpptoml::table &table)
+    -> std::chrono::microseconds {
+
+    using names::FLUSH_INTERVAL;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+    using std::chrono::microseconds;
+
+    const auto interval_opt = table.get_as<string>(FLUSH_INTERVAL);
+
+    if (!interval_opt) {
+        return microseconds(0);
+    }
+
+    const auto interval = parse_duration(*interval_opt);
+
+    if (interval.count() <= 0) {
+        throw setup_error(format(
+            "'{}' must be positive, found '{}'",
+            FLUSH_INTERVAL,
+            *interval_opt));
+    }
+
+    return interval;
+}
+
+/**
+ * Reads the flush intervals of the sinks and loggers, where loggers without
+ * their own interval take the global one, and resolves them against the
+ * sinks and loggers that are built.
+ * @param config Configuration to read the intervals from.
+ * @param sinks_map Sinks that are built by name.
+ * @param loggers_map Loggers that are built by name.
+ * @return Periodic flushes of the sinks and loggers that are built.
+ * @throw setup_error
+ */
+template <class SinksMap, class LoggersMap>
+auto periodic_flushes_from_config(
+    const cpptoml::table &config,
+    const SinksMap &sinks_map,
+    const LoggersMap &loggers_map) -> std::vector<periodic_flush> {
+
+    using names::LOGGER_TABLE;
+    using names::NAME;
+    using names::SINK_TABLE;
+    using names::TYPE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+    using std::vector;
+
+    vector<periodic_flush> flushes;
+
+    const auto global_interval = add_msg_on_err(
+        [&config] { return flush_interval_from_table(config); },
+        [](const string &err_msg) {
+            return format("Global flush interval error:\n > {}", err_msg);
+        });
+
+    if (const auto sinks = config.get_table_array(SINK_TABLE)) {
+        for (const auto &sink_table : *sinks) {
+            const auto name_opt = sink_table->get_as<string>(NAME);
+            const auto name = name_opt ? *name_opt : string();
+
+            const auto add_sink_msg = [&name](const string &err_msg) {
+                return format("Sink '{}' error:\n > {}", name, err_msg);
+            };
+
+            const auto interval = add_msg_on_err(
+                [&sink_table] {
+                    return flush_interval_from_table(*sink_table);
+                },
+                add_sink_msg);
+
+            if (interval.count() == 0) {
+                continue;
+            }
+
+            // only _mt sinks may be flushed from the flusher thread
+            const auto type_opt = sink_table->get_as<string>(TYPE);
+            const auto type = type_opt ? *type_opt : string();
+
+            if (type.size() >= 3 &&
+                type.compare(type.size() - 3, 3, "_st") == 0) {
+
+                throw setup_error(add_sink_msg(format(
+                    "'{}' is only supported for thread-safe _mt sinks",
+                    names::FLUSH_INTERVAL)));
+            }
+
+            const auto sink_itr = sinks_map.find(name);
+
+            if (sink_itr != sinks_map.cend()) {
+                periodic_flush flush;
+                flush.sink = sink_itr->second;
+                flush.interval = interval;
+                flushes.push_back(flush);
+            }
+        }
+    }
+
+    if (const auto loggers = config.get_table_array(LOGGER_TABLE)) {
+        for (const auto &logger_table : *loggers) {
+            const auto name_opt = logger_table->get_as<string>(NAME);
+            const auto name = name_opt ? *name_opt : string();
+
+            const auto own_interval = add_msg_on_err(
+                [&logger_table] {
+                    return flush_interval_from_table(*logger_table);
+                },
+                [&name](const string &err_msg) {
+                    return format("Logger '{}' error:\n > {}", name, err_msg);
+                });
+
+            const auto interval =
+                own_interval.count() > 0 ? own_interval : global_interval;
+
+            const auto logger_itr = loggers_map.find(name);
+
+            if (interval.count() > 0 && logger_itr != loggers_map.cend()) {
+                periodic_flush flush;
+                flush.logger = logger_itr->second;
+                flush.interval = interval;
+                flushes.push_back(flush);
+            }
+        }
+    }
+
+    return flushes;
+}
+
+inline void validate_level_if_present(
+    const std::shared_ptr<cpptoml::table> &table,
+    const char field[],
+    const std::string &owner) {
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    if_value_from_table<string>(
+        table, field, [field, &owner](const string &level) {
+            add_msg_on_err(
+                [&level] { level_from_str(level); },
+                [field, &owner](const string &err_msg) {
+                    return format(
+                        "{} has invalid '{}':\n > {}", owner, field, err_msg);
+                });
+        });
+}
+
+inline auto validate_named_items(
+    const cpptoml::table &config, const char table_name[])
+    -> std::unordered_set<std::string> {
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+    using std::unordered_set;
+
+    unordered_set<string> item_names;
+    const auto items = config.get_table_array(table_name);
+
+    if (!items) {
+        return item_names;
+    }
+
+    for (const auto &item : *items) {
+        const auto name = value_from_table<string>(
+            item,
+            names::NAME,
+            format(
+                "One of the '{}' items does not have a '{}' field",
+                table_name,
+                names::NAME));
+
+        if (!item_names.insert(name).second) {
+            throw setup_error(
+                format("Duplicate '{}' item named '{}'", table_name, name));
+        }
+    }
+
+    return item_names;
+}
+
+/**
+ * Checks the configuration for errors without building anything, such as
+ * unknown sink types and levels, and references to sinks, patterns and thread
+ * pools that are not defined.
+ * @param config Configuration to check.
+ * @throw setup_error
+ */
+inline void validate_config(const cpptoml::table &config) {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    if (!config.get_table_array(names::SINK_TABLE)) {
+        throw setup_error("No sinks configured for set-up");
+    }
+
+    // every item needs a unique name before anything else is checked
+    const auto sink_names =
+        validate_named_items(config, names::SINK_TABLE);
+
+    const auto pattern_names =
+        validate_named_items(config, names::PATTERN_TABLE);
+
+    const auto thread_pool_names =
+        validate_named_items(config, names::THREAD_POOL_TABLE);
+
+    if (const auto thread_pools =
+            config.get_table_array(names::THREAD_POOL_TABLE)) {
+
+        for (const auto &thread_pool_table : *thread_pools) {
+            const auto name = *thread_pool_table->get_as<string>(names::NAME);
+
+            add_msg_on_err(
+                [&thread_pool_table] {
+                    thread_scheduling_from_table(thread_pool_table);
+                    thread_pool_queue_from_table(thread_pool_table);
+                },
+                [&name](const string &err_msg) {
+                    return format(
+                        "Thread pool '{}' error:\n > {}", name, err_msg);
+                });
+        }
+    }
+
+    if (const auto global_thread_pool_table =
+            config.get_table(names::GLOBAL_THREAD_POOL_TABLE)) {
+
+        check_global_thread_pool_table(global_thread_pool_table);
+
+        add_msg_on_err(
+            [&global_thread_pool_table] {
+                thread_scheduling_from_table(global_thread_pool_table);
+                thread_pool_queue_from_table(global_thread_pool_table);
+            },
+            [](const string &err_msg) {
+                return format("Global thread pool error:\n > {}", err_msg);
+            });
+    }
+
+    const auto sinks = config.get_table_array(names::SINK_TABLE);
+
+    for (const auto &sink_table : *sinks) {
+        const auto name = *sink_table->get_as<string>(names::NAME);
+        const auto owner = format("Sink '{}'", name);
+
+        const auto type = value_from_table<string>(
+            sink_table,
+            names::TYPE,
+            format("{} does not have a '{}' field", owner, names::TYPE));
+
+        add_msg_on_err(
+            [&type] { sink_type_from_str(type); },
+            [&owner](const string &err_msg) {
+                return format("{} error:\n > {}", owner, err_msg);
+            });
+
+        validate_level_if_present(sink_table, names::LEVEL, owner);
+    }
+
+    check_shared_file_sinks(config);
+
+    const auto loggers = config.get_table_array(names::LOGGER_TABLE);
+
+    if (!loggers) {
+        throw setup_error("No loggers configured for set-up");
+    }
+
+    validate_named_items(config, names::LOGGER_TABLE);
+
+    for (const auto &logger_table : *loggers) {
+        const auto name = *logger_table->get_as<string>(names::NAME);
+        const auto owner = format("Logger '{}'", name);
+
+        const auto sinks = array_from_table<string>(
+            logger_table,
+            names::SINKS,
+            format(
+                "{} does not have a '{}' field of sink names",
+                owner,
+                names::SINKS));
+
+        for (const auto &sink_name : sinks) {
+            if (!sink_names.count(sink_name)) {
+                throw setup_error(format(
+                    "Unable to find sink '{}' for logger '{}'",
+                    sink_name,
+                    name));
+            }
+        }
+
+        if_value_from_table<string>(
+            logger_table, names::TYPE, [&name](const string &sync) {
+                if (!SYNC_MAP.count(sync)) {
+                    throw setup_error(format(
+                        "Invalid sync type given '{}' for logger '{}'",
+                        sync,
+                        name));
+                }
+            });
+
+        if_value_from_table<string>(
+            logger_table,
+            names::PATTERN,
+            [&name, &pattern_names](const string &pattern_name) {
+                if (!pattern_names.count(pattern_name)) {
+                    throw setup_error(format(
+                        "Pattern name '{}' cannot be found for logger '{}'",
+                        pattern_name,
+                        name));
+                }
+            });
+
+        if_value_from_table<string>(
+            logger_table,
+            names::THREAD_POOL,
+            [&name, &thread_pool_names](const string &thread_pool_name) {
+                if (!thread_pool_names.count(thread_pool_name)) {
+                    throw setup_error(format(
+                        "Unable to find thread pool '{}' for logger '{}'",
+                        thread_pool_name,
+                        name));
+                }
+            });
+
+        validate_level_if_present(logger_table, names::LEVEL, owner);
+
+        validate_level_if_present(
+            logger_table, names::FLUSH_LEVEL, owner);
+
+        add_msg_on_err(
+            [&logger_table] {
+                logger_queue_from_table(
+                    logger_table, overflow_handling_from_table(logger_table));
+            },
+            [&owner](const string &err_msg) {
+                return format("{} error:\n > {}", owner, err_msg);
+            });
     }
+
+    // nothing is built, so only the flush intervals are checked
+    periodic_flushes_from_config(
+        config,
+        std::unordered_map<string, std::weak_ptr<spdlog::sinks::sink>>(),
+        std::unordered_map<string, std::weak_ptr<spdlog::logger>>());
 }
 
 inline void setup(const std::shared_ptr<cpptoml::table> &config) {
+    // std
+    using std::lock_guard;
+    using std::move;
+    using std::mutex;
+
+    lock_guard<mutex> lock(applied_config_mutex());
+    auto &state = applied_config_state();
+
+    if (value_from_table_or<bool>(
+            config, names::LAZY_LOGGERS, defaults::LAZY_LOGGERS)) {
+
+        // nothing is built until requested, so check everything up front
+        validate_config(*config);
+
+        state.config = config;
+        state.sinks_map.clear();
+        state.thread_pools_map.clear();
+        state.loggers_map.clear();
+        state.lazy = true;
+
+        state.global_thread_pool_pending = static_cast<bool>(
+            config->get_table(names::GLOBAL_THREAD_POOL_TABLE));
+
+        periodic_flusher_instance().schedule({});
+        return;
+    }
+
     // set up sinks
     const auto sinks_map = setup_sinks(config);
 
@@ -1456,10 +4131,178 @@ inline void setup(const std::shared_ptr<cpptoml::table> &config) {
     const auto patterns_map = setup_patterns(config);
 
     // set up thread pools
-    const auto thread_pools_map = setup_thread_pools(config);
+    auto thread_pools_map = setup_thread_pools(config);
 
     // set up loggers, setting the respective sinks and patterns
-    setup_loggers(config, sinks_map, patterns_map, thread_pools_map);
+    const auto loggers_map =
+        setup_loggers(config, sinks_map, patterns_map, thread_pools_map);
+
+    auto flushes =
+        periodic_flushes_from_config(*config, sinks_map, loggers_map);
+
+    state.config = config;
+    state.sinks_map.clear();
+    state.sinks_map.insert(sinks_map.cbegin(), sinks_map.cend());
+    state.thread_pools_map = move(thread_pools_map);
+    state.loggers_map.clear();
+    state.loggers_map.insert(loggers_map.cbegin(), loggers_map.cend());
+    state.lazy = false;
+    state.global_thread_pool_pending = false;
+
+    periodic_flusher_instance().schedule(move(flushes));
+}
+
+/**
+ * Builds the logger of the given name from the lazy configuration currently
+ * applied, together with the sinks and thread pool it uses that are not built
+ * yet, and registers it into spdlog.
+ * @param name Name of the logger.
+ * @return Logger of the given name, nullptr if the configuration applied is
+ * not lazy and the logger is not registered, or if the logger is not
+ * configured.
+ * @throw setup_error
+ */
+inline auto setup_lazy_logger(const std::string &name)
+    -> std::shared_ptr<spdlog::logger> {
+
+    using names::GLOBAL_PATTERN;
+    using names::GLOBAL_THREAD_POOL_TABLE;
+    using names::LOGGER_TABLE;
+    using names::SINK_TABLE;
+    using names::SINKS;
+    using names::THREAD_POOL;
+    using names::THREAD_POOL_TABLE;
+    using names::TYPE;
+
+    // fmt
+    using fmt::format;
+
+    // spdlog
+    using spdlog::details::registry;
+    using spdlog::details::thread_pool;
+    using spdlog::sinks::sink;
+
+    // std
+    using std::lock_guard;
+    using std::move;
+    using std::mutex;
+    using std::shared_ptr;
+    using std::string;
+    using std::unordered_map;
+
+    lock_guard<mutex> lock(applied_config_mutex());
+
+    // another thread may have built it while waiting for the lock
+    if (const auto logger = spdlog::get(name)) {
+        return logger;
+    }
+
+    auto &state = applied_config_state();
+
+    if (!state.lazy || !state.config) {
+        return nullptr;
+    }
+
+    const auto &config = state.config;
+    const auto logger_table =
+        find_item_by_name(*config->get_table_array(LOGGER_TABLE), name);
+
+    if (!logger_table) {
+        return nullptr;
+    }
+
+    // only the sinks of this logger are built, reusing those already built
+    unordered_map<string, shared_ptr<sink>> sinks_map;
+
+    const auto sink_names = *logger_table->get_array_of<string>(SINKS);
+
+    for (const auto &sink_name : sink_names) {
+        if (sinks_map.count(sink_name)) {
+            continue;
+        }
+
+        const auto built_itr = state.sinks_map.find(sink_name);
+        auto sink = built_itr != state.sinks_map.cend()
+                        ? built_itr->second.lock()
+                        : nullptr;
+
+        if (!sink) {
+            const auto sink_table = find_item_by_name(
+                *config->get_table_array(SINK_TABLE), sink_name);
+
+            if (!sink_table) {
+                throw setup_error(format(
+                    "Unable to find sink '{}' for logger '{}'",
+                    sink_name,
+                    name));
+            }
+
+            sink = add_msg_on_err(
+                [&sink_table] { return setup_sink(sink_table); },
+                [&sink_name](const string &err_msg) {
+                    return format(
+                        "Sink '{}' error:\n > {}", sink_name, err_msg);
+                });
+        }
+
+        sinks_map.emplace(sink_name, move(sink));
+    }
+
+    // likewise for the thread pool of an async logger
+    unordered_map<string, shared_ptr<thread_pool>> thread_pools_map;
+    shared_ptr<thread_pool> global_thread_pool;
+
+    const auto type_opt = logger_table->get_as<string>(TYPE);
+    const auto is_async = type_opt && *type_opt == names::ASYNC;
+    const auto pool_name_opt = logger_table->get_as<string>(THREAD_POOL);
+
+    if (is_async && pool_name_opt) {
+        const auto built_itr = state.thread_pools_map.find(*pool_name_opt);
+
+        thread_pools_map.emplace(
+            *pool_name_opt,
+            built_itr != state.thread_pools_map.cend()
+                ? built_itr->second
+                : setup_thread_pool(
+                      *pool_name_opt,
+                      find_item_by_name(
+                          *config->get_table_array(THREAD_POOL_TABLE),
+                          *pool_name_opt)));
+    } else if (is_async && state.global_thread_pool_pending) {
+        global_thread_pool = setup_global_thread_pool(
+            config->get_table(GLOBAL_THREAD_POOL_TABLE));
+    }
+
+    const auto logger = setup_logger(
+        logger_table,
+        sinks_map,
+        setup_patterns(config),
+        thread_pools_map,
+        value_from_table_opt<string>(config, GLOBAL_PATTERN),
+        global_thread_pool);
+
+    // only commit once everything is built
+    if (global_thread_pool) {
+        registry::instance().set_tp(global_thread_pool);
+        state.global_thread_pool_pending = false;
+    }
+
+    spdlog::register_logger(logger);
+
+    for (const auto &sink_pair : sinks_map) {
+        state.sinks_map[sink_pair.first] = sink_pair.second;
+    }
+
+    state.thread_pools_map.insert(
+        thread_pools_map.cbegin(), thread_pools_map.cend());
+
+    state.loggers_map[name] = logger;
+
+    // the intervals were already checked when the configuration was applied
+    periodic_flusher_instance().schedule(periodic_flushes_from_config(
+        *config, state.sinks_map, state.loggers_map));
+
+    return logger;
 }
 } // namespace details
 } // namespace spdlog_setup
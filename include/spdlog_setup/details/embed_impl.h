@@ -0,0 +1,483 @@
+/**
+ * Implementation of configuration embedded at build time in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "conf_impl.h"
+#include "setup_error.h"
+#include "template_impl.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Describes the kind of an embedded configuration node.
+ */
+enum class embedded_kind : uint8_t {
+    /** Represents a table, whose children are its key-value pairs */
+    Table,
+
+    /** Represents an array of tables, whose children are tables */
+    TableArray,
+
+    /** Represents an array of values, whose children are values */
+    Array,
+
+    /** Represents a string value */
+    String,
+
+    /** Represents an integer value */
+    Integer,
+
+    /** Represents a floating point value */
+    Float,
+
+    /** Represents a boolean value */
+    Boolean,
+};
+
+/**
+ * Literal type node of configuration tree embedded as constexpr data by
+ * spdlog_setup_embed. The tree is flattened in pre-order, where every
+ * container is directly followed by its children and their descendants.
+ */
+struct embedded_node {
+    /** Kind of node */
+    embedded_kind kind;
+
+    /** Key of node within its parent table, nullptr within arrays */
+    const char *key;
+
+    /** Number of direct children for containers, 0 for values */
+    size_t children;
+
+    /** Content of string value */
+    const char *string_value;
+
+    /** Size of string value, which may contain embedded null characters */
+    size_t string_size;
+
+    /** Content of integer value */
+    int64_t integer_value;
+
+    /** Content of floating point value */
+    double float_value;
+
+    /** Content of boolean value */
+    bool boolean_value;
+};
+
+/**
+ * Rebuilds the configuration tree from flattened embedded nodes.
+ * @param nodes Start of embedded nodes, the first of which must be the root
+ * table.
+ * @param count Number of embedded nodes.
+ * @return Rebuilt configuration tree.
+ * @throw setup_error
+ */
+auto table_from_embedded(const embedded_node *nodes, const size_t count)
+    -> std::shared_ptr<cpptoml::table>;
+
+/**
+ * Writes the C++ header embedding the configuration as constexpr nodes, with
+ * setup_embedded() entry points in the given namespace.
+ * @param os Stream to write the header into.
+ * @param config Configuration to be embedded.
+ * @param ns_name Name of the namespace within spdlog_setup::embedded.
+ * @param source_name Name of the configuration file, for the header comment.
+ * @throw setup_error
+ */
+void write_embedded_header(
+    std::ostream &os,
+    const cpptoml::table &config,
+    const std::string &ns_name,
+    const std::string &source_name);
+
+// implementation section
+
+inline auto base_from_embedded(
+    const embedded_node *&curr, const embedded_node *const end)
+    -> std::shared_ptr<cpptoml::base>;
+
+inline auto table_children_from_embedded(
+    const embedded_node &table_node,
+    const embedded_node *&curr,
+    const embedded_node *const end) -> std::shared_ptr<cpptoml::table> {
+
+    const auto table = cpptoml::make_table();
+
+    for (size_t i = 0; i < table_node.children; ++i) {
+        if (curr == end || !curr->key) {
+            throw setup_error("Embedded table has invalid child node");
+        }
+
+        const auto key = curr->key;
+        table->insert(key, base_from_embedded(curr, end));
+    }
+
+    return table;
+}
+
+inline auto base_from_embedded(
+    const embedded_node *&curr, const embedded_node *const end)
+    -> std::shared_ptr<cpptoml::base> {
+
+    // std
+    using std::string;
+
+    if (curr == end) {
+        throw setup_error("Embedded nodes are truncated");
+    }
+
+    const auto &node = *curr++;
+
+    switch (node.kind) {
+    case embedded_kind::Table:
+        return table_children_from_embedded(node, curr, end);
+
+    case embedded_kind::TableArray: {
+        const auto items = cpptoml::make_table_array();
+        items->reserve(node.children);
+
+        for (size_t i = 0; i < node.children; ++i) {
+            if (curr == end || curr->kind != embedded_kind::Table) {
+                throw setup_error("Embedded table array has non-table item");
+            }
+
+            const auto &item_node = *curr++;
+            items->push_back(
+                table_children_from_embedded(item_node, curr, end));
+        }
+
+        return items;
+    }
+
+    case embedded_kind::Array: {
+        const auto items = cpptoml::make_array();
+        items->get().reserve(node.children);
+
+        for (size_t i = 0; i < node.children; ++i) {
+            items->get().push_back(base_from_embedded(curr, end));
+        }
+
+        return items;
+    }
+
+    case embedded_kind::String:
+        return cpptoml::make_value<string>(
+            string(node.string_value, node.string_size));
+
+    case embedded_kind::Integer:
+        return cpptoml::make_value<int64_t>(int64_t(node.integer_value));
+
+    case embedded_kind::Float:
+        return cpptoml::make_value<double>(double(node.float_value));
+
+    case embedded_kind::Boolean:
+        return cpptoml::make_value<bool>(bool(node.boolean_value));
+
+    default:
+        throw setup_error("Embedded nodes contain unknown node kind");
+    }
+}
+
+inline auto table_from_embedded(const embedded_node *nodes, const size_t count)
+    -> std::shared_ptr<cpptoml::table> {
+
+    if (count == 0 || nodes[0].kind != embedded_kind::Table) {
+        throw setup_error("Embedded nodes must start with the root table");
+    }
+
+    const auto end = nodes + count;
+    auto curr = nodes + 1;
+
+    auto config = table_children_from_embedded(nodes[0], curr, end);
+
+    if (curr != end) {
+        throw setup_error("Embedded nodes have trailing nodes");
+    }
+
+    return config;
+}
+
+inline auto embedded_string_literal(const std::string &s) -> std::string {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    string literal;
+    literal.reserve(s.size() + 2);
+    literal.push_back('"');
+
+    for (const auto c : s) {
+        switch (c) {
+        case '"':
+            literal.append("\\\"");
+            break;
+        case '\\':
+            literal.append("\\\\");
+            break;
+        case '?':
+            // prevents trigraphs
+            literal.append("\\?");
+            break;
+        default:
+            if (c >= ' ' && c <= '~') {
+                literal.push_back(c);
+            } else {
+                // fixed width octal cannot swallow any following digit
+                literal.append(
+                    format("\\{:03o}", static_cast<unsigned char>(c)));
+            }
+            break;
+        }
+    }
+
+    literal.push_back('"');
+    return literal;
+}
+
+inline auto embedded_integer_literal(const int64_t value) -> std::string {
+    if (value == std::numeric_limits<int64_t>::min()) {
+        return "(-9223372036854775807LL - 1)";
+    }
+
+    return fmt::format("{}LL", value);
+}
+
+inline auto embedded_float_literal(const double value) -> std::string {
+    // std
+    using std::numeric_limits;
+    using std::ostringstream;
+
+    if (value != value) {
+        return "std::numeric_limits<double>::quiet_NaN()";
+    } else if (value == numeric_limits<double>::infinity()) {
+        return "std::numeric_limits<double>::infinity()";
+    } else if (value == -numeric_limits<double>::infinity()) {
+        return "-std::numeric_limits<double>::infinity()";
+    }
+
+    ostringstream ostr;
+    ostr.imbue(std::locale::classic());
+    ostr.precision(numeric_limits<double>::max_digits10);
+    ostr << value;
+    return ostr.str();
+}
+
+inline void write_embedded_node(
+    std::ostream &os,
+    const char *kind,
+    const std::string &key_literal,
+    const size_t children,
+    const std::string &string_literal = "nullptr",
+    const size_t string_size = 0,
+    const std::string &integer_literal = "0",
+    const std::string &float_literal = "0.0",
+    const bool boolean_value = false) {
+
+    os << "    {details::embedded_kind::" << kind << ", " << key_literal << ", "
+       << children << ", " << string_literal << ", " << string_size << ", "
+       << integer_literal << ", " << float_literal << ", "
+       << (boolean_value ? "true" : "false") << "},\n";
+}
+
+inline void write_embedded_base(
+    std::ostream &os,
+    const std::shared_ptr<cpptoml::base> &node,
+    const std::string &key_literal,
+    const std::string &path);
+
+inline void write_embedded_table(
+    std::ostream &os,
+    const cpptoml::table &table,
+    const std::string &key_literal,
+    const std::string &path) {
+
+    // std
+    using std::sort;
+    using std::string;
+    using std::vector;
+
+    // sorted so that the generated header does not depend on hash ordering
+    vector<string> keys;
+    keys.reserve(std::distance(table.begin(), table.end()));
+
+    for (const auto &entry : table) {
+        keys.push_back(entry.first);
+    }
+
+    sort(keys.begin(), keys.end());
+
+    write_embedded_node(os, "Table", key_literal, keys.size());
+
+    for (const auto &key : keys) {
+        write_embedded_base(
+            os,
+            table.get(key),
+            embedded_string_literal(key),
+            path.empty() ? key : path + "." + key);
+    }
+}
+
+inline void write_embedded_base(
+    std::ostream &os,
+    const std::shared_ptr<cpptoml::base> &node,
+    const std::string &key_literal,
+    const std::string &path) {
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    if (node->is_table()) {
+        write_embedded_table(os, *node->as_table(), key_literal, path);
+    } else if (node->is_table_array()) {
+        const auto &items = node->as_table_array()->get();
+        write_embedded_node(os, "TableArray", key_literal, items.size());
+
+        for (const auto &item : items) {
+            write_embedded_table(os, *item, "nullptr", path);
+        }
+    } else if (node->is_array()) {
+        const auto &items = node->as_array()->get();
+        write_embedded_node(os, "Array", key_literal, items.size());
+
+        for (const auto &item : items) {
+            write_embedded_base(os, item, "nullptr", path);
+        }
+    } else if (const auto str = node->as<string>()) {
+        write_embedded_node(
+            os,
+            "String",
+            key_literal,
+            0,
+            embedded_string_literal(str->get()),
+            str->get().size());
+    } else if (const auto integer = node->as<int64_t>()) {
+        write_embedded_node(
+            os,
+            "Integer",
+            key_literal,
+            0,
+            "nullptr",
+            0,
+            embedded_integer_literal(integer->get()));
+    } else if (const auto floating = node->as<double>()) {
+        write_embedded_node(
+            os,
+            "Float",
+            key_literal,
+            0,
+            "nullptr",
+            0,
+            "0",
+            embedded_float_literal(floating->get()));
+    } else if (const auto boolean = node->as<bool>()) {
+        write_embedded_node(
+            os,
+            "Boolean",
+            key_literal,
+            0,
+            "nullptr",
+            0,
+            "0",
+            "0.0",
+            boolean->get());
+    } else {
+        throw setup_error(
+            format("Value of unsupported type found at '{}' to embed", path));
+    }
+}
+
+inline void write_embedded_header(
+    std::ostream &os,
+    const cpptoml::table &config,
+    const std::string &ns_name,
+    const std::string &source_name) {
+
+    // fmt
+    using fmt::format;
+
+    if (ns_name.empty() || (ns_name[0] >= '0' && ns_name[0] <= '9') ||
+        !std::all_of(ns_name.cbegin(), ns_name.cend(), is_valid_var_char)) {
+
+        throw setup_error(
+            format("Invalid namespace name '{}' to embed into", ns_name));
+    }
+
+    os << "// Generated by spdlog_setup_embed from '" << source_name
+       << "'. Do not edit.\n"
+          "\n"
+          "#pragma once\n"
+          "\n"
+          "#include \"spdlog_setup/conf.h\"\n"
+          "\n"
+          "#include <cstddef>\n"
+          "#include <limits>\n"
+          "#include <string>\n"
+          "\n"
+          "namespace spdlog_setup {\n"
+          "namespace embedded {\n"
+          "namespace "
+       << ns_name
+       << " {\n"
+          "constexpr details::embedded_node NODES[] = {\n";
+
+    write_embedded_table(os, config, "nullptr", "");
+
+    os << "};\n"
+          "\n"
+          "constexpr size_t NODE_COUNT = sizeof(NODES) / sizeof(NODES[0]);\n"
+          "\n"
+          "/**\n"
+          " * Performs spdlog configuration setup from the embedded "
+          "configuration.\n"
+          " * @throw setup_error\n"
+          " */\n"
+          "inline void setup_embedded() {\n"
+          "    spdlog_setup::from_embedded(NODES, NODE_COUNT);\n"
+          "}\n"
+          "\n"
+          "/**\n"
+          " * Performs spdlog configuration setup from the embedded "
+          "configuration,\n"
+          " * with the override file merged on top if present.\n"
+          " * @param override_toml_path Path to the override TOML "
+          "configuration file.\n"
+          " * @return true if override file is used, otherwise false.\n"
+          " * @throw setup_error\n"
+          " */\n"
+          "inline auto setup_embedded(const std::string &override_toml_path) "
+          "-> bool {\n"
+          "    return spdlog_setup::from_embedded_and_override(\n"
+          "        NODES, NODE_COUNT, override_toml_path);\n"
+          "}\n"
+          "} // namespace "
+       << ns_name
+       << "\n"
+          "} // namespace embedded\n"
+          "} // namespace spdlog_setup\n";
+}
+} // namespace details
+} // namespace spdlog_setup
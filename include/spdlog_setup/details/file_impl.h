@@ -0,0 +1,446 @@
+/**
+ * Implementation of file access helpers in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "setup_error.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Describes the subset of file metadata used to detect file changes.
+ */
+struct file_stat {
+    /** true if the file exists, in which case the other fields are valid */
+    bool exists;
+
+    /** Size of the file in bytes */
+    uint64_t size;
+
+    /** Seconds part of the last modification time */
+    int64_t mtime_sec;
+
+    /** Nanoseconds part of the last modification time, 0 if unsupported */
+    int64_t mtime_nsec;
+};
+
+/**
+ * Read-only memory mapping over the entire content of a file. Empty files are
+ * represented by an empty range without any mapping.
+ */
+class mapped_file {
+  public:
+    /**
+     * Maps the file at the given path.
+     * @param file_path Path of the file to map.
+     * @throw setup_error
+     */
+    explicit mapped_file(const std::string &file_path);
+
+    mapped_file(const mapped_file &) = delete;
+    auto operator=(const mapped_file &) -> mapped_file & = delete;
+
+    ~mapped_file();
+
+    /**
+     * Returns the start of the mapped file content.
+     * @return Start of the mapped content.
+     */
+    auto data() const noexcept -> const char *;
+
+    /**
+     * Returns the size of the mapped file content.
+     * @return Size of the mapped content in bytes.
+     */
+    auto size() const noexcept -> size_t;
+
+  private:
+    const char *file_data;
+    size_t file_size;
+
+#ifdef _WIN32
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#endif
+};
+
+/**
+ * Read-only stream buffer directly over an existing range of bytes, so that
+ * the bytes can be read through std::istream without being copied.
+ */
+class memory_streambuf : public std::streambuf {
+  public:
+    /**
+     * Constructor accepting the range of bytes to read from. The range must
+     * outlive the stream buffer.
+     * @param data Start of the range.
+     * @param size Size of the range in bytes.
+     */
+    memory_streambuf(const char *data, const size_t size);
+};
+
+// implementation section
+
+inline auto stat_file(const std::string &file_path) noexcept -> file_stat {
+#ifdef _WIN32
+    struct _stat64 st;
+
+    if (_stat64(file_path.c_str(), &st) != 0) {
+        return file_stat{false, 0, 0, 0};
+    }
+
+    return file_stat{true,
+                     static_cast<uint64_t>(st.st_size),
+                     static_cast<int64_t>(st.st_mtime),
+                     0};
+#else
+    struct stat st;
+
+    if (stat(file_path.c_str(), &st) != 0) {
+        return file_stat{false, 0, 0, 0};
+    }
+
+#if defined(__APPLE__)
+    const auto mtime_nsec = st.st_mtimespec.tv_nsec;
+#else
+    const auto mtime_nsec = st.st_mtim.tv_nsec;
+#endif
+
+    return file_stat{true,
+                     static_cast<uint64_t>(st.st_size),
+                     static_cast<int64_t>(st.st_mtime),
+                     static_cast<int64_t>(mtime_nsec)};
+#endif
+}
+
+inline auto hash_bytes(const char *data, const size_t size) noexcept
+    -> uint64_t {
+    // 64-bit FNV-1a
+    static constexpr uint64_t OFFSET_BASIS = 14695981039346656037ull;
+    static constexpr uint64_t PRIME = 1099511628211ull;
+
+    auto hash = OFFSET_BASIS;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= PRIME;
+    }
+
+    return hash;
+}
+
+inline mapped_file::mapped_file(const std::string &file_path)
+    : file_data(""), file_size(0)
+#ifdef _WIN32
+      ,
+      file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr)
+#endif
+{
+    // fmt
+    using fmt::format;
+
+#ifdef _WIN32
+    file_handle = CreateFileA(
+        file_path.c_str(),
+        GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw setup_error(format("Error reading file at '{}'", file_path));
+    }
+
+    LARGE_INTEGER size;
+
+    if (!GetFileSizeEx(file_handle, &size)) {
+        CloseHandle(file_handle);
+        throw setup_error(format("Unable to get size of '{}'", file_path));
+    }
+
+    if (size.QuadPart == 0) {
+        return;
+    }
+
+    mapping_handle =
+        CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+    if (!mapping_handle) {
+        CloseHandle(file_handle);
+        throw setup_error(format("Unable to map file at '{}'", file_path));
+    }
+
+    const auto view = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+
+    if (!view) {
+        CloseHandle(mapping_handle);
+        CloseHandle(file_handle);
+        throw setup_error(format("Unable to map file at '{}'", file_path));
+    }
+
+    file_data = static_cast<const char *>(view);
+    file_size = static_cast<size_t>(size.QuadPart);
+#else
+    const auto fd = open(file_path.c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        throw setup_error(format("Error reading file at '{}'", file_path));
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw setup_error(format("Unable to get size of '{}'", file_path));
+    }
+
+    if (st.st_size == 0) {
+        close(fd);
+        return;
+    }
+
+    const auto size = static_cast<size_t>(st.st_size);
+    const auto addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping remains valid after the descriptor is closed
+    close(fd);
+
+    if (addr == MAP_FAILED) {
+        throw setup_error(format("Unable to map file at '{}'", file_path));
+    }
+
+    file_data = static_cast<const char *>(addr);
+    file_size = size;
+#endif
+}
+
+inline mapped_file::~mapped_file() {
+#ifdef _WIN32
+    if (mapping_handle) {
+        UnmapViewOfFile(file_data);
+        CloseHandle(mapping_handle);
+    }
+
+    if (file_handle != INVALID_HANDLE_VALUE) {
+        CloseHandle(file_handle);
+    }
+#else
+    if (file_size != 0) {
+        munmap(const_cast<char *>(file_data), file_size);
+    }
+#endif
+}
+
+inline auto mapped_file::data() const noexcept -> const char * {
+    return file_data;
+}
+
+inline auto mapped_file::size() const noexcept -> size_t { return file_size; }
+
+inline memory_streambuf::memory_streambuf(const char *data, const size_t size) {
+    // the get area is never written to, so casting away const is safe
+    const auto begin = const_cast<char *>(data);
+    setg(begin, begin, begin + size);
+}
+
+inline auto parent_dir_of(const std::string &file_path) -> std::string {
+    // std
+    using std::string;
+
+#ifdef _WIN32
+    const auto last_slash_index = file_path.find_last_of("/\\");
+#else
+    const auto last_slash_index = file_path.find_last_of('/');
+#endif
+
+    return last_slash_index == string::npos
+               ? string(".")
+               : last_slash_index == 0 ? file_path.substr(0, 1)
+                                       : file_path.substr(0, last_slash_index);
+}
+
+inline void write_file_atomically(
+    const std::string &file_path, const std::string &content) {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::string;
+
+    const auto dir_path = parent_dir_of(file_path);
+
+#ifdef _WIN32
+    // unique within the directory, so concurrent writers never share it
+    char tmp_path_buf[MAX_PATH];
+
+    if (GetTempFileNameA(dir_path.c_str(), "sps", 0, tmp_path_buf) == 0) {
+        throw setup_error(format(
+            "Unable to create temporary file for '{}', error {}",
+            file_path,
+            GetLastError()));
+    }
+
+    const string tmp_path(tmp_path_buf);
+
+    const auto tmp_handle = CreateFileA(
+        tmp_path.c_str(),
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        TRUNCATE_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (tmp_handle == INVALID_HANDLE_VALUE) {
+        DeleteFileA(tmp_path.c_str());
+        throw setup_error(format("Unable to open '{}' for writing", tmp_path));
+    }
+
+    DWORD written = 0;
+
+    const auto write_ok =
+        WriteFile(
+            tmp_handle,
+            content.data(),
+            static_cast<DWORD>(content.size()),
+            &written,
+            nullptr) &&
+        written == content.size() && FlushFileBuffers(tmp_handle);
+
+    CloseHandle(tmp_handle);
+
+    if (!write_ok) {
+        DeleteFileA(tmp_path.c_str());
+        throw setup_error(format("Unable to write into '{}'", tmp_path));
+    }
+
+    // write-through returns only once the replacement is on disk
+    const auto renamed =
+        MoveFileExA(
+            tmp_path.c_str(),
+            file_path.c_str(),
+            MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+
+    if (!renamed) {
+        DeleteFileA(tmp_path.c_str());
+        throw setup_error(
+            format("Unable to replace '{}' with '{}'", file_path, tmp_path));
+    }
+#else
+    // unique within the directory, so concurrent writers never share it
+    string tmp_path = file_path + ".XXXXXX";
+    const auto fd = mkstemp(&tmp_path[0]);
+
+    if (fd < 0) {
+        throw setup_error(format(
+            "Unable to create temporary file for '{}': {}",
+            file_path,
+            std::strerror(errno)));
+    }
+
+    const auto fail = [fd, &tmp_path](const string &msg) {
+        const auto error = errno;
+        close(fd);
+        unlink(tmp_path.c_str());
+        return setup_error(format("{}: {}", msg, std::strerror(error)));
+    };
+
+    // mkstemp creates the file readable only by its owner
+    struct stat st;
+    const auto mode = stat(file_path.c_str(), &st) == 0 ? st.st_mode & 07777
+                                                        : mode_t(0644);
+
+    if (fchmod(fd, mode) != 0) {
+        throw fail(format("Unable to set the mode of '{}'", tmp_path));
+    }
+
+    size_t offset = 0;
+
+    while (offset < content.size()) {
+        const auto count =
+            ::write(fd, content.data() + offset, content.size() - offset);
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw fail(format("Unable to write into '{}'", tmp_path));
+        }
+
+        offset += static_cast<size_t>(count);
+    }
+
+    // the content must be on disk before the rename can be
+    if (fsync(fd) != 0) {
+        throw fail(format("Unable to sync '{}'", tmp_path));
+    }
+
+    close(fd);
+
+    // rename is atomic for paths within the same file system
+    if (std::rename(tmp_path.c_str(), file_path.c_str()) != 0) {
+        const auto error = errno;
+        unlink(tmp_path.c_str());
+
+        throw setup_error(format(
+            "Unable to replace '{}' with '{}': {}",
+            file_path,
+            tmp_path,
+            std::strerror(error)));
+    }
+
+    // makes the rename itself durable
+    const auto dir_fd = open(dir_path.c_str(), O_RDONLY | O_CLOEXEC);
+
+    if (dir_fd < 0) {
+        throw setup_error(format(
+            "Unable to open directory '{}': {}",
+            dir_path,
+            std::strerror(errno)));
+    }
+
+    // some file systems cannot sync directories, which is not an error
+    const auto synced = fsync(dir_fd) == 0 || errno == EINVAL;
+    const auto error = errno;
+    close(dir_fd);
+
+    if (!synced) {
+        throw setup_error(format(
+            "Unable to sync directory '{}': {}",
+            dir_path,
+            std::strerror(error)));
+    }
+#endif
+}
+} // namespace details
+} // namespace spdlog_setup
@@ -0,0 +1,305 @@
+/**
+ * Implementation of periodic flushing in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "spdlog/logger.h"
+#include "spdlog/sinks/sink.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Describes a logger or sink to flush periodically, which is only observed,
+ * so that dropping it still releases it.
+ */
+struct periodic_flush {
+    /** Logger to flush, empty if flushing a sink */
+    std::weak_ptr<spdlog::logger> logger;
+
+    /** Sink to flush, empty if flushing a logger */
+    std::weak_ptr<spdlog::sinks::sink> sink;
+
+    /** Time between flushes */
+    std::chrono::microseconds interval;
+};
+
+/**
+ * Hashed timer wheel, where each timer sits in the slot it expires in, with
+ * the number of further turns of the wheel to wait before expiring, so that
+ * adding a timer and advancing a tick only touch a single slot.
+ */
+class timer_wheel {
+  public:
+    /** Time that each slot spans */
+    static constexpr int64_t TICK_US = 10000;
+
+    /** Number of slots, so that a turn of the wheel takes 5.12s */
+    static constexpr size_t SLOTS_COUNT = 512;
+
+    timer_wheel();
+
+    /**
+     * Adds a timer expiring after the given number of ticks from now.
+     * @param id Identifier of the timer, returned when it expires.
+     * @param ticks Number of ticks from now, at least one.
+     */
+    void add(const size_t id, const uint64_t ticks);
+
+    /**
+     * Moves to the next tick, expiring the timers of its slot that are on
+     * their last turn.
+     * @param expired Cleared, then filled with the expired timers.
+     */
+    void advance(std::vector<size_t> &expired);
+
+    /**
+     * Returns the number of ticks until the next slot with timers.
+     * @return Ticks until the next slot with timers, zero if no timers.
+     */
+    auto ticks_to_next_slot() const -> uint64_t;
+
+    /**
+     * Removes all timers.
+     */
+    void clear();
+
+  private:
+    struct timer {
+        size_t id;
+        uint64_t turns;
+    };
+
+    std::vector<std::vector<timer>> slots;
+    uint64_t current_tick;
+};
+
+/**
+ * Background thread that flushes loggers and sinks at their intervals, where
+ * all intervals share the single thread through a timer_wheel, whose tick
+ * bounds how late each flush may be.
+ */
+class periodic_flusher {
+  public:
+    periodic_flusher() = default;
+    periodic_flusher(const periodic_flusher &) = delete;
+
+    auto operator=(const periodic_flusher &) -> periodic_flusher & = delete;
+
+    /**
+     * Stops the thread, without any further flushes.
+     */
+    ~periodic_flusher();
+
+    /**
+     * Replaces every flush scheduled so far, where each first happens an
+     * interval from now. Starts the thread on the first call with any flush.
+     * @param flushes Loggers and sinks to flush periodically.
+     */
+    void schedule(std::vector<periodic_flush> flushes);
+
+  private:
+    void run();
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<periodic_flush> flushes;
+    bool changed = false;
+    bool stopping = false;
+    std::thread thread;
+};
+
+/**
+ * Returns the process-wide periodic flusher, which is destroyed before the
+ * spdlog registry, since it is first used after the registry.
+ * @return Periodic flusher.
+ */
+auto periodic_flusher_instance() -> periodic_flusher &;
+
+// implementation section
+
+inline timer_wheel::timer_wheel() : slots(SLOTS_COUNT), current_tick(0) {}
+
+inline void timer_wheel::add(const size_t id, const uint64_t ticks) {
+    // a timer expiring a whole turn away sits in the current slot
+    const auto due_ticks = ticks > 0 ? ticks : 1;
+
+    slots[(current_tick + due_ticks) % SLOTS_COUNT].push_back(
+        timer{id, (due_ticks - 1) / SLOTS_COUNT});
+}
+
+inline void timer_wheel::advance(std::vector<size_t> &expired) {
+    expired.clear();
+    ++current_tick;
+
+    auto &slot = slots[current_tick % SLOTS_COUNT];
+
+    for (size_t i = 0; i < slot.size();) {
+        if (slot[i].turns > 0) {
+            --slot[i].turns;
+            ++i;
+        } else {
+            expired.push_back(slot[i].id);
+            slot[i] = slot.back();
+            slot.pop_back();
+        }
+    }
+}
+
+inline auto timer_wheel::ticks_to_next_slot() const -> uint64_t {
+    for (uint64_t ticks = 1; ticks <= SLOTS_COUNT; ++ticks) {
+        if (!slots[(current_tick + ticks) % SLOTS_COUNT].empty()) {
+            return ticks;
+        }
+    }
+
+    return 0;
+}
+
+inline void timer_wheel::clear() {
+    for (auto &slot : slots) {
+        slot.clear();
+    }
+}
+
+inline periodic_flusher::~periodic_flusher() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+
+    cv.notify_one();
+
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+inline void periodic_flusher::schedule(std::vector<periodic_flush> flushes) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        this->flushes = std::move(flushes);
+        changed = true;
+
+        if (!thread.joinable() && !this->flushes.empty()) {
+            thread = std::thread([this] { run(); });
+        }
+    }
+
+    cv.notify_one();
+}
+
+inline void periodic_flusher::run() {
+    // std
+    using std::exception;
+    using std::unique_lock;
+    using std::vector;
+    using std::chrono::microseconds;
+    using std::chrono::steady_clock;
+
+    const int64_t tick_us = timer_wheel::TICK_US;
+    const auto tick = microseconds(tick_us);
+
+    const auto ticks_of = [tick_us](const microseconds interval) -> uint64_t {
+        const auto count = interval.count();
+
+        // rounded up, so that flushes are never more frequent than asked
+        return count > 0
+                   ? static_cast<uint64_t>((count + tick_us - 1) / tick_us)
+                   : 1;
+    };
+
+    timer_wheel wheel;
+    vector<periodic_flush> current_flushes;
+    vector<size_t> expired;
+    auto current_time = steady_clock::now();
+
+    unique_lock<std::mutex> lock(mutex);
+
+    while (!stopping) {
+        if (changed) {
+            changed = false;
+            current_flushes = flushes;
+            current_time = steady_clock::now();
+            wheel.clear();
+
+            for (size_t i = 0; i < current_flushes.size(); ++i) {
+                wheel.add(i, ticks_of(current_flushes[i].interval));
+            }
+        }
+
+        const auto ticks = wheel.ticks_to_next_slot();
+
+        if (ticks == 0) {
+            cv.wait(lock, [this] { return stopping || changed; });
+            continue;
+        }
+
+        const auto wake_time =
+            current_time + tick * static_cast<int64_t>(ticks);
+
+        if (cv.wait_until(
+                lock, wake_time, [this] { return stopping || changed; })) {
+            continue;
+        }
+
+        for (uint64_t i = 0; i < ticks; ++i) {
+            current_time += tick;
+            wheel.advance(expired);
+
+            for (const auto id : expired) {
+                wheel.add(id, ticks_of(current_flushes[id].interval));
+            }
+        }
+
+        // loggers and sinks are flushed without blocking schedule
+        lock.unlock();
+
+        for (const auto id : expired) {
+            const auto &flush = current_flushes[id];
+
+            try {
+                if (const auto logger = flush.logger.lock()) {
+                    logger->flush();
+                } else if (const auto sink = flush.sink.lock()) {
+                    sink->flush();
+                }
+            } catch (const exception &) {
+                // a failing flush is retried at its next interval
+            }
+        }
+
+        lock.lock();
+
+        // after a slow flush, every later flush is pushed back together
+        // instead of being done in a burst to catch up
+        const auto now = steady_clock::now();
+
+        if (now - current_time > tick) {
+            current_time = now;
+        }
+    }
+}
+
+inline auto periodic_flusher_instance() -> periodic_flusher & {
+    static periodic_flusher flusher;
+    return flusher;
+}
+} // namespace details
+} // namespace spdlog_setup
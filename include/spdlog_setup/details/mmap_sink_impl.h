@@ -0,0 +1,489 @@
+/**
+ * Implementation of the memory-mapped file sinks in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "stats_impl.h"
+
+#include "spdlog/common.h"
+#include "spdlog/details/log_msg.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/sinks/base_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <string>
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Appends bytes to a file by copying them into a writable memory mapping over
+ * the end of the file. The file is extended, and the mapping moved along, one
+ * chunk at a time, so appending within a chunk makes no system call. Until
+ * closed, the file is therefore larger than the bytes appended, and padded
+ * with zero bytes, which are truncated away on closing. A file left padded by
+ * a crash is appended to after its padding, since zero bytes written by the
+ * application cannot be told apart from it.
+ */
+class mapped_appender {
+  public:
+    /**
+     * Opens the file at the given path and maps its first chunk.
+     * @param filename Path of the file to append to.
+     * @param chunk_size Number of bytes by which the file is extended.
+     * @param truncate true to discard the existing content of the file.
+     * @throw spdlog::spdlog_ex
+     */
+    mapped_appender(
+        const std::string &filename,
+        const uint64_t chunk_size,
+        const bool truncate);
+
+    mapped_appender(const mapped_appender &) = delete;
+    auto operator=(const mapped_appender &) -> mapped_appender & = delete;
+
+    /**
+     * Unmaps the file and truncates it to the bytes appended.
+     */
+    ~mapped_appender();
+
+    /**
+     * Copies the given bytes to the end of the file.
+     * @param data Start of the bytes to append.
+     * @param size Number of bytes to append.
+     * @throw spdlog::spdlog_ex
+     */
+    void append(const char *data, const size_t size);
+
+    /**
+     * Schedules the bytes appended since the last call to be written back to
+     * the file, without waiting for them.
+     * @throw spdlog::spdlog_ex
+     */
+    void sync();
+
+    /**
+     * Returns the size of the file content, without the padding.
+     * @return Size of the file content in bytes.
+     */
+    auto size() const noexcept -> uint64_t;
+
+  private:
+    void map_window(const size_t min_size);
+    void unmap_window() noexcept;
+    void reserve(const uint64_t file_size);
+
+    const std::string filename;
+    const uint64_t chunk_size;
+    uint64_t written;
+    uint64_t synced;
+    uint64_t reserved;
+    uint64_t window_offset;
+    size_t window_size;
+    char *window;
+
+#ifdef _WIN32
+    HANDLE file_handle;
+    HANDLE mapping_handle;
+#else
+    int fd;
+#endif
+};
+} // namespace details
+
+/**
+ * Sink that writes formatted messages into a memory-mapped file, which grows
+ * in chunks of configurable size. Messages are written by the kernel even if
+ * the process crashes, and without any system call per message. While the
+ * sink is open, readers of the file see the zero bytes padding the current
+ * chunk after the last message.
+ */
+template <class Mutex>
+class mmap_file_sink : public spdlog::sinks::base_sink<Mutex> {
+  public:
+    /**
+     * Constructor accepting the file to write into.
+     * @param filename Path of the file to write into.
+     * @param chunk_size Number of bytes by which the file is extended.
+     * @param truncate true to discard the existing content of the file.
+     * @throw spdlog::spdlog_ex
+     */
+    mmap_file_sink(
+        const std::string &filename,
+        const uint64_t chunk_size,
+        const bool truncate = false);
+
+    /**
+     * Returns the path of the file written into.
+     * @return Path of the file.
+     */
+    auto filename() const -> const std::string &;
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    const std::string file_path;
+    details::mapped_appender appender;
+};
+
+using mmap_file_sink_mt = mmap_file_sink<std::mutex>;
+using mmap_file_sink_st = mmap_file_sink<spdlog::details::null_mutex>;
+
+namespace details {
+// implementation section
+
+inline auto allocation_granularity() noexcept -> uint64_t {
+#ifdef _WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwAllocationGranularity;
+#else
+    return static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+inline mapped_appender::mapped_appender(
+    const std::string &filename,
+    const uint64_t chunk_size,
+    const bool truncate)
+    : filename(filename), chunk_size(chunk_size), written(0), synced(0),
+      reserved(0), window_offset(0), window_size(0), window(nullptr)
+#ifdef _WIN32
+      ,
+      file_handle(INVALID_HANDLE_VALUE), mapping_handle(nullptr)
+#else
+      ,
+      fd(-1)
+#endif
+{
+    // fmt
+    using fmt::format;
+
+    if (chunk_size == 0) {
+        throw spdlog::spdlog_ex(
+            format("Chunk size of '{}' must be greater than 0", filename));
+    }
+
+#ifdef _WIN32
+    file_handle = CreateFileA(
+        filename.c_str(),
+        GENERIC_READ | GENERIC_WRITE,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        truncate ? CREATE_ALWAYS : OPEN_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr);
+
+    if (file_handle == INVALID_HANDLE_VALUE) {
+        throw spdlog::spdlog_ex(format(
+            "Failed opening file {} for writing, error {}",
+            filename,
+            GetLastError()));
+    }
+
+    LARGE_INTEGER file_size;
+
+    if (!GetFileSizeEx(file_handle, &file_size)) {
+        const auto error = GetLastError();
+        CloseHandle(file_handle);
+
+        throw spdlog::spdlog_ex(format(
+            "Failed getting size of file {}, error {}", filename, error));
+    }
+
+    reserved = static_cast<uint64_t>(file_size.QuadPart);
+#else
+    fd = open(
+        filename.c_str(),
+        O_RDWR | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0),
+        0644);
+
+    if (fd < 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed opening file {} for writing", filename), errno);
+    }
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        const auto error = errno;
+        close(fd);
+
+        throw spdlog::spdlog_ex(
+            format("Failed getting size of file {}", filename), error);
+    }
+
+    reserved = static_cast<uint64_t>(st.st_size);
+#endif
+
+    // the file is truncated to its content on closing
+    written = reserved;
+    synced = reserved;
+
+    try {
+        map_window(0);
+    } catch (...) {
+        unmap_window();
+
+#ifdef _WIN32
+        if (mapping_handle) {
+            CloseHandle(mapping_handle);
+        }
+
+        CloseHandle(file_handle);
+#else
+        close(fd);
+#endif
+
+        throw;
+    }
+}
+
+inline mapped_appender::~mapped_appender() {
+    unmap_window();
+
+#ifdef _WIN32
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+    }
+
+    LARGE_INTEGER end;
+    end.QuadPart = static_cast<LONGLONG>(written);
+
+    if (SetFilePointerEx(file_handle, end, nullptr, FILE_BEGIN)) {
+        SetEndOfFile(file_handle);
+    }
+
+    CloseHandle(file_handle);
+#else
+    // drops the padding of the last chunk
+    if (ftruncate(fd, static_cast<off_t>(written)) != 0) {
+        // nothing else can be done in a destructor
+    }
+
+    close(fd);
+#endif
+}
+
+inline void mapped_appender::append(const char *data, const size_t size) {
+    if (written + size > window_offset + window_size) {
+        map_window(size);
+    }
+
+    std::memcpy(
+        window + static_cast<size_t>(written - window_offset), data, size);
+
+    written += size;
+}
+
+inline void mapped_appender::sync() {
+    // fmt
+    using fmt::format;
+
+    // earlier windows are no longer mapped, and the kernel writes back their
+    // bytes from the page cache on its own
+    const auto begin = std::max(synced, window_offset);
+
+    if (!window || written <= begin) {
+        synced = written;
+        return;
+    }
+
+    // the range must start at a page boundary, which the window starts at
+    const auto page_size = allocation_granularity();
+    const auto offset = (begin - window_offset) / page_size * page_size;
+    const auto size = static_cast<size_t>(written - window_offset - offset);
+
+#ifdef _WIN32
+    if (!FlushViewOfFile(window + offset, size)) {
+        throw spdlog::spdlog_ex(format(
+            "Failed syncing file {}, error {}", filename, GetLastError()));
+    }
+#else
+    if (msync(window + offset, size, MS_ASYNC) != 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed syncing file {}", filename), errno);
+    }
+#endif
+
+    synced = written;
+}
+
+inline auto mapped_appender::size() const noexcept -> uint64_t {
+    return written;
+}
+
+inline void mapped_appender::map_window(const size_t min_size) {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::max;
+
+    unmap_window();
+
+    const auto granularity = allocation_granularity();
+
+    // the mapping must start at a multiple of the allocation granularity, so
+    // it begins with the tail of the previous chunk
+    window_offset = written / granularity * granularity;
+
+    const auto min_window_size =
+        max(chunk_size, written - window_offset + min_size);
+
+    const auto new_window_size =
+        (min_window_size + granularity - 1) / granularity * granularity;
+
+    reserve(window_offset + new_window_size);
+
+#ifdef _WIN32
+    const auto view = MapViewOfFile(
+        mapping_handle,
+        FILE_MAP_WRITE,
+        static_cast<DWORD>(window_offset >> 32),
+        static_cast<DWORD>(window_offset),
+        static_cast<SIZE_T>(new_window_size));
+
+    if (!view) {
+        throw spdlog::spdlog_ex(format(
+            "Failed mapping file {}, error {}", filename, GetLastError()));
+    }
+#else
+    const auto view = mmap(
+        nullptr,
+        static_cast<size_t>(new_window_size),
+        PROT_READ | PROT_WRITE,
+        MAP_SHARED,
+        fd,
+        static_cast<off_t>(window_offset));
+
+    if (view == MAP_FAILED) {
+        throw spdlog::spdlog_ex(
+            format("Failed mapping file {}", filename), errno);
+    }
+#endif
+
+    window = static_cast<char *>(view);
+    window_size = static_cast<size_t>(new_window_size);
+}
+
+inline void mapped_appender::unmap_window() noexcept {
+    if (!window) {
+        return;
+    }
+
+#ifdef _WIN32
+    UnmapViewOfFile(window);
+#else
+    munmap(window, window_size);
+#endif
+
+    window = nullptr;
+    window_size = 0;
+}
+
+inline void mapped_appender::reserve(const uint64_t file_size) {
+    // fmt
+    using fmt::format;
+
+#ifdef _WIN32
+    // the mapping object extends the file to its own size, and has to be
+    // recreated for every larger size
+    if (mapping_handle && file_size <= reserved) {
+        return;
+    }
+
+    if (mapping_handle) {
+        CloseHandle(mapping_handle);
+        mapping_handle = nullptr;
+    }
+
+    const auto new_size = std::max(file_size, reserved);
+
+    mapping_handle = CreateFileMappingA(
+        file_handle,
+        nullptr,
+        PAGE_READWRITE,
+        static_cast<DWORD>(new_size >> 32),
+        static_cast<DWORD>(new_size),
+        nullptr);
+
+    if (!mapping_handle) {
+        throw spdlog::spdlog_ex(format(
+            "Failed extending file {}, error {}", filename, GetLastError()));
+    }
+
+    reserved = new_size;
+#else
+    if (file_size <= reserved) {
+        return;
+    }
+
+#ifdef __linux__
+    // allocates the blocks up front, so that writing into the mapping cannot
+    // fail with SIGBUS when the disk is full
+    if (posix_fallocate(
+            fd,
+            static_cast<off_t>(reserved),
+            static_cast<off_t>(file_size - reserved)) == 0) {
+        reserved = file_size;
+        return;
+    }
+#endif
+
+    if (ftruncate(fd, static_cast<off_t>(file_size)) != 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed extending file {}", filename), errno);
+    }
+
+    reserved = file_size;
+#endif
+}
+
+} // namespace details
+
+template <class Mutex>
+mmap_file_sink<Mutex>::mmap_file_sink(
+    const std::string &filename, const uint64_t chunk_size, const bool truncate)
+    : file_path(filename), appender(filename, chunk_size, truncate) {}
+
+template <class Mutex>
+auto mmap_file_sink<Mutex>::filename() const -> const std::string & {
+    return file_path;
+}
+
+template <class Mutex>
+void mmap_file_sink<Mutex>::sink_it_(const spdlog::details::log_msg &msg) {
+    details::formatted_buffer formatted;
+    spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
+    appender.append(formatted.data(), formatted.size());
+}
+
+template <class Mutex> void mmap_file_sink<Mutex>::flush_() {
+    // the written bytes are already in the page cache shared with readers,
+    // from where the kernel writes them back even after a crash, so this only
+    // starts writing them back earlier
+    appender.sync();
+}
+} // namespace spdlog_setup
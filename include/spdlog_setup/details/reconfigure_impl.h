@@ -0,0 +1,504 @@
+/**
+ * Implementation of incremental reconfiguration in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "conf_impl.h"
+#include "setup_error.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Applies the configuration by diffing it against the currently applied
+ * configuration. Sinks, thread pools and loggers whose definitions did not
+ * change are kept, with their levels, flush levels and patterns updated in
+ * place, while only changed entities are rebuilt and removed loggers are
+ * dropped. Every entity is built before anything is swapped, so on error the
+ * currently applied configuration remains in place. For a lazy configuration,
+ * only the loggers already built are rebuilt or updated.
+ * @param config Merged configuration to apply.
+ * @throw setup_error
+ */
+void reconfigure(const std::shared_ptr<cpptoml::table> &config);
+
+// implementation section
+
+inline auto index_config_items(
+    const std::shared_ptr<cpptoml::table> &config, const char table_name[])
+    -> item_name_index {
+
+    if (!config) {
+        return item_name_index();
+    }
+
+    const auto items = config->get_table_array(table_name);
+    return items ? index_items_by_name(*items) : item_name_index();
+}
+
+inline auto level_from_table_or(
+    const std::shared_ptr<cpptoml::table> &table,
+    const char field[],
+    const spdlog::level::level_enum alt_level) -> spdlog::level::level_enum {
+
+    const auto level_opt = table->get_as<std::string>(field);
+    return level_opt ? level_from_str(*level_opt) : alt_level;
+}
+
+/**
+ * Describes an existing logger that is kept across reconfiguration, with its
+ * settings to be updated in place.
+ */
+struct kept_logger {
+    std::shared_ptr<spdlog::logger> logger;
+    spdlog::level::level_enum level;
+    spdlog::level::level_enum flush_level;
+};
+
+inline void reconfigure(const std::shared_ptr<cpptoml::table> &config) {
+    using names::FLUSH_INTERVAL;
+    using names::FLUSH_LEVEL;
+    using names::GLOBAL_PATTERN;
+    using names::GLOBAL_THREAD_POOL_TABLE;
+    using names::LAZY_LOGGERS;
+    using names::LEVEL;
+    using names::LOGGER_TABLE;
+    using names::NAME;
+    using names::PATTERN;
+    using names::SINK_TABLE;
+    using names::SINKS;
+    using names::THREAD_POOL;
+    using names::THREAD_POOL_TABLE;
+    using names::TYPE;
+
+    // fmt
+    using fmt::format;
+
+    // spdlog
+    using spdlog::details::registry;
+    using spdlog::details::thread_pool;
+    using spdlog::sinks::sink;
+    namespace lv = spdlog::level;
+
+    // std
+    using std::lock_guard;
+    using std::move;
+    using std::mutex;
+    using std::pair;
+    using std::shared_ptr;
+    using std::string;
+    using std::unordered_map;
+    using std::unordered_set;
+    using std::vector;
+
+    lock_guard<mutex> lock(applied_config_mutex());
+
+    auto &state = applied_config_state();
+    const auto &old_config = state.config;
+
+    // build phase, which must not touch anything that is currently applied
+
+    const auto sinks = config->get_table_array(SINK_TABLE);
+
+    if (!sinks) {
+        throw setup_error("No sinks configured for set-up");
+    }
+
+    const auto loggers = config->get_table_array(LOGGER_TABLE);
+
+    if (!loggers) {
+        throw setup_error("No loggers configured for set-up");
+    }
+
+    const auto lazy = value_from_table_or<bool>(
+        config, LAZY_LOGGERS, defaults::LAZY_LOGGERS);
+
+    if (lazy) {
+        // loggers that are not built yet are only checked
+        validate_config(*config);
+    } else {
+        check_shared_file_sinks(*config);
+    }
+
+    // in lazy mode, only the loggers built so far are rebuilt, together with
+    // the sinks and thread pools they use, while the others remain to be
+    // built on first request
+    vector<shared_ptr<cpptoml::table>> logger_tables;
+    unordered_set<string> used_sink_names;
+    unordered_set<string> used_thread_pool_names;
+    auto uses_global_thread_pool = false;
+
+    for (const auto &logger_table : *loggers) {
+        if (lazy) {
+            const auto name_opt = logger_table->get_as<string>(NAME);
+            const auto built_itr = state.loggers_map.find(*name_opt);
+            const auto registered_logger = spdlog::get(*name_opt);
+
+            // loggers dropped from spdlog since count as not built
+            if (!registered_logger || built_itr == state.loggers_map.cend() ||
+                built_itr->second.lock() != registered_logger) {
+                continue;
+            }
+        }
+
+        logger_tables.push_back(logger_table);
+
+        if (const auto sink_names = logger_table->get_array_of<string>(SINKS)) {
+            used_sink_names.insert(sink_names->cbegin(), sink_names->cend());
+        }
+
+        const auto type_opt = logger_table->get_as<string>(TYPE);
+
+        if (type_opt && *type_opt == names::ASYNC) {
+            const auto pool_name_opt =
+                logger_table->get_as<string>(THREAD_POOL);
+
+            if (pool_name_opt) {
+                used_thread_pool_names.insert(*pool_name_opt);
+            } else {
+                uses_global_thread_pool = true;
+            }
+        }
+    }
+
+    const auto old_sinks_index = index_config_items(old_config, SINK_TABLE);
+
+    unordered_map<string, shared_ptr<sink>> sinks_map;
+    vector<pair<shared_ptr<sink>, lv::level_enum>> kept_sinks;
+
+    for (const auto &sink_table : *sinks) {
+        auto name = value_from_table<string>(
+            sink_table,
+            NAME,
+            format("One of the sinks does not have a '{}' field", NAME));
+
+        if (lazy && !used_sink_names.count(name)) {
+            continue;
+        }
+
+        const auto err_fn = [&name](const string &err_msg) {
+            return format("Sink '{}' error:\n > {}", name, err_msg);
+        };
+
+        const auto old_sink_itr = state.sinks_map.find(name);
+        const auto old_table_itr = old_sinks_index.find(name);
+
+        const auto is_kept =
+            old_sink_itr != state.sinks_map.cend() &&
+            old_table_itr != old_sinks_index.cend() &&
+            config_tables_equal_except(
+                *old_table_itr->second, *sink_table, {LEVEL, FLUSH_INTERVAL});
+
+        auto kept_sink = is_kept ? old_sink_itr->second.lock() : nullptr;
+
+        if (kept_sink) {
+            const auto level = add_msg_on_err(
+                [&sink_table] {
+                    return level_from_table_or(sink_table, LEVEL, lv::trace);
+                },
+                err_fn);
+
+            kept_sinks.emplace_back(kept_sink, level);
+            sinks_map.emplace(move(name), move(kept_sink));
+        } else {
+            auto new_sink = add_msg_on_err(
+                [&sink_table] { return setup_sink(sink_table); }, err_fn);
+
+            sinks_map.emplace(move(name), move(new_sink));
+        }
+    }
+
+    const auto patterns_map = setup_patterns(config);
+
+    const auto global_thread_pool_table =
+        config->get_table(GLOBAL_THREAD_POOL_TABLE);
+
+    // includes the global thread pool of a lazy configuration not yet needed
+    const auto global_thread_pool_pending =
+        global_thread_pool_table &&
+        (state.global_thread_pool_pending || !old_config ||
+         !config_nodes_equal(
+             global_thread_pool_table,
+             old_config->get_table(GLOBAL_THREAD_POOL_TABLE)));
+
+    const auto global_thread_pool =
+        global_thread_pool_pending && (!lazy || uses_global_thread_pool)
+            ? setup_global_thread_pool(global_thread_pool_table)
+            : nullptr;
+
+    const auto old_thread_pools_index =
+        index_config_items(old_config, THREAD_POOL_TABLE);
+
+    unordered_map<string, shared_ptr<thread_pool>> thread_pools_map;
+    const auto thread_pools = config->get_table_array(THREAD_POOL_TABLE);
+
+    if (thread_pools) {
+        for (const auto &thread_pool_table : *thread_pools) {
+            auto name = value_from_table<string>(
+                thread_pool_table,
+                NAME,
+                format(
+                    "One of the thread pools does not have a '{}' field",
+                    NAME));
+
+            if (lazy && !used_thread_pool_names.count(name)) {
+                continue;
+            }
+
+            const auto old_pool_itr = state.thread_pools_map.find(name);
+            const auto old_table_itr = old_thread_pools_index.find(name);
+
+            const auto is_kept =
+                old_pool_itr != state.thread_pools_map.cend() &&
+                old_table_itr != old_thread_pools_index.cend() &&
+                config_nodes_equal(old_table_itr->second, thread_pool_table);
+
+            auto pool = is_kept ? old_pool_itr->second
+                                : setup_thread_pool(name, thread_pool_table);
+
+            thread_pools_map.emplace(move(name), move(pool));
+        }
+    }
+
+    const auto global_pattern_opt =
+        value_from_table_opt<string>(config, GLOBAL_PATTERN);
+
+    const auto old_loggers_index = index_config_items(old_config, LOGGER_TABLE);
+
+    // a logger is kept only if it would be built the same way
+    const auto find_kept_logger =
+        [&](const string &name, const shared_ptr<cpptoml::table> &logger_table)
+        -> shared_ptr<spdlog::logger> {
+        const auto old_logger_itr = state.loggers_map.find(name);
+        const auto old_table_itr = old_loggers_index.find(name);
+
+        if (old_logger_itr == state.loggers_map.cend() ||
+            old_table_itr == old_loggers_index.cend() ||
+            !config_tables_equal_except(
+                *old_table_itr->second,
+                *logger_table,
+                {LEVEL, FLUSH_LEVEL, FLUSH_INTERVAL, PATTERN})) {
+            return nullptr;
+        }
+
+        auto logger = old_logger_itr->second.lock();
+
+        if (!logger) {
+            return nullptr;
+        }
+
+        const auto sink_names = logger_table->get_array_of<string>(SINKS);
+
+        if (!sink_names || sink_names->size() != logger->sinks().size()) {
+            return nullptr;
+        }
+
+        for (size_t i = 0; i < sink_names->size(); ++i) {
+            const auto sink_itr = sinks_map.find((*sink_names)[i]);
+
+            if (sink_itr == sinks_map.cend() ||
+                sink_itr->second != logger->sinks()[i]) {
+                return nullptr;
+            }
+        }
+
+        const auto type_opt = logger_table->get_as<string>(TYPE);
+
+        if (type_opt && *type_opt == names::ASYNC) {
+            const auto pool_name_opt =
+                logger_table->get_as<string>(THREAD_POOL);
+
+            if (!pool_name_opt) {
+                return global_thread_pool ? nullptr : logger;
+            }
+
+            const auto old_pool_itr =
+                state.thread_pools_map.find(*pool_name_opt);
+
+            const auto new_pool_itr = thread_pools_map.find(*pool_name_opt);
+
+            if (old_pool_itr == state.thread_pools_map.cend() ||
+                new_pool_itr == thread_pools_map.cend() ||
+                old_pool_itr->second != new_pool_itr->second) {
+                return nullptr;
+            }
+        }
+
+        return logger;
+    };
+
+    vector<kept_logger> kept_loggers;
+
+    // selected pattern of every logger in order, since loggers sharing sinks
+    // set the pattern of the sinks in the order of the configuration
+    vector<pair<shared_ptr<spdlog::logger>, string>> logger_patterns;
+
+    vector<shared_ptr<spdlog::logger>> resolved_loggers(logger_tables.size());
+
+    for (size_t i = 0; i < logger_tables.size(); ++i) {
+        const auto &logger_table = logger_tables[i];
+
+        const auto name = value_from_table<string>(
+            logger_table,
+            NAME,
+            format("One of the loggers does not have a '{}' field", NAME));
+
+        const auto logger = find_kept_logger(name, logger_table);
+
+        if (!logger) {
+            continue;
+        }
+
+        const auto level = add_msg_on_err(
+            [&logger_table] {
+                return level_from_table_or(logger_table, LEVEL, lv::info);
+            },
+            [&name](const string &err_msg) {
+                return format(
+                    "Logger '{}' set level error:\n > {}", name, err_msg);
+            });
+
+        const auto flush_level = add_msg_on_err(
+            [&logger_table] {
+                return level_from_table_or(logger_table, FLUSH_LEVEL, lv::off);
+            },
+            [&name](const string &err_msg) {
+                return format(
+                    "Logger '{}' set flush level error:\n > {}", name, err_msg);
+            });
+
+        kept_loggers.push_back(kept_logger{logger, level, flush_level});
+        resolved_loggers[i] = logger;
+    }
+
+    for (size_t i = 0; i < logger_tables.size(); ++i) {
+        if (!resolved_loggers[i]) {
+            // patterns are only set in the commit phase, since the sinks may
+            // be shared with the currently applied loggers
+            resolved_loggers[i] = setup_logger(
+                logger_tables[i],
+                sinks_map,
+                patterns_map,
+                thread_pools_map,
+                global_pattern_opt,
+                global_thread_pool,
+                false);
+        }
+    }
+
+    for (size_t i = 0; i < logger_tables.size(); ++i) {
+        const auto &logger_table = logger_tables[i];
+        const auto &logger = resolved_loggers[i];
+        const auto pattern_name_opt = logger_table->get_as<string>(PATTERN);
+
+        // spdlog loggers start with the full formatter, which is "%+"
+        const auto pattern =
+            pattern_name_opt
+                ? find_value_from_map(
+                      patterns_map,
+                      *pattern_name_opt,
+                      format(
+                          "Pattern name '{}' cannot be found for logger '{}'",
+                          *pattern_name_opt,
+                          logger->name()))
+                : global_pattern_opt ? *global_pattern_opt : string("%+");
+
+        // fails in the build phase, rather than halfway through committing
+        try {
+            spdlog::pattern_formatter check_formatter(pattern);
+        } catch (const std::exception &e) {
+            throw setup_error(format(
+                "Error setting pattern to logger '{}': {}",
+                logger->name(),
+                e.what()));
+        }
+
+        logger_patterns.emplace_back(logger, pattern);
+    }
+
+    unordered_map<string, shared_ptr<spdlog::logger>> resolved_loggers_map;
+
+    for (const auto &logger : resolved_loggers) {
+        resolved_loggers_map.emplace(logger->name(), logger);
+    }
+
+    auto flushes = periodic_flushes_from_config(
+        *config, sinks_map, resolved_loggers_map);
+
+    // commit phase, which swaps in everything that has been built
+
+    if (global_thread_pool) {
+        registry::instance().set_tp(global_thread_pool);
+    }
+
+    for (const auto &kept_sink : kept_sinks) {
+        kept_sink.first->set_level(kept_sink.second);
+    }
+
+    for (const auto &kept : kept_loggers) {
+        kept.logger->set_level(kept.level);
+        kept.logger->flush_on(kept.flush_level);
+    }
+
+    for (const auto &logger_pattern : logger_patterns) {
+        set_counted_pattern(*logger_pattern.first, logger_pattern.second);
+    }
+
+    unordered_map<string, std::weak_ptr<spdlog::logger>> loggers_map;
+
+    for (const auto &logger : resolved_loggers) {
+        // kept loggers remain registered throughout
+        if (spdlog::get(logger->name()) != logger) {
+            spdlog::drop(logger->name());
+            spdlog::register_logger(logger);
+        }
+
+        loggers_map.emplace(logger->name(), logger);
+    }
+
+    // drop loggers that were set up previously but are no longer configured
+    for (const auto &old_logger_entry : state.loggers_map) {
+        const auto &name = old_logger_entry.first;
+        const auto old_logger = old_logger_entry.second.lock();
+
+        if (old_logger && !loggers_map.count(name) &&
+            spdlog::get(name) == old_logger) {
+            spdlog::drop(name);
+        }
+    }
+
+    state.loggers_map = move(loggers_map);
+
+    state.config = config;
+    state.lazy = lazy;
+    state.global_thread_pool_pending =
+        global_thread_pool_pending && !global_thread_pool;
+
+    state.sinks_map.clear();
+    state.sinks_map.insert(sinks_map.cbegin(), sinks_map.cend());
+
+    // unused pools drain their queues before their threads are joined
+    state.thread_pools_map = move(thread_pools_map);
+
+    periodic_flusher_instance().schedule(move(flushes));
+}
+} // namespace details
+} // namespace spdlog_setup
@@ -0,0 +1,347 @@
+/**
+ * Implementation of the graceful shutdown in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "async_pool_impl.h"
+#include "conf_impl.h"
+#include "flush_impl.h"
+#include "stats_impl.h"
+#include "topology_impl.h"
+
+#include "spdlog/async.h"
+#include "spdlog/sinks/sink.h"
+#include "spdlog/spdlog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace spdlog_setup {
+// declaration section
+
+/**
+ * Describes how a thread pool was drained while shutting down.
+ */
+struct thread_pool_shutdown {
+    /** Name of the thread pool, empty for the global thread pool */
+    std::string name;
+
+    /**
+     * Number of messages queued when shutting down that were written out,
+     * which spdlog thread pools only count from spdlog v1.10.0 onwards
+     */
+    uint64_t drained = 0;
+
+    /**
+     * Number of messages still queued once the deadline ran out, together
+     * with those posted while shutting down, which are only discarded for
+     * queue = "lockfree", and still written late by the other pools
+     */
+    uint64_t dropped = 0;
+};
+
+/**
+ * Describes the outcome of shutting down.
+ */
+struct shutdown_report {
+    /** Whether every pool was drained and every sink flushed in time */
+    bool completed = false;
+
+    /** Thread pools by name, with the global thread pool first if present */
+    std::vector<thread_pool_shutdown> thread_pools;
+
+    /** Names of the sinks that were flushed */
+    std::vector<std::string> flushed_sinks;
+
+    /** Names of the sinks that were not flushed, since the deadline ran out */
+    std::vector<std::string> unflushed_sinks;
+};
+
+namespace details {
+/**
+ * Sink of a marker logger whose flush the workers of a spdlog thread pool
+ * reach only after taking every message queued before it. Each worker is held
+ * in the flush until one flush per worker has arrived, so that no worker can
+ * still be writing a message taken earlier once the barrier is passed.
+ */
+class drain_barrier_sink : public spdlog::sinks::sink {
+  public:
+    /**
+     * Constructor accepting the number of workers to wait for.
+     * @param workers Number of workers of the thread pool.
+     * @param deadline Time by which to give up waiting.
+     */
+    drain_barrier_sink(
+        const size_t workers,
+        const std::chrono::steady_clock::time_point deadline);
+
+    void log(const spdlog::details::log_msg &msg) override;
+    void flush() override;
+    void set_pattern(const std::string &pattern) override;
+
+    void
+    set_formatter(std::unique_ptr<spdlog::formatter> sink_formatter) override;
+
+    /**
+     * Blocks until every worker has reached the barrier, or the deadline runs
+     * out.
+     * @return true if every worker has reached the barrier.
+     */
+    auto wait() -> bool;
+
+  private:
+    const size_t workers;
+    const std::chrono::steady_clock::time_point deadline;
+    std::mutex mutex;
+    std::condition_variable cv;
+    size_t arrived = 0;
+};
+
+/**
+ * Stops every logger from accepting messages, waits for the thread pools
+ * built from the configuration currently applied, and the global thread
+ * pool, to write out their queued messages, then flushes every sink, all
+ * within the deadline. A spdlog thread pool counts as drained once each of
+ * its workers has reached a flush queued behind every message, where a pool
+ * built outside of this library is taken to have a single worker.
+ * @param deadline Time by which to give up waiting.
+ * @return Report of what was drained, flushed and dropped.
+ */
+auto shutdown(const std::chrono::steady_clock::time_point deadline)
+    -> shutdown_report;
+
+// implementation section
+
+inline drain_barrier_sink::drain_barrier_sink(
+    const size_t workers,
+    const std::chrono::steady_clock::time_point deadline)
+    : workers(workers), deadline(deadline) {}
+
+inline void drain_barrier_sink::log(const spdlog::details::log_msg &) {}
+
+inline void drain_barrier_sink::flush() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++arrived;
+    cv.notify_all();
+    cv.wait_until(lock, deadline, [this] { return arrived >= workers; });
+}
+
+inline void drain_barrier_sink::set_pattern(const std::string &) {}
+
+inline void
+drain_barrier_sink::set_formatter(std::unique_ptr<spdlog::formatter>) {}
+
+inline auto drain_barrier_sink::wait() -> bool {
+    std::unique_lock<std::mutex> lock(mutex);
+    return cv.wait_until(lock, deadline, [this] { return arrived >= workers; });
+}
+
+inline auto shutdown(const std::chrono::steady_clock::time_point deadline)
+    -> shutdown_report {
+
+    // spdlog
+    using spdlog::details::thread_pool;
+
+    // std
+    using std::lock_guard;
+    using std::make_shared;
+    using std::move;
+    using std::mutex;
+    using std::shared_ptr;
+    using std::sort;
+    using std::string;
+    using std::vector;
+    using std::chrono::steady_clock;
+
+    struct draining_pool {
+        string name;
+        shared_ptr<thread_pool> pool;
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+        shared_ptr<managed_thread_pool> managed_pool;
+#endif
+        vector<shared_ptr<drain_barrier_sink>> barriers;
+        size_t initial_depth;
+        bool drained;
+    };
+
+    lock_guard<mutex> lock(applied_config_mutex());
+    auto &state = applied_config_state();
+
+    // periodic flushes would only queue more messages
+    periodic_flusher_instance().schedule({});
+
+    // covers the loggers made through spdlog itself as well
+    spdlog::set_level(spdlog::level::off);
+
+    vector<draining_pool> pools;
+
+    const auto add_pool = [&pools, deadline](
+                              string name, shared_ptr<thread_pool> pool) {
+        draining_pool draining;
+        draining.name = move(name);
+        draining.pool = move(pool);
+        draining.drained = false;
+
+        draining.initial_depth =
+            thread_pool_stats_of(draining.name, draining.pool).queue_depth;
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+        draining.managed_pool = as_managed_thread_pool(draining.pool);
+
+        if (draining.managed_pool) {
+            draining.managed_pool->close();
+            pools.push_back(move(draining));
+            return;
+        }
+#endif
+
+        // the workers of pools built outside of this library are unknown,
+        // where spdlog starts a single one unless told otherwise
+        const auto tracked_workers = tracked_thread_pool_threads(draining.pool);
+        const auto workers = tracked_workers > 0 ? tracked_workers : 1;
+
+        vector<shared_ptr<thread_pool>> node_pools{draining.pool};
+
+        if (const auto numa_pool = as_numa_thread_pool(draining.pool)) {
+            const auto &other_node_pools = numa_pool->other_node_pools();
+
+            node_pools.insert(
+                node_pools.end(),
+                other_node_pools.cbegin(),
+                other_node_pools.cend());
+        }
+
+        // queued behind every message posted so far, where blocking on a full
+        // queue only lasts until the workers make room
+        for (const auto &node_pool : node_pools) {
+            const auto barrier =
+                make_shared<drain_barrier_sink>(workers, deadline);
+
+            const auto marker = make_shared<spdlog::async_logger>(
+                string(),
+                barrier,
+                node_pool,
+                spdlog::async_overflow_policy::block);
+
+            for (size_t i = 0; i < workers; ++i) {
+                marker->flush();
+            }
+
+            draining.barriers.push_back(barrier);
+        }
+
+        pools.push_back(move(draining));
+    };
+
+    if (const auto global_thread_pool = spdlog::thread_pool()) {
+        add_pool(string(), global_thread_pool);
+    }
+
+    for (const auto &pool_pair : state.thread_pools_map) {
+        add_pool(pool_pair.first, pool_pair.second);
+    }
+
+    sort(
+        pools.begin(),
+        pools.end(),
+        [](const draining_pool &lhs, const draining_pool &rhs) {
+            return lhs.name < rhs.name;
+        });
+
+    // every pool drains on its own workers at the same time, so waiting on
+    // them one after another still takes no longer than the slowest
+    auto all_drained = true;
+
+    for (auto &draining : pools) {
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+        if (draining.managed_pool) {
+            draining.drained = draining.managed_pool->wait_idle(deadline);
+            all_drained = all_drained && draining.drained;
+            continue;
+        }
+#endif
+
+        draining.drained = true;
+
+        for (const auto &barrier : draining.barriers) {
+            draining.drained = barrier->wait() && draining.drained;
+        }
+
+        all_drained = all_drained && draining.drained;
+    }
+
+    shutdown_report report;
+
+    for (const auto &draining : pools) {
+        const auto remaining =
+            draining.drained
+                ? 0
+                : thread_pool_stats_of(draining.name, draining.pool)
+                      .queue_depth;
+
+        thread_pool_shutdown pool_report;
+        pool_report.name = draining.name;
+        pool_report.dropped = remaining;
+
+        pool_report.drained = draining.initial_depth > remaining
+                                  ? draining.initial_depth - remaining
+                                  : 0;
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+        if (draining.managed_pool) {
+            // the rest would otherwise hold up the destruction of the pool
+            if (remaining > 0) {
+                draining.managed_pool->discard_queued();
+            }
+
+            pool_report.dropped += draining.managed_pool->rejected();
+        }
+#endif
+
+        report.thread_pools.push_back(move(pool_report));
+    }
+
+    vector<string> sink_names;
+
+    for (const auto &sink_pair : state.sinks_map) {
+        sink_names.push_back(sink_pair.first);
+    }
+
+    sort(sink_names.begin(), sink_names.end());
+
+    for (const auto &sink_name : sink_names) {
+        const auto sink = state.sinks_map[sink_name].lock();
+
+        if (!sink) {
+            continue;
+        }
+
+        if (steady_clock::now() >= deadline) {
+            report.unflushed_sinks.push_back(sink_name);
+            continue;
+        }
+
+        try {
+            sink->flush();
+            report.flushed_sinks.push_back(sink_name);
+        } catch (const std::exception &) {
+            report.unflushed_sinks.push_back(sink_name);
+        }
+    }
+
+    report.completed = all_drained && report.unflushed_sinks.empty();
+    return report;
+}
+} // namespace details
+} // namespace spdlog_setup
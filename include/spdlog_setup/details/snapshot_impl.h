@@ -0,0 +1,485 @@
+/**
+ * Implementation of the binary configuration snapshot in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "conf_impl.h"
+#include "file_impl.h"
+#include "setup_error.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+namespace snapshot {
+static constexpr char MAGIC[] = {'S', 'P', 'D', 'L', 'S', 'N', 'A', 'P'};
+static constexpr uint32_t VERSION = 1;
+static constexpr auto SUFFIX = ".snapshot";
+
+// sources modified this recently may be modified again within the same mtime
+// granularity, so their content hash is always verified
+static constexpr int64_t RACY_MTIME_SECS = 2;
+
+enum class tag : uint8_t {
+    Table = 1,
+    TableArray = 2,
+    Array = 3,
+    String = 4,
+    Integer = 5,
+    Float = 6,
+    Boolean = 7,
+};
+} // namespace snapshot
+
+/**
+ * Describes a source file of the snapshot, as it was when it was parsed.
+ */
+struct snapshot_source {
+    /** Path of the TOML file */
+    std::string path;
+
+    /** Status of the file, with the size of the content that was parsed */
+    file_stat stat;
+
+    /** true if the file may have been modified while or after being read */
+    bool racy;
+
+    /** Hash of the content that was parsed, 0 for a missing file */
+    uint64_t hash;
+};
+
+/**
+ * Parses the TOML file and records the state of the parsed content, so that
+ * the snapshot is keyed with exactly the bytes that were parsed.
+ * @param toml_path Path of the TOML file.
+ * @param source Receives the state of the file.
+ * @return Parsed configuration tree.
+ * @throw setup_error
+ */
+auto parse_snapshot_source(
+    const std::string &toml_path, snapshot_source &source)
+    -> std::shared_ptr<cpptoml::table>;
+
+/**
+ * Records the source file that was not parsed because it does not exist.
+ * @param toml_path Path of the missing TOML file.
+ * @return State of the file.
+ */
+auto missing_snapshot_source(const std::string &toml_path) -> snapshot_source;
+
+/**
+ * Serializes the configuration tree into the snapshot binary form, keyed with
+ * the state of the source files when they were parsed.
+ * @param config Resolved configuration to serialize.
+ * @param sources Source files the configuration is derived from, in order.
+ * @return Serialized snapshot content.
+ * @throw setup_error if the configuration contains unsupported value types.
+ */
+auto serialize_snapshot(
+    const cpptoml::table &config, const std::vector<snapshot_source> &sources)
+    -> std::string;
+
+/**
+ * Deserializes the configuration tree from the snapshot binary form, provided
+ * that the source files have not changed since the snapshot was made.
+ * @param data Start of the snapshot content.
+ * @param size Size of the snapshot content.
+ * @param source_paths Paths of TOML files the configuration is derived from.
+ * @return Configuration tree, or nullptr if the snapshot is stale or invalid.
+ */
+auto deserialize_snapshot(
+    const char *data,
+    const size_t size,
+    const std::vector<std::string> &source_paths)
+    -> std::shared_ptr<cpptoml::table>;
+
+// implementation section
+
+inline auto snapshot_path_for(const std::string &toml_path) -> std::string {
+    return toml_path + snapshot::SUFFIX;
+}
+
+inline void put_snapshot_bytes(
+    std::string &out, const void *data, const size_t size) {
+    out.append(static_cast<const char *>(data), size);
+}
+
+template <class T> void put_snapshot_pod(std::string &out, const T &val) {
+    put_snapshot_bytes(out, &val, sizeof(val));
+}
+
+inline void put_snapshot_str(std::string &out, const std::string &val) {
+    put_snapshot_pod(out, static_cast<uint32_t>(val.size()));
+    put_snapshot_bytes(out, val.data(), val.size());
+}
+
+inline void put_snapshot_tag(std::string &out, const snapshot::tag t) {
+    put_snapshot_pod(out, static_cast<uint8_t>(t));
+}
+
+inline void put_snapshot_node(std::string &out, const cpptoml::base &node);
+
+inline void put_snapshot_table(std::string &out, const cpptoml::table &table) {
+    // std
+    using std::distance;
+
+    put_snapshot_tag(out, snapshot::tag::Table);
+    put_snapshot_pod(
+        out, static_cast<uint32_t>(distance(table.begin(), table.end())));
+
+    for (const auto &kv : table) {
+        put_snapshot_str(out, kv.first);
+        put_snapshot_node(out, *kv.second);
+    }
+}
+
+inline void put_snapshot_node(std::string &out, const cpptoml::base &node) {
+    // std
+    using std::string;
+
+    if (node.is_table()) {
+        put_snapshot_table(out, static_cast<const cpptoml::table &>(node));
+    } else if (node.is_table_array()) {
+        const auto &items = static_cast<const cpptoml::table_array &>(node);
+        put_snapshot_tag(out, snapshot::tag::TableArray);
+        put_snapshot_pod(out, static_cast<uint8_t>(items.is_inline()));
+        put_snapshot_pod(out, static_cast<uint32_t>(items.get().size()));
+
+        for (const auto &item : items) {
+            put_snapshot_table(out, *item);
+        }
+    } else if (node.is_array()) {
+        const auto &items = static_cast<const cpptoml::array &>(node);
+        put_snapshot_tag(out, snapshot::tag::Array);
+        put_snapshot_pod(out, static_cast<uint32_t>(items.get().size()));
+
+        for (const auto &item : items) {
+            put_snapshot_node(out, *item);
+        }
+    } else if (const auto str_val = node.as<string>()) {
+        put_snapshot_tag(out, snapshot::tag::String);
+        put_snapshot_str(out, str_val->get());
+    } else if (const auto int_val = node.as<int64_t>()) {
+        put_snapshot_tag(out, snapshot::tag::Integer);
+        put_snapshot_pod(out, int_val->get());
+    } else if (const auto float_val = node.as<double>()) {
+        put_snapshot_tag(out, snapshot::tag::Float);
+        put_snapshot_pod(out, float_val->get());
+    } else if (const auto bool_val = node.as<bool>()) {
+        put_snapshot_tag(out, snapshot::tag::Boolean);
+        put_snapshot_pod(out, static_cast<uint8_t>(bool_val->get()));
+    } else {
+        throw setup_error("Date and time values cannot be snapshotted");
+    }
+}
+
+inline auto parse_snapshot_source(
+    const std::string &toml_path, snapshot_source &source)
+    -> std::shared_ptr<cpptoml::table> {
+
+    // std
+    using std::chrono::duration_cast;
+    using std::chrono::seconds;
+    using std::chrono::system_clock;
+
+    const auto st = stat_file(toml_path);
+    const mapped_file toml_file(toml_path);
+    const auto mapped_st = stat_file(toml_path);
+
+    const auto now_secs =
+        duration_cast<seconds>(system_clock::now().time_since_epoch()).count();
+
+    source.path = toml_path;
+    source.stat = st;
+    source.stat.exists = true;
+    source.stat.size = toml_file.size();
+    source.hash = hash_bytes(toml_file.data(), toml_file.size());
+
+    // a file changed while being mapped can only be verified by its content
+    source.racy = !st.exists || !mapped_st.exists ||
+                  st.size != mapped_st.size ||
+                  st.mtime_sec != mapped_st.mtime_sec ||
+                  st.mtime_nsec != mapped_st.mtime_nsec ||
+                  now_secs - st.mtime_sec < snapshot::RACY_MTIME_SECS;
+
+    return parse_toml(toml_file.data(), toml_file.size());
+}
+
+inline auto missing_snapshot_source(const std::string &toml_path)
+    -> snapshot_source {
+
+    return snapshot_source{toml_path, file_stat{false, 0, 0, 0}, false, 0};
+}
+
+inline auto serialize_snapshot(
+    const cpptoml::table &config, const std::vector<snapshot_source> &sources)
+    -> std::string {
+
+    // std
+    using std::string;
+
+    string out;
+    put_snapshot_bytes(out, snapshot::MAGIC, sizeof(snapshot::MAGIC));
+    put_snapshot_pod(out, snapshot::VERSION);
+    put_snapshot_pod(out, static_cast<uint32_t>(sources.size()));
+
+    for (const auto &source : sources) {
+        put_snapshot_str(out, source.path);
+        put_snapshot_pod(out, static_cast<uint8_t>(source.stat.exists));
+        put_snapshot_pod(out, static_cast<uint8_t>(source.racy));
+        put_snapshot_pod(out, source.stat.size);
+        put_snapshot_pod(out, source.stat.mtime_sec);
+        put_snapshot_pod(out, source.stat.mtime_nsec);
+        put_snapshot_pod(out, source.hash);
+    }
+
+    put_snapshot_table(out, config);
+    return out;
+}
+
+/**
+ * Bounds-checked cursor over the snapshot binary form.
+ */
+class snapshot_reader {
+  public:
+    snapshot_reader(const char *data, const size_t size)
+        : curr(data), end(data + size) {}
+
+    void bytes(void *out, const size_t size) {
+        if (static_cast<size_t>(end - curr) < size) {
+            throw setup_error("Snapshot is truncated");
+        }
+
+        std::memcpy(out, curr, size);
+        curr += size;
+    }
+
+    template <class T> auto pod() -> T {
+        T val;
+        bytes(&val, sizeof(val));
+        return val;
+    }
+
+    auto str() -> std::string {
+        const auto size = pod<uint32_t>();
+
+        if (static_cast<size_t>(end - curr) < size) {
+            throw setup_error("Snapshot is truncated");
+        }
+
+        std::string val(curr, size);
+        curr += size;
+        return val;
+    }
+
+    auto tag() -> snapshot::tag { return snapshot::tag(pod<uint8_t>()); }
+
+    auto at_end() const -> bool { return curr == end; }
+
+  private:
+    const char *curr;
+    const char *end;
+};
+
+inline auto get_snapshot_node(snapshot_reader &reader, const snapshot::tag t)
+    -> std::shared_ptr<cpptoml::base>;
+
+inline auto get_snapshot_table(snapshot_reader &reader)
+    -> std::shared_ptr<cpptoml::table> {
+
+    const auto table = cpptoml::make_table();
+    const auto count = reader.pod<uint32_t>();
+
+    for (uint32_t i = 0; i < count; ++i) {
+        auto key = reader.str();
+        table->insert(key, get_snapshot_node(reader, reader.tag()));
+    }
+
+    return table;
+}
+
+inline auto get_snapshot_node(snapshot_reader &reader, const snapshot::tag t)
+    -> std::shared_ptr<cpptoml::base> {
+
+    // std
+    using std::string;
+
+    switch (t) {
+    case snapshot::tag::Table:
+        return get_snapshot_table(reader);
+
+    case snapshot::tag::TableArray: {
+        const auto is_inline = reader.pod<uint8_t>() != 0;
+        const auto items = cpptoml::make_table_array(is_inline);
+        const auto count = reader.pod<uint32_t>();
+        items->reserve(count);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            if (reader.tag() != snapshot::tag::Table) {
+                throw setup_error("Snapshot table array has non-table item");
+            }
+
+            items->push_back(get_snapshot_table(reader));
+        }
+
+        return items;
+    }
+
+    case snapshot::tag::Array: {
+        const auto items = cpptoml::make_array();
+        const auto count = reader.pod<uint32_t>();
+        items->get().reserve(count);
+
+        for (uint32_t i = 0; i < count; ++i) {
+            // array::push_back enforces homogeneity, which the original TOML
+            // has already been validated for
+            items->get().push_back(get_snapshot_node(reader, reader.tag()));
+        }
+
+        return items;
+    }
+
+    case snapshot::tag::String:
+        return cpptoml::make_value<string>(reader.str());
+
+    case snapshot::tag::Integer:
+        return cpptoml::make_value<int64_t>(reader.pod<int64_t>());
+
+    case snapshot::tag::Float:
+        return cpptoml::make_value<double>(reader.pod<double>());
+
+    case snapshot::tag::Boolean:
+        return cpptoml::make_value<bool>(reader.pod<uint8_t>() != 0);
+
+    default:
+        throw setup_error("Snapshot contains unknown node tag");
+    }
+}
+
+inline auto is_snapshot_source_fresh(snapshot_reader &reader) -> bool {
+    const auto source_path = reader.str();
+    const auto existed = reader.pod<uint8_t>() != 0;
+    const auto racy = reader.pod<uint8_t>() != 0;
+    const auto size = reader.pod<uint64_t>();
+    const auto mtime_sec = reader.pod<int64_t>();
+    const auto mtime_nsec = reader.pod<int64_t>();
+    const auto hash = reader.pod<uint64_t>();
+
+    const auto st = stat_file(source_path);
+
+    if (st.exists != existed) {
+        return false;
+    }
+
+    if (!st.exists) {
+        return true;
+    }
+
+    if (st.size != size) {
+        return false;
+    }
+
+    if (!racy && st.mtime_sec == mtime_sec && st.mtime_nsec == mtime_nsec) {
+        return true;
+    }
+
+    // touched or racily written, only the content can tell
+    const mapped_file source(source_path);
+    return hash_bytes(source.data(), source.size()) == hash;
+}
+
+inline auto deserialize_snapshot(
+    const char *data,
+    const size_t size,
+    const std::vector<std::string> &source_paths)
+    -> std::shared_ptr<cpptoml::table> {
+
+    // std
+    using std::exception;
+    using std::memcmp;
+
+    try {
+        snapshot_reader reader(data, size);
+
+        char magic[sizeof(snapshot::MAGIC)];
+        reader.bytes(magic, sizeof(magic));
+
+        if (memcmp(magic, snapshot::MAGIC, sizeof(magic)) != 0 ||
+            reader.pod<uint32_t>() != snapshot::VERSION ||
+            reader.pod<uint32_t>() != source_paths.size()) {
+            return nullptr;
+        }
+
+        for (const auto &source_path : source_paths) {
+            // peek at the recorded path without consuming the rest
+            snapshot_reader path_reader = reader;
+
+            if (path_reader.str() != source_path ||
+                !is_snapshot_source_fresh(reader)) {
+                return nullptr;
+            }
+        }
+
+        if (reader.tag() != snapshot::tag::Table) {
+            return nullptr;
+        }
+
+        auto config = get_snapshot_table(reader);
+        return reader.at_end() ? config : nullptr;
+    } catch (const exception &) {
+        return nullptr;
+    }
+}
+
+inline auto load_snapshot(
+    const std::string &snapshot_path,
+    const std::vector<std::string> &source_paths)
+    -> std::shared_ptr<cpptoml::table> {
+
+    // std
+    using std::exception;
+
+    if (!file_exists(snapshot_path)) {
+        return nullptr;
+    }
+
+    try {
+        const mapped_file snapshot_file(snapshot_path);
+
+        return deserialize_snapshot(
+            snapshot_file.data(), snapshot_file.size(), source_paths);
+    } catch (const exception &) {
+        return nullptr;
+    }
+}
+
+inline auto save_snapshot(
+    const std::string &snapshot_path,
+    const std::vector<snapshot_source> &sources,
+    const cpptoml::table &config) noexcept -> bool {
+
+    // std
+    using std::exception;
+
+    // the snapshot is only a cache, so failing to write it is not an error
+    try {
+        write_file_atomically(
+            snapshot_path, serialize_snapshot(config, sources));
+        return true;
+    } catch (const exception &) {
+        return false;
+    }
+}
+} // namespace details
+} // namespace spdlog_setup
@@ -0,0 +1,468 @@
+/**
+ * Implementation of runtime stats of the entities built by spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "async_pool_impl.h"
+#include "topology_impl.h"
+
+#include "spdlog/async.h"
+#include "spdlog/formatter.h"
+#include "spdlog/logger.h"
+#include "spdlog/pattern_formatter.h"
+#include "spdlog/sinks/sink.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace spdlog_setup {
+// declaration section
+
+/**
+ * Snapshot of a thread pool built from the configuration.
+ */
+struct thread_pool_stats {
+    /** Name of the thread pool, empty for the global thread pool */
+    std::string name;
+
+    /** Maximum number of queued messages, over the queues of every node */
+    size_t queue_capacity = 0;
+
+    /** Number of messages queued at the time of the snapshot */
+    size_t queue_depth = 0;
+
+    /**
+     * Highest number of messages seen queued in any one queue, which is only
+     * tracked for queue = "lockfree", and is zero for the other pools
+     */
+    size_t high_water_mark = 0;
+
+    /** Number of queued messages discarded to make room for newer ones */
+    uint64_t overruns = 0;
+
+    /**
+     * Histogram of the time producers took to queue messages, which is only
+     * tracked for queue = "lockfree", and is empty for the other pools
+     */
+    std::vector<latency_bucket> enqueue_latency;
+};
+
+/**
+ * Snapshot of a logger registered from the configuration.
+ */
+struct logger_stats {
+    /** Name of the logger */
+    std::string name;
+
+    /** Counts of the messages dropped due to the overflow policy */
+    dropped_messages dropped;
+};
+
+/**
+ * Snapshot of a sink built from the configuration, counting the messages the
+ * sink formatted, so that sinks writing messages without formatting them,
+ * such as syslog and null sinks, count none.
+ */
+struct sink_stats {
+    /** Name of the sink */
+    std::string name;
+
+    /** Number of messages formatted */
+    uint64_t messages = 0;
+
+    /** Number of bytes of the formatted messages */
+    uint64_t bytes = 0;
+};
+
+/**
+ * Snapshot of every thread pool, logger and sink built from the configuration
+ * currently applied, each ordered by name.
+ */
+struct setup_stats {
+    std::vector<thread_pool_stats> thread_pools;
+    std::vector<logger_stats> loggers;
+    std::vector<sink_stats> sinks;
+};
+
+namespace details {
+#if defined(SPDLOG_VERSION) && SPDLOG_VERSION >= 10600
+using formatted_buffer = spdlog::memory_buf_t;
+#else
+using formatted_buffer = fmt::memory_buffer;
+#endif
+
+/**
+ * Describes the counters behind sink_stats, which sinks update concurrently
+ * with snapshots.
+ */
+struct sink_counters {
+    std::atomic<uint64_t> messages{0};
+    std::atomic<uint64_t> bytes{0};
+};
+
+/**
+ * Formatter that counts the messages and bytes formatted by another one, which
+ * sinks call under their own lock, so counting takes no further lock.
+ */
+class counting_formatter : public spdlog::formatter {
+  public:
+    /**
+     * Constructor accepting the formatter to count.
+     * @param formatter Formatter to forward to.
+     * @param counters Counters of the sink.
+     */
+    counting_formatter(
+        std::unique_ptr<spdlog::formatter> formatter,
+        std::shared_ptr<sink_counters> counters);
+
+    void format(
+        const spdlog::details::log_msg &msg, formatted_buffer &dest) override;
+
+    auto clone() const -> std::unique_ptr<spdlog::formatter> override;
+
+  private:
+    std::unique_ptr<spdlog::formatter> formatter;
+    std::shared_ptr<sink_counters> counters;
+};
+
+/**
+ * Starts counting the messages formatted by the sink with the default pattern
+ * if not counted yet, since sinks do not expose their formatter.
+ * @param sink Sink to count.
+ */
+void track_sink(const std::shared_ptr<spdlog::sinks::sink> &sink);
+
+/**
+ * Returns the counters of the sink.
+ * @param sink Sink to look up.
+ * @return Counters of the sink, nullptr if not tracked.
+ */
+auto find_sink_counters(const std::shared_ptr<spdlog::sinks::sink> &sink)
+    -> std::shared_ptr<sink_counters>;
+
+/**
+ * Sets the pattern of every sink of the logger as with logger::set_pattern,
+ * while keeping the tracked sinks counted.
+ * @param logger Logger whose sinks to set the pattern of.
+ * @param pattern Pattern to set.
+ */
+void set_counted_pattern(spdlog::logger &logger, const std::string &pattern);
+
+/**
+ * Returns the counts of the messages the logger dropped so far.
+ * @param logger Logger.
+ * @return Counts of dropped messages, all zero if the logger does not keep
+ * them.
+ */
+auto dropped_messages_of(const std::shared_ptr<spdlog::logger> &logger)
+    -> dropped_messages;
+
+/**
+ * Remembers the queue size and number of workers of the thread pool, which
+ * spdlog thread pools do not expose.
+ * @param pool Thread pool built.
+ * @param queue_size Maximum number of queued messages of each of its queues.
+ * @param num_threads Number of workers taking from each of its queues.
+ */
+void track_thread_pool(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool,
+    const size_t queue_size,
+    const size_t num_threads);
+
+/**
+ * Returns the number of workers remembered for the thread pool.
+ * @param pool Thread pool.
+ * @return Number of workers taking from each of its queues, zero if the pool
+ * was not built from a configuration.
+ */
+auto tracked_thread_pool_threads(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool) -> size_t;
+
+/**
+ * Takes a snapshot of the thread pool.
+ * @param name Name of the thread pool, empty for the global thread pool.
+ * @param pool Thread pool.
+ * @return Snapshot of the thread pool.
+ */
+auto thread_pool_stats_of(
+    std::string name,
+    const std::shared_ptr<spdlog::details::thread_pool> &pool)
+    -> thread_pool_stats;
+
+// implementation section
+
+inline counting_formatter::counting_formatter(
+    std::unique_ptr<spdlog::formatter> formatter,
+    std::shared_ptr<sink_counters> counters)
+    : formatter(std::move(formatter)), counters(std::move(counters)) {}
+
+inline void counting_formatter::format(
+    const spdlog::details::log_msg &msg, formatted_buffer &dest) {
+
+    // std
+    using std::memory_order_relaxed;
+
+    const auto size_before = dest.size();
+    formatter->format(msg, dest);
+
+    counters->messages.fetch_add(1, memory_order_relaxed);
+    counters->bytes.fetch_add(dest.size() - size_before, memory_order_relaxed);
+}
+
+inline auto counting_formatter::clone() const
+    -> std::unique_ptr<spdlog::formatter> {
+
+    return std::unique_ptr<spdlog::formatter>(
+        new counting_formatter(formatter->clone(), counters));
+}
+
+/**
+ * Describes an entry of the sink counters registry, where the sink is only
+ * observed, so that an entry whose sink expired is replaced if another sink
+ * reuses its address.
+ */
+struct tracked_sink {
+    std::weak_ptr<spdlog::sinks::sink> sink;
+    std::shared_ptr<sink_counters> counters;
+};
+
+/**
+ * Describes an entry of the thread pool registry, as with tracked_sink.
+ */
+struct tracked_thread_pool {
+    std::weak_ptr<spdlog::details::thread_pool> pool;
+    size_t queue_size;
+    size_t num_threads;
+};
+
+// all are leaked, since sinks and pools may be destroyed during static
+// destruction
+
+inline auto stats_mutex() -> std::mutex & {
+    static const auto mutex = new std::mutex();
+    return *mutex;
+}
+
+inline auto tracked_sinks_registry()
+    -> std::unordered_map<const spdlog::sinks::sink *, tracked_sink> & {
+
+    static const auto registry =
+        new std::unordered_map<const spdlog::sinks::sink *, tracked_sink>();
+
+    return *registry;
+}
+
+inline auto tracked_thread_pools_registry() -> std::
+    unordered_map<const spdlog::details::thread_pool *, tracked_thread_pool> & {
+
+    static const auto registry = new std::unordered_map<
+        const spdlog::details::thread_pool *,
+        tracked_thread_pool>();
+
+    return *registry;
+}
+
+/**
+ * Looks up the counters of the sink, while holding stats_mutex().
+ * @param sink Sink to look up.
+ * @return Counters of the sink, nullptr if not tracked.
+ */
+inline auto find_sink_counters_locked(
+    const std::shared_ptr<spdlog::sinks::sink> &sink)
+    -> std::shared_ptr<sink_counters> {
+
+    auto &registry = tracked_sinks_registry();
+    const auto itr = registry.find(sink.get());
+
+    return itr != registry.cend() && itr->second.sink.lock() == sink
+               ? itr->second.counters
+               : nullptr;
+}
+
+inline void track_sink(const std::shared_ptr<spdlog::sinks::sink> &sink) {
+    // spdlog
+    using spdlog::pattern_formatter;
+
+    // std
+    using std::make_shared;
+    using std::unique_ptr;
+
+    std::lock_guard<std::mutex> lock(stats_mutex());
+
+    // shared file sinks may already be tracked
+    if (find_sink_counters_locked(sink)) {
+        return;
+    }
+
+    auto &registry = tracked_sinks_registry();
+
+    for (auto itr = registry.begin(); itr != registry.end();) {
+        if (itr->second.sink.expired()) {
+            itr = registry.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+
+    const auto counters = make_shared<sink_counters>();
+
+    sink->set_formatter(unique_ptr<spdlog::formatter>(new counting_formatter(
+        unique_ptr<spdlog::formatter>(new pattern_formatter()), counters)));
+
+    registry[sink.get()] = tracked_sink{sink, counters};
+}
+
+inline auto find_sink_counters(const std::shared_ptr<spdlog::sinks::sink> &sink)
+    -> std::shared_ptr<sink_counters> {
+
+    std::lock_guard<std::mutex> lock(stats_mutex());
+    return find_sink_counters_locked(sink);
+}
+
+inline void
+set_counted_pattern(spdlog::logger &logger, const std::string &pattern) {
+    // spdlog
+    using spdlog::pattern_formatter;
+
+    // std
+    using std::unique_ptr;
+
+    std::lock_guard<std::mutex> lock(stats_mutex());
+
+    for (const auto &sink : logger.sinks()) {
+        unique_ptr<spdlog::formatter> formatter(new pattern_formatter(pattern));
+
+        if (const auto counters = find_sink_counters_locked(sink)) {
+            formatter.reset(
+                new counting_formatter(std::move(formatter), counters));
+        }
+
+        sink->set_formatter(std::move(formatter));
+    }
+}
+
+inline auto dropped_messages_of(const std::shared_ptr<spdlog::logger> &logger)
+    -> dropped_messages {
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    if (const auto managed_logger =
+            std::dynamic_pointer_cast<managed_async_logger>(logger)) {
+        return managed_logger->dropped();
+    }
+#else
+    static_cast<void>(logger);
+#endif
+
+    return dropped_messages();
+}
+
+inline void track_thread_pool(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool,
+    const size_t queue_size,
+    const size_t num_threads) {
+
+    std::lock_guard<std::mutex> lock(stats_mutex());
+
+    auto &registry = tracked_thread_pools_registry();
+
+    for (auto itr = registry.begin(); itr != registry.end();) {
+        if (itr->second.pool.expired()) {
+            itr = registry.erase(itr);
+        } else {
+            ++itr;
+        }
+    }
+
+    registry[pool.get()] = tracked_thread_pool{pool, queue_size, num_threads};
+}
+
+inline auto tracked_thread_pool_threads(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool) -> size_t {
+
+    std::lock_guard<std::mutex> lock(stats_mutex());
+
+    const auto &registry = tracked_thread_pools_registry();
+    const auto itr = registry.find(pool.get());
+
+    return itr != registry.cend() && itr->second.pool.lock() == pool
+               ? itr->second.num_threads
+               : 0;
+}
+
+inline auto thread_pool_stats_of(
+    std::string name,
+    const std::shared_ptr<spdlog::details::thread_pool> &pool)
+    -> thread_pool_stats {
+
+    // spdlog
+    using spdlog::details::thread_pool;
+
+    // std
+    using std::move;
+    using std::shared_ptr;
+    using std::vector;
+
+    thread_pool_stats pool_stats;
+    pool_stats.name = move(name);
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    if (const auto managed_pool = as_managed_thread_pool(pool)) {
+        pool_stats.queue_capacity = managed_pool->queue_capacity();
+        pool_stats.queue_depth = managed_pool->queue_depth();
+        pool_stats.high_water_mark = managed_pool->high_water_mark();
+        pool_stats.overruns = managed_pool->overruns();
+        pool_stats.enqueue_latency = managed_pool->enqueue_latency();
+        return pool_stats;
+    }
+#endif
+
+    const auto queue_size = [&pool]() -> size_t {
+        std::lock_guard<std::mutex> lock(stats_mutex());
+
+        const auto &registry = tracked_thread_pools_registry();
+        const auto itr = registry.find(pool.get());
+
+        return itr != registry.cend() && itr->second.pool.lock() == pool
+                   ? itr->second.queue_size
+                   : 0;
+    }();
+
+    vector<shared_ptr<thread_pool>> node_pools{pool};
+
+    if (const auto numa_pool = as_numa_thread_pool(pool)) {
+        const auto &other_node_pools = numa_pool->other_node_pools();
+
+        node_pools.insert(
+            node_pools.end(),
+            other_node_pools.cbegin(),
+            other_node_pools.cend());
+    }
+
+    pool_stats.queue_capacity = queue_size * node_pools.size();
+
+    // both take the lock of the queue, but only while taking the snapshot
+    for (const auto &node_pool : node_pools) {
+#if defined(SPDLOG_VERSION) && SPDLOG_VERSION >= 11000
+        pool_stats.queue_depth += node_pool->queue_size();
+#endif
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+        pool_stats.overruns += node_pool->overrun_counter();
+#else
+        static_cast<void>(node_pool);
+#endif
+    }
+
+    return pool_stats;
+}
+} // namespace details
+} // namespace spdlog_setup
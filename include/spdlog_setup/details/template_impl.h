@@ -10,9 +10,10 @@
 
 #include "spdlog/fmt/fmt.h"
 
-#include <sstream>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace spdlog_setup {
 namespace details {
@@ -35,15 +36,99 @@ inline auto is_valid_var_char(const char c) -> bool {
 
 inline auto render(
     const std::string &tmpl,
-    const std::unordered_map<std::string, std::string> &m) -> std::string {
+    const std::unordered_map<std::string, std::string> &m) -> std::string;
+} // namespace details
+
+/**
+ * Template that has been split once into literal spans and variable slots, so
+ * that it can be rendered many times against different bindings without
+ * re-scanning the template text.
+ */
+class compiled_template {
+  public:
+    /**
+     * Compiles the given template text.
+     * @param tmpl Template text, where variables are written as {{ name }} and
+     * verbatim text as {{ "text" }}.
+     * @throw setup_error
+     */
+    explicit compiled_template(const std::string &tmpl);
+
+    /**
+     * Renders the template into a new string.
+     * @param m Mapping of variable names to values. Missing variables are
+     * rendered as empty.
+     * @return Rendered text.
+     * @throw std::bad_alloc
+     */
+    auto render(const std::unordered_map<std::string, std::string> &m) const
+        -> std::string;
+
+    /**
+     * Renders the template into the given buffer, replacing its content while
+     * reusing its capacity.
+     * @param out Buffer to render into.
+     * @param m Mapping of variable names to values. Missing variables are
+     * rendered as empty.
+     * @throw std::bad_alloc
+     */
+    void render_into(
+        std::string &out,
+        const std::unordered_map<std::string, std::string> &m) const;
+
+    /**
+     * Renders the template into the given buffer, replacing its content while
+     * reusing its capacity. Useful to bind variables to struct fields.
+     * @param out Buffer to render into.
+     * @param lookup Callable taking the variable name and returning a
+     * const std::string * to its value, or nullptr to render it as empty.
+     * @throw std::bad_alloc
+     */
+    template <class Lookup>
+    void render_into_with(std::string &out, Lookup &&lookup) const;
+
+    /**
+     * Returns the names of all variable slots, in order of appearance.
+     * @return Variable names, possibly repeated.
+     */
+    auto variables() const -> const std::vector<std::string> &;
+
+  private:
+    struct segment {
+        /** true for variable slot, false for literal span */
+        bool is_var;
+
+        /** Index into var_names for slot, offset into literals for span */
+        size_t index;
+
+        /** Length of the literal span, unused for slot */
+        size_t size;
+    };
+
+    void add_literal(const char c);
+    void add_var(std::string name);
+
+    std::string literals;
+    std::vector<std::string> var_names;
+    std::vector<segment> segments;
+};
+
+// implementation section
+
+inline compiled_template::compiled_template(const std::string &tmpl) {
+    using details::is_valid_var_char;
+    using details::render_state;
+
     // fmt
     using fmt::format;
 
     // std
-    using std::stringstream;
+    using std::move;
+    using std::string;
+
+    literals.reserve(tmpl.size());
 
-    stringstream output;
-    stringstream var_buffer;
+    string var_buffer;
     auto state = render_state::text;
 
     for (const auto c : tmpl) {
@@ -54,7 +139,7 @@ inline auto render(
                 state = render_state::var_starting;
                 break;
             default:
-                output << c;
+                add_literal(c);
                 break;
             }
             break;
@@ -65,7 +150,10 @@ inline auto render(
                 state = render_state::var;
                 break;
             default:
-                output << '{' << c;
+                // a lone '{' is plain text
+                state = render_state::text;
+                add_literal('{');
+                add_literal(c);
                 break;
             }
             break;
@@ -88,7 +176,7 @@ inline auto render(
                         c));
                 }
                 state = render_state::var_name_start;
-                var_buffer << c;
+                var_buffer.push_back(c);
                 break;
             }
             break;
@@ -106,7 +194,7 @@ inline auto render(
                     throw setup_error(
                         format("Found invalid char '{}' in variable name", c));
                 }
-                var_buffer << c;
+                var_buffer.push_back(c);
                 break;
             }
             break;
@@ -123,22 +211,21 @@ inline auto render(
                 throw setup_error(format(
                     "Found invalid char '{}' after variable name '{}'",
                     c,
-                    var_buffer.str()));
+                    var_buffer));
             }
             break;
 
         case render_state::var_ending:
             switch (c) {
-            case '}': {
+            case '}':
                 state = render_state::text;
-                const auto var_value_itr = m.find(var_buffer.str());
-                var_buffer.str("");
 
-                if (var_value_itr != m.cend()) {
-                    output << var_value_itr->second;
+                // verbatim text and empty braces have no variable to bind
+                if (!var_buffer.empty()) {
+                    add_var(move(var_buffer));
+                    var_buffer.clear();
                 }
                 break;
-            }
             default:
                 throw setup_error(
                     format("Found invalid char '{}' when expecting '}}'", c));
@@ -151,7 +238,7 @@ inline auto render(
                 state = render_state::var_name_done;
                 break;
             default:
-                output << c;
+                add_literal(c);
                 break;
             }
             break;
@@ -165,8 +252,90 @@ inline auto render(
     if (state != render_state::text) {
         throw setup_error("Invalid state reached after parsing last char");
     }
+}
+
+inline void compiled_template::add_literal(const char c) {
+    if (segments.empty() || segments.back().is_var) {
+        segments.push_back(segment{false, literals.size(), 0});
+    }
+
+    literals.push_back(c);
+    ++segments.back().size;
+}
+
+inline void compiled_template::add_var(std::string name) {
+    segments.push_back(segment{true, var_names.size(), 0});
+    var_names.push_back(std::move(name));
+}
 
-    return output.str();
+inline auto compiled_template::render(
+    const std::unordered_map<std::string, std::string> &m) const
+    -> std::string {
+
+    std::string out;
+    render_into(out, m);
+    return out;
+}
+
+inline void compiled_template::render_into(
+    std::string &out,
+    const std::unordered_map<std::string, std::string> &m) const {
+
+    // std
+    using std::string;
+
+    render_into_with(out, [&m](const string &name) -> const string * {
+        const auto value_itr = m.find(name);
+        return value_itr != m.cend() ? &value_itr->second : nullptr;
+    });
+}
+
+template <class Lookup>
+void compiled_template::render_into_with(
+    std::string &out, Lookup &&lookup) const {
+
+    // std
+    using std::string;
+    using std::vector;
+
+    // resolve every slot once, which also gives the exact output size
+    vector<const string *> values;
+    values.reserve(var_names.size());
+
+    auto total_size = literals.size();
+
+    for (const auto &var_name : var_names) {
+        const string *value = lookup(var_name);
+        total_size += value ? value->size() : 0;
+        values.push_back(value);
+    }
+
+    out.clear();
+    out.reserve(total_size);
+
+    for (const auto &seg : segments) {
+        if (seg.is_var) {
+            const auto value = values[seg.index];
+
+            if (value) {
+                out.append(*value);
+            }
+        } else {
+            out.append(literals, seg.index, seg.size);
+        }
+    }
+}
+
+inline auto compiled_template::variables() const
+    -> const std::vector<std::string> & {
+    return var_names;
+}
+
+namespace details {
+inline auto render(
+    const std::string &tmpl,
+    const std::unordered_map<std::string, std::string> &m) -> std::string {
+    return compiled_template(tmpl).render(m);
 }
 } // namespace details
 } // namespace spdlog_setup
@@ -0,0 +1,416 @@
+/**
+ * Implementation of CPU topology and NUMA-aware thread pools in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "setup_error.h"
+
+#include "spdlog/async.h"
+#include "spdlog/async_logger.h"
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/spdlog.h"
+
+#include <cstddef>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <regex>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+// thread pool workers can only be set up from spdlog v1.5.0 onwards
+#if defined(__linux__) && defined(SPDLOG_VERSION) && SPDLOG_VERSION >= 10500
+#define SPDLOG_SETUP_THREAD_SCHEDULING
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+/**
+ * Describes the NUMA nodes that the process may run on.
+ */
+struct numa_topology {
+    /**
+     * CPUs of each node, restricted to those the process may run on, where
+     * nodes without any such CPU are left out. Contains a single node with
+     * no CPUs if the topology is unknown.
+     */
+    std::vector<std::vector<int>> node_cpus;
+
+    /** Index into node_cpus of each CPU number, -1 if not in any node */
+    std::vector<int> node_of_cpu;
+};
+
+/**
+ * Thread pool with one spdlog thread pool per NUMA node, where this pool is
+ * the one of the first node. Each pool has its own queue and workers, so
+ * async loggers built on it enqueue into the pool of the node the producing
+ * thread runs on.
+ */
+class numa_thread_pool : public spdlog::details::thread_pool {
+  public:
+    /**
+     * Constructs the pool of the first node, taking over the pools of the
+     * other nodes.
+     * @param queue_size Maximum number of queued messages of each node.
+     * @param num_threads Number of workers of each node.
+     * @param on_thread_start Called by each worker of the first node as it
+     * starts.
+     * @param other_node_pools Pools of the other nodes in topology order.
+     */
+    numa_thread_pool(
+        const size_t queue_size,
+        const size_t num_threads,
+        std::function<void()> on_thread_start,
+        std::vector<std::shared_ptr<spdlog::details::thread_pool>>
+            other_node_pools);
+
+    numa_thread_pool(const numa_thread_pool &) = delete;
+    auto operator=(const numa_thread_pool &) -> numa_thread_pool & = delete;
+
+    ~numa_thread_pool();
+
+    /**
+     * Returns the pools of the nodes after the first, in topology order.
+     * @return Pools of the other nodes.
+     */
+    auto other_node_pools() const noexcept
+        -> const std::vector<std::shared_ptr<spdlog::details::thread_pool>> &;
+
+  private:
+    std::vector<std::shared_ptr<spdlog::details::thread_pool>> node_pools;
+};
+
+/**
+ * Async logger over a numa_thread_pool, which hands each message to an async
+ * logger of the node the producing thread first logged from. Each thread
+ * stays with the same node, so the messages of each thread keep their order.
+ */
+class numa_async_logger : public spdlog::logger {
+  public:
+    /**
+     * Constructor accepting the sinks shared by the loggers of every node.
+     * @param name Name of the logger.
+     * @param sinks Sinks of the logger.
+     * @param pool Pools to log through.
+     * @param overflow_policy Policy when the queue of a node is full.
+     */
+    numa_async_logger(
+        std::string name,
+        const std::vector<spdlog::sink_ptr> &sinks,
+        const std::shared_ptr<numa_thread_pool> &pool,
+        const spdlog::async_overflow_policy overflow_policy);
+
+    auto clone(std::string logger_name)
+        -> std::shared_ptr<spdlog::logger> override;
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    std::vector<std::shared_ptr<spdlog::async_logger>> node_loggers;
+};
+
+/**
+ * Returns the thread pool as a numa_thread_pool if it is one. spdlog thread
+ * pools are not polymorphic, so numa_thread_pool instances are tracked
+ * instead.
+ * @param pool Thread pool.
+ * @return Same thread pool as a numa_thread_pool, nullptr if not one.
+ */
+auto as_numa_thread_pool(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool)
+    -> std::shared_ptr<numa_thread_pool>;
+
+// implementation section
+
+// both are leaked, since pools may be destroyed during static destruction
+
+inline auto numa_thread_pools_mutex() -> std::mutex & {
+    static const auto mutex = new std::mutex();
+    return *mutex;
+}
+
+inline auto numa_thread_pools_registry()
+    -> std::unordered_set<const spdlog::details::thread_pool *> & {
+
+    static const auto registry =
+        new std::unordered_set<const spdlog::details::thread_pool *>();
+
+    return *registry;
+}
+
+inline auto as_numa_thread_pool(
+    const std::shared_ptr<spdlog::details::thread_pool> &pool)
+    -> std::shared_ptr<numa_thread_pool> {
+
+    std::lock_guard<std::mutex> lock(numa_thread_pools_mutex());
+
+    return numa_thread_pools_registry().count(pool.get())
+               ? std::static_pointer_cast<numa_thread_pool>(pool)
+               : nullptr;
+}
+
+inline auto parse_cpu_list(const std::string &cpu_list) -> std::vector<int> {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::regex;
+    using std::regex_match;
+    using std::smatch;
+    using std::sregex_token_iterator;
+    using std::stoi;
+    using std::string;
+    using std::vector;
+
+    static const regex SEPARATOR_RE(",");
+    static const regex RANGE_RE(R"_(^\s*(\d{1,5})\s*(?:-\s*(\d{1,5})\s*)?$)_");
+
+    vector<int> cpus;
+
+    for (sregex_token_iterator itr(
+             cpu_list.cbegin(), cpu_list.cend(), SEPARATOR_RE, -1);
+         itr != sregex_token_iterator();
+         ++itr) {
+
+        const string range = *itr;
+        smatch matches;
+
+        if (!regex_match(range, matches, RANGE_RE)) {
+            throw setup_error(format(
+                "Invalid CPU list '{}', expected for example \"0-3,8\"",
+                cpu_list));
+        }
+
+        const auto first = stoi(matches[1]);
+        const auto last = matches[2].matched ? stoi(matches[2]) : first;
+
+        if (last < first) {
+            throw setup_error(
+                format("Invalid CPU range '{}' in '{}'", range, cpu_list));
+        }
+
+        for (auto cpu = first; cpu <= last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+    }
+
+    return cpus;
+}
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+inline auto read_numa_topology() -> numa_topology {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::getline;
+    using std::ifstream;
+    using std::move;
+    using std::string;
+    using std::vector;
+
+    static constexpr auto NODE_DIR = "/sys/devices/system/node/";
+
+    const auto read_cpu_list = [](const string &path, vector<int> &cpus) {
+        ifstream file(path);
+        string cpu_list;
+
+        if (!file || !getline(file, cpu_list)) {
+            return false;
+        }
+
+        // an empty list is valid for nodes with only memory
+        cpus = cpu_list.empty() ? vector<int>() : parse_cpu_list(cpu_list);
+        return true;
+    };
+
+    cpu_set_t allowed_cpus;
+    CPU_ZERO(&allowed_cpus);
+    sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus);
+
+    numa_topology topology;
+    vector<int> nodes;
+
+    try {
+        if (read_cpu_list(format("{}online", NODE_DIR), nodes)) {
+            for (const auto node : nodes) {
+                vector<int> cpus;
+
+                if (!read_cpu_list(
+                        format("{}node{}/cpulist", NODE_DIR, node), cpus)) {
+                    continue;
+                }
+
+                vector<int> allowed_node_cpus;
+
+                for (const auto cpu : cpus) {
+                    if (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed_cpus)) {
+                        allowed_node_cpus.push_back(cpu);
+                    }
+                }
+
+                if (!allowed_node_cpus.empty()) {
+                    topology.node_cpus.push_back(move(allowed_node_cpus));
+                }
+            }
+        }
+    } catch (const setup_error &) {
+        // unexpected format, treated as unknown
+        topology.node_cpus.clear();
+    }
+
+    if (topology.node_cpus.empty()) {
+        topology.node_cpus.emplace_back();
+        return topology;
+    }
+
+    for (size_t i = 0; i < topology.node_cpus.size(); ++i) {
+        for (const auto cpu : topology.node_cpus[i]) {
+            if (static_cast<size_t>(cpu) >= topology.node_of_cpu.size()) {
+                topology.node_of_cpu.resize(cpu + 1, -1);
+            }
+
+            topology.node_of_cpu[cpu] = static_cast<int>(i);
+        }
+    }
+
+    return topology;
+}
+
+/**
+ * Returns the NUMA topology, which is read once per process.
+ * @return NUMA topology.
+ */
+inline auto system_numa_topology() -> const numa_topology & {
+    static const numa_topology topology = read_numa_topology();
+    return topology;
+}
+
+/**
+ * Returns the NUMA node of the CPU the calling thread first ran on when
+ * called, which never changes afterwards for the thread.
+ * @return Index into the node_cpus of system_numa_topology().
+ */
+inline auto current_numa_node() -> size_t {
+    static thread_local const auto node = [] {
+        const auto &node_of_cpu = system_numa_topology().node_of_cpu;
+        const auto cpu = sched_getcpu();
+
+        return cpu >= 0 && static_cast<size_t>(cpu) < node_of_cpu.size() &&
+                       node_of_cpu[cpu] >= 0
+                   ? static_cast<size_t>(node_of_cpu[cpu])
+                   : 0;
+    }();
+
+    return node;
+}
+#endif
+
+inline numa_thread_pool::numa_thread_pool(
+    const size_t queue_size,
+    const size_t num_threads,
+    std::function<void()> on_thread_start,
+    std::vector<std::shared_ptr<spdlog::details::thread_pool>>
+        other_node_pools)
+    : spdlog::details::thread_pool(
+          queue_size, num_threads, std::move(on_thread_start)),
+      node_pools(std::move(other_node_pools)) {
+
+    std::lock_guard<std::mutex> lock(numa_thread_pools_mutex());
+    numa_thread_pools_registry().insert(this);
+}
+
+inline numa_thread_pool::~numa_thread_pool() {
+    std::lock_guard<std::mutex> lock(numa_thread_pools_mutex());
+    numa_thread_pools_registry().erase(this);
+}
+
+inline auto numa_thread_pool::other_node_pools() const noexcept
+    -> const std::vector<std::shared_ptr<spdlog::details::thread_pool>> & {
+    return node_pools;
+}
+
+inline numa_async_logger::numa_async_logger(
+    std::string name,
+    const std::vector<spdlog::sink_ptr> &sinks,
+    const std::shared_ptr<numa_thread_pool> &pool,
+    const spdlog::async_overflow_policy overflow_policy)
+    : spdlog::logger(std::move(name), sinks.cbegin(), sinks.cend()) {
+
+    // std
+    using std::make_shared;
+    using std::shared_ptr;
+
+    // spdlog
+    using spdlog::async_logger;
+    using spdlog::details::thread_pool;
+
+    const auto add_node_logger = [this, &sinks, overflow_policy](
+                                     const shared_ptr<thread_pool> &node_pool) {
+        const auto node_logger = make_shared<async_logger>(
+            this->name(),
+            sinks.cbegin(),
+            sinks.cend(),
+            node_pool,
+            overflow_policy);
+
+        // levels are only checked by this logger
+        node_logger->set_level(spdlog::level::trace);
+        node_loggers.push_back(node_logger);
+    };
+
+    add_node_logger(pool);
+
+    for (const auto &node_pool : pool->other_node_pools()) {
+        add_node_logger(node_pool);
+    }
+}
+
+inline auto numa_async_logger::clone(std::string logger_name)
+    -> std::shared_ptr<spdlog::logger> {
+
+    auto cloned = std::make_shared<numa_async_logger>(*this);
+    cloned->name_ = std::move(logger_name);
+
+    for (auto &node_logger : cloned->node_loggers) {
+        node_logger = std::static_pointer_cast<spdlog::async_logger>(
+            node_logger->clone(cloned->name_));
+    }
+
+    return cloned;
+}
+
+inline void numa_async_logger::sink_it_(const spdlog::details::log_msg &msg) {
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+    const auto &node_logger =
+        node_loggers[current_numa_node() % node_loggers.size()];
+#else
+    const auto &node_logger = node_loggers.front();
+#endif
+
+#if defined(SPDLOG_VERSION) && SPDLOG_VERSION >= 10600
+    node_logger->log(msg.time, msg.source, msg.level, msg.payload);
+#else
+    node_logger->log(msg.source, msg.level, msg.payload);
+#endif
+}
+
+inline void numa_async_logger::flush_() {
+    for (const auto &node_logger : node_loggers) {
+        node_logger->flush();
+    }
+}
+} // namespace details
+} // namespace spdlog_setup
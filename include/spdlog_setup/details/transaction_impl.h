@@ -0,0 +1,266 @@
+/**
+ * Implementation of batched override file editing in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "conf_impl.h"
+#include "file_impl.h"
+#include "setup_error.h"
+
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/spdlog.h"
+
+#include <exception>
+#include <memory>
+#include <string>
+
+namespace spdlog_setup {
+// declaration section
+
+/**
+ * Batch of edits to an override file, which loads the file once, applies any
+ * number of edits in memory, and writes the file once on commit by replacing
+ * it atomically, so that readers never see a partially edited file. Nothing
+ * is written if the transaction is not committed.
+ */
+class override_transaction {
+  public:
+    /**
+     * Loads the override file, where a missing file starts the transaction
+     * with an empty configuration.
+     * @param toml_path Path to the override TOML configuration file path.
+     * @param overwrite Default false to edit the existing file, true to
+     * ignore the existing file if present, and start from an empty
+     * configuration.
+     * @throw setup_error
+     */
+    explicit override_transaction(
+        const std::string &toml_path, const bool overwrite = false);
+
+    /**
+     * Sets the level of the logger entry, adding the entry if absent.
+     * @param logger_name Name of the logger.
+     * @param level Level to set.
+     * @throw setup_error
+     */
+    void set_logger_level(
+        const std::string &logger_name,
+        const spdlog::level::level_enum level);
+
+    /**
+     * Sets the level of the sink entry, adding the entry if absent.
+     * @param sink_name Name of the sink.
+     * @param level Level to set.
+     * @throw setup_error
+     */
+    void set_sink_level(
+        const std::string &sink_name, const spdlog::level::level_enum level);
+
+    /**
+     * Serializes the current level of the logger tagged with its logger name,
+     * as with save_logger_to_file.
+     * @param logger Logger to serialize.
+     * @throw setup_error
+     */
+    void save_logger(const std::shared_ptr<spdlog::logger> &logger);
+
+    /**
+     * Serializes the current levels of all loggers registered in spdlog.
+     * @throw setup_error
+     */
+    void save_registered_loggers();
+
+    /**
+     * Removes the logger entry.
+     * @param logger_name Name of the logger.
+     * @return true if the entry is found for deletion, else false.
+     */
+    auto delete_logger(const std::string &logger_name) -> bool;
+
+    /**
+     * Removes the sink entry.
+     * @param sink_name Name of the sink.
+     * @return true if the entry is found for deletion, else false.
+     */
+    auto delete_sink(const std::string &sink_name) -> bool;
+
+    /**
+     * Returns the configuration as edited so far.
+     * @return Edited configuration.
+     */
+    auto config() const -> const cpptoml::table &;
+
+    /**
+     * Writes the edited configuration into a temporary file next to the
+     * override file, and renames it over the override file.
+     * @throw setup_error
+     */
+    void commit();
+
+  private:
+    auto item_table(
+        const char table_name[],
+        details::item_name_index &items_index,
+        const std::string &name) -> cpptoml::table &;
+
+    auto delete_item(
+        const char table_name[],
+        details::item_name_index &items_index,
+        const std::string &name) -> bool;
+
+    std::string toml_path;
+    std::shared_ptr<cpptoml::table> edited_config;
+
+    /** Entries by name, so that each edit does not scan the whole file */
+    details::item_name_index loggers_index;
+    details::item_name_index sinks_index;
+};
+
+inline override_transaction::override_transaction(
+    const std::string &toml_path, const bool overwrite)
+    : toml_path(toml_path) {
+
+    using details::names::LOGGER_TABLE;
+    using details::names::SINK_TABLE;
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::exception;
+
+    try {
+        edited_config = !overwrite && details::file_exists(toml_path)
+                            ? details::parse_toml_file(toml_path)
+                            : cpptoml::make_table();
+    } catch (const exception &e) {
+        throw setup_error(format(
+            "Unable to parse file at '{}' for editing:\n > {}",
+            toml_path,
+            e.what()));
+    }
+
+    if (const auto loggers = edited_config->get_table_array(LOGGER_TABLE)) {
+        loggers_index = details::index_items_by_name(*loggers);
+    }
+
+    if (const auto sinks = edited_config->get_table_array(SINK_TABLE)) {
+        sinks_index = details::index_items_by_name(*sinks);
+    }
+}
+
+inline void override_transaction::set_logger_level(
+    const std::string &logger_name, const spdlog::level::level_enum level) {
+
+    using details::names::LEVEL;
+    using details::names::LOGGER_TABLE;
+
+    // insert can overwrite the value
+    item_table(LOGGER_TABLE, loggers_index, logger_name)
+        .insert(LEVEL, details::level_to_str(level));
+}
+
+inline void override_transaction::set_sink_level(
+    const std::string &sink_name, const spdlog::level::level_enum level) {
+
+    using details::names::LEVEL;
+    using details::names::SINK_TABLE;
+
+    item_table(SINK_TABLE, sinks_index, sink_name)
+        .insert(LEVEL, details::level_to_str(level));
+}
+
+inline void override_transaction::save_logger(
+    const std::shared_ptr<spdlog::logger> &logger) {
+
+    set_logger_level(logger->name(), logger->level());
+}
+
+inline void override_transaction::save_registered_loggers() {
+    // std
+    using std::shared_ptr;
+
+    spdlog::apply_all([this](const shared_ptr<spdlog::logger> logger) {
+        save_logger(logger);
+    });
+}
+
+inline auto override_transaction::delete_logger(const std::string &logger_name)
+    -> bool {
+
+    return delete_item(
+        details::names::LOGGER_TABLE, loggers_index, logger_name);
+}
+
+inline auto override_transaction::delete_sink(const std::string &sink_name)
+    -> bool {
+
+    return delete_item(details::names::SINK_TABLE, sinks_index, sink_name);
+}
+
+inline auto override_transaction::config() const -> const cpptoml::table & {
+    return *edited_config;
+}
+
+inline void override_transaction::commit() {
+    details::write_to_config_file(*edited_config, toml_path);
+}
+
+inline auto override_transaction::item_table(
+    const char table_name[],
+    details::item_name_index &items_index,
+    const std::string &name) -> cpptoml::table & {
+
+    using details::names::NAME;
+
+    const auto item_itr = items_index.find(name);
+
+    if (item_itr != items_index.cend()) {
+        return *item_itr->second;
+    }
+
+    auto items = edited_config->get_table_array(table_name);
+
+    if (!items) {
+        items = cpptoml::make_table_array();
+        edited_config->insert(table_name, items);
+    }
+
+    const auto item = cpptoml::make_table();
+    item->insert(NAME, name);
+    items->push_back(item);
+
+    items_index.emplace(name, item);
+    return *item;
+}
+
+inline auto override_transaction::delete_item(
+    const char table_name[],
+    details::item_name_index &items_index,
+    const std::string &name) -> bool {
+
+    const auto item_itr = items_index.find(name);
+
+    if (item_itr == items_index.cend()) {
+        return false;
+    }
+
+    auto &items = *edited_config->get_table_array(table_name);
+    const auto found_item_itr = details::find_item_iter_by_name(items, name);
+    items.erase(found_item_itr);
+
+    // a repeated entry of the same name now takes over
+    const auto next_item = details::find_item_by_name(items, name);
+
+    if (next_item) {
+        item_itr->second = next_item;
+    } else {
+        items_index.erase(item_itr);
+    }
+
+    return true;
+}
+} // namespace spdlog_setup
@@ -0,0 +1,577 @@
+/**
+ * Implementation of the io_uring file sinks in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "buffered_sink_impl.h"
+#include "stats_impl.h"
+
+#include "spdlog/common.h"
+#include "spdlog/details/log_msg.h"
+#include "spdlog/details/null_mutex.h"
+#include "spdlog/fmt/fmt.h"
+#include "spdlog/sinks/base_sink.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// io_uring is set up through raw system calls, so only its header is needed
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define SPDLOG_SETUP_IO_URING
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+#endif
+
+namespace spdlog_setup {
+namespace details {
+// declaration section
+
+#ifdef SPDLOG_SETUP_IO_URING
+/**
+ * Writes a file through a number of buffers, each submitted to io_uring once
+ * full or flushed, so that writing never waits for the disk, unless every
+ * buffer is still being written.
+ */
+class uring_file {
+  public:
+    /**
+     * Opens the file at the given path, together with an io_uring instance.
+     * @param filename Path of the file to write into.
+     * @param buffer_size Size of each buffer in bytes.
+     * @param buffers_in_flight Maximum number of buffers being written at the
+     * same time, besides the one being filled.
+     * @param truncate true to discard the existing content of the file.
+     * @return File opened, or nullptr if io_uring is not available.
+     * @throw spdlog::spdlog_ex
+     */
+    static auto open(
+        const std::string &filename,
+        const size_t buffer_size,
+        const size_t buffers_in_flight,
+        const bool truncate) -> std::unique_ptr<uring_file>;
+
+    uring_file(const uring_file &) = delete;
+    auto operator=(const uring_file &) -> uring_file & = delete;
+
+    /**
+     * Submits the buffer being filled, waits for every buffer to be written
+     * and closes the file.
+     */
+    ~uring_file();
+
+    /**
+     * Appends the given bytes to the buffer being filled, submitting it
+     * whenever full.
+     * @param data Start of the bytes to append.
+     * @param size Number of bytes to append.
+     * @throw spdlog::spdlog_ex
+     */
+    void write(const char *data, size_t size);
+
+    /**
+     * Submits the buffer being filled and waits for every buffer to be
+     * written.
+     * @throw spdlog::spdlog_ex
+     */
+    void flush();
+
+  private:
+    struct write_buffer {
+        std::unique_ptr<char[]> data;
+        size_t capacity;
+        size_t used;
+        uint64_t offset;
+        iovec vec;
+        bool in_flight;
+    };
+
+    uring_file(const std::string &filename, const int fd, const int ring_fd);
+
+    void map_rings(const io_uring_params &params);
+    void submit_current();
+    void acquire_buffer();
+    void reap_completions(const bool wait);
+    void complete(write_buffer &buffer, const int32_t result);
+
+    const std::string filename;
+    const int fd;
+    const int ring_fd;
+    uint64_t file_offset;
+
+    std::vector<write_buffer> buffers;
+    size_t current;
+    size_t in_flight;
+
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    io_uring_sqe *sqes;
+    size_t sqes_size;
+
+    unsigned *sq_tail;
+    unsigned sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned cq_mask;
+    io_uring_cqe *cqes;
+};
+#endif
+} // namespace details
+
+/**
+ * Sink that writes formatted messages into a file through io_uring, so that
+ * the thread writing into the sink never waits for the disk, unless the
+ * configured number of buffers are all still being written. Flushing waits
+ * until every buffer is written, as for the other file sinks. Falls back to
+ * writing through a single buffer with plain writes where io_uring is not
+ * available, either on other platforms or when disabled at runtime.
+ */
+template <class Mutex>
+class uring_file_sink : public spdlog::sinks::base_sink<Mutex> {
+  public:
+    /**
+     * Constructor accepting the file to write into.
+     * @param filename Path of the file to write into.
+     * @param buffer_size Size of each buffer in bytes.
+     * @param buffers_in_flight Maximum number of buffers being written at the
+     * same time, up to 32768 for io_uring to be set up.
+     * @param truncate true to discard the existing content of the file.
+     * @throw spdlog::spdlog_ex
+     */
+    uring_file_sink(
+        const std::string &filename,
+        const size_t buffer_size,
+        const size_t buffers_in_flight,
+        const bool truncate = false);
+
+    /**
+     * Returns the path of the file written into.
+     * @return Path of the file.
+     */
+    auto filename() const -> const std::string &;
+
+    /**
+     * Returns whether the file is written through io_uring, rather than the
+     * fallback.
+     * @return true if written through io_uring.
+     */
+    auto uses_io_uring() const noexcept -> bool;
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &msg) override;
+    void flush_() override;
+
+  private:
+    const std::string file_path;
+
+#ifdef SPDLOG_SETUP_IO_URING
+    std::unique_ptr<details::uring_file> uring;
+#endif
+
+    std::unique_ptr<details::buffered_file> fallback;
+};
+
+using uring_file_sink_mt = uring_file_sink<std::mutex>;
+using uring_file_sink_st = uring_file_sink<spdlog::details::null_mutex>;
+
+namespace details {
+// implementation section
+
+#ifdef SPDLOG_SETUP_IO_URING
+inline auto uring_file::open(
+    const std::string &filename,
+    const size_t buffer_size,
+    const size_t buffers_in_flight,
+    const bool truncate) -> std::unique_ptr<uring_file> {
+
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::unique_ptr;
+
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+
+    const auto ring_fd = static_cast<int>(syscall(
+        __NR_io_uring_setup,
+        static_cast<unsigned>(buffers_in_flight),
+        &params));
+
+    // ENOSYS on older kernels, EPERM when disabled or filtered by seccomp
+    if (ring_fd < 0) {
+        return nullptr;
+    }
+
+    const auto fd = ::open(
+        filename.c_str(),
+        O_WRONLY | O_CREAT | O_CLOEXEC | (truncate ? O_TRUNC : 0),
+        0644);
+
+    if (fd < 0) {
+        const auto error = errno;
+        ::close(ring_fd);
+
+        throw spdlog::spdlog_ex(
+            format("Failed opening file {} for writing", filename), error);
+    }
+
+    unique_ptr<uring_file> file(new uring_file(filename, fd, ring_fd));
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed getting size of file {}", filename), errno);
+    }
+
+    file->file_offset = static_cast<uint64_t>(st.st_size);
+    file->map_rings(params);
+
+    // one more buffer than in flight, so that one can always be filled
+    file->buffers.resize(buffers_in_flight + 1);
+
+    for (auto &buffer : file->buffers) {
+        buffer.data.reset(new char[buffer_size]);
+        buffer.capacity = buffer_size;
+        buffer.used = 0;
+        buffer.offset = 0;
+        buffer.vec.iov_base = buffer.data.get();
+        buffer.vec.iov_len = 0;
+        buffer.in_flight = false;
+    }
+
+    return file;
+}
+
+inline uring_file::uring_file(
+    const std::string &filename, const int fd, const int ring_fd)
+    : filename(filename), fd(fd), ring_fd(ring_fd), file_offset(0),
+      current(0), in_flight(0), sq_ring(MAP_FAILED), sq_ring_size(0),
+      cq_ring(MAP_FAILED), cq_ring_size(0), sqes(nullptr), sqes_size(0),
+      sq_tail(nullptr), sq_mask(0), sq_array(nullptr), cq_head(nullptr),
+      cq_tail(nullptr), cq_mask(0), cqes(nullptr) {}
+
+inline uring_file::~uring_file() {
+    try {
+        if (!buffers.empty()) {
+            submit_current();
+
+            while (in_flight > 0) {
+                reap_completions(true);
+            }
+        }
+    } catch (...) {
+        // nothing else can be done in a destructor
+    }
+
+    if (sqes) {
+        munmap(sqes, sqes_size);
+    }
+
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+        munmap(cq_ring, cq_ring_size);
+    }
+
+    if (sq_ring != MAP_FAILED) {
+        munmap(sq_ring, sq_ring_size);
+    }
+
+    ::close(ring_fd);
+    ::close(fd);
+}
+
+inline void uring_file::write(const char *data, size_t size) {
+    while (size > 0) {
+        auto &buffer = buffers[current];
+
+        const auto count = std::min(size, buffer.capacity - buffer.used);
+        std::memcpy(buffer.data.get() + buffer.used, data, count);
+
+        buffer.used += count;
+        data += count;
+        size -= count;
+
+        if (buffer.used == buffer.capacity) {
+            submit_current();
+        }
+    }
+}
+
+inline void uring_file::flush() {
+    submit_current();
+
+    while (in_flight > 0) {
+        reap_completions(true);
+    }
+}
+
+inline void uring_file::map_rings(const io_uring_params &params) {
+    // fmt
+    using fmt::format;
+
+    const auto map_ring = [this](const size_t size, const uint64_t offset) {
+        const auto ring = mmap(
+            nullptr,
+            size,
+            PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE,
+            ring_fd,
+            static_cast<off_t>(offset));
+
+        if (ring == MAP_FAILED) {
+            throw spdlog::spdlog_ex(
+                format("Failed mapping io_uring for file {}", filename), errno);
+        }
+
+        return ring;
+    };
+
+    sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+
+    cq_ring_size =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    // both rings share a single mapping from Linux 5.4 onwards
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        sq_ring_size = cq_ring_size = std::max(sq_ring_size, cq_ring_size);
+    }
+
+    sq_ring = map_ring(sq_ring_size, IORING_OFF_SQ_RING);
+
+    cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP)
+                  ? sq_ring
+                  : map_ring(cq_ring_size, IORING_OFF_CQ_RING);
+
+    sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    sqes = static_cast<io_uring_sqe *>(map_ring(sqes_size, IORING_OFF_SQES));
+
+    const auto sq_base = static_cast<char *>(sq_ring);
+    const auto cq_base = static_cast<char *>(cq_ring);
+
+    sq_tail = reinterpret_cast<unsigned *>(sq_base + params.sq_off.tail);
+    sq_mask = *reinterpret_cast<unsigned *>(sq_base + params.sq_off.ring_mask);
+    sq_array = reinterpret_cast<unsigned *>(sq_base + params.sq_off.array);
+    cq_head = reinterpret_cast<unsigned *>(cq_base + params.cq_off.head);
+    cq_tail = reinterpret_cast<unsigned *>(cq_base + params.cq_off.tail);
+    cq_mask = *reinterpret_cast<unsigned *>(cq_base + params.cq_off.ring_mask);
+    cqes = reinterpret_cast<io_uring_cqe *>(cq_base + params.cq_off.cqes);
+}
+
+inline void uring_file::submit_current() {
+    // fmt
+    using fmt::format;
+
+    auto &buffer = buffers[current];
+
+    if (buffer.used == 0) {
+        return;
+    }
+
+    // only waits for the disk once every buffer is in flight
+    while (in_flight == buffers.size() - 1) {
+        reap_completions(true);
+    }
+
+    buffer.offset = file_offset;
+    buffer.vec.iov_len = buffer.used;
+    buffer.in_flight = true;
+    file_offset += buffer.used;
+
+    // never more submissions than entries, so the ring cannot be full
+    const auto tail = *sq_tail;
+    const auto index = tail & sq_mask;
+
+    auto &sqe = sqes[index];
+    std::memset(&sqe, 0, sizeof(sqe));
+    sqe.opcode = IORING_OP_WRITEV;
+    sqe.fd = fd;
+    sqe.off = buffer.offset;
+    sqe.addr = reinterpret_cast<uint64_t>(&buffer.vec);
+    sqe.len = 1;
+    sqe.user_data = current;
+
+    sq_array[index] = index;
+    __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++in_flight;
+
+    while (syscall(__NR_io_uring_enter, ring_fd, 1, 0, 0, nullptr, 0) < 0) {
+        if (errno != EINTR && errno != EAGAIN) {
+            throw spdlog::spdlog_ex(
+                format("Failed submitting write to file {}", filename), errno);
+        }
+    }
+
+    acquire_buffer();
+}
+
+inline void uring_file::acquire_buffer() {
+    reap_completions(false);
+
+    // there is always one more buffer than may be in flight
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        if (!buffers[i].in_flight) {
+            current = i;
+            return;
+        }
+    }
+}
+
+inline void uring_file::reap_completions(const bool wait) {
+    // fmt
+    using fmt::format;
+
+    if (wait) {
+        while (syscall(
+                   __NR_io_uring_enter,
+                   ring_fd,
+                   0,
+                   1,
+                   IORING_ENTER_GETEVENTS,
+                   nullptr,
+                   0) < 0) {
+
+            if (errno != EINTR) {
+                throw spdlog::spdlog_ex(
+                    format("Failed waiting for writes to file {}", filename),
+                    errno);
+            }
+        }
+    }
+
+    auto head = *cq_head;
+
+    while (head != __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE)) {
+        const auto &cqe = cqes[head & cq_mask];
+        const auto index = static_cast<size_t>(cqe.user_data);
+        const auto result = cqe.res;
+
+        ++head;
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+
+        complete(buffers[index], result);
+    }
+}
+
+inline void uring_file::complete(write_buffer &buffer, const int32_t result) {
+    // fmt
+    using fmt::format;
+
+    const auto size = buffer.used;
+
+    buffer.used = 0;
+    buffer.in_flight = false;
+    --in_flight;
+
+    if (result < 0) {
+        throw spdlog::spdlog_ex(
+            format("Failed writing to file {}", filename), -result);
+    }
+
+    // short writes are rare enough to finish synchronously
+    auto written = static_cast<size_t>(result);
+
+    while (written < size) {
+        const auto count = pwrite(
+            fd,
+            buffer.data.get() + written,
+            size - written,
+            static_cast<off_t>(buffer.offset + written));
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            throw spdlog::spdlog_ex(
+                format("Failed writing to file {}", filename), errno);
+        }
+
+        written += static_cast<size_t>(count);
+    }
+}
+#endif
+} // namespace details
+
+template <class Mutex>
+uring_file_sink<Mutex>::uring_file_sink(
+    const std::string &filename,
+    const size_t buffer_size,
+    const size_t buffers_in_flight,
+    const bool truncate)
+    : file_path(filename) {
+
+    if (buffer_size == 0 || buffers_in_flight == 0) {
+        throw spdlog::spdlog_ex(
+            "uring_file_sink constructor: buffer_size and buffers_in_flight "
+            "args cannot be zero");
+    }
+
+#ifdef SPDLOG_SETUP_IO_URING
+    uring = details::uring_file::open(
+        filename, buffer_size, buffers_in_flight, truncate);
+
+    if (uring) {
+        return;
+    }
+#endif
+
+    fallback.reset(new details::buffered_file(buffer_size, false));
+    fallback->open(filename, truncate);
+}
+
+template <class Mutex>
+auto uring_file_sink<Mutex>::filename() const -> const std::string & {
+    return file_path;
+}
+
+template <class Mutex>
+auto uring_file_sink<Mutex>::uses_io_uring() const noexcept -> bool {
+    return !fallback;
+}
+
+template <class Mutex>
+void uring_file_sink<Mutex>::sink_it_(const spdlog::details::log_msg &msg) {
+    details::formatted_buffer formatted;
+    spdlog::sinks::base_sink<Mutex>::formatter_->format(msg, formatted);
+
+#ifdef SPDLOG_SETUP_IO_URING
+    if (uring) {
+        uring->write(formatted.data(), formatted.size());
+        return;
+    }
+#endif
+
+    fallback->write(formatted.data(), formatted.size());
+}
+
+template <class Mutex> void uring_file_sink<Mutex>::flush_() {
+#ifdef SPDLOG_SETUP_IO_URING
+    if (uring) {
+        uring->flush();
+        return;
+    }
+#endif
+
+    fallback->flush();
+}
+} // namespace spdlog_setup
@@ -0,0 +1,469 @@
+/**
+ * Implementation of configuration file watching in spdlog_setup.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#pragma once
+
+#include "conf_impl.h"
+#include "file_impl.h"
+#include "reconfigure_impl.h"
+#include "setup_error.h"
+
+#include "spdlog/fmt/fmt.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace spdlog_setup {
+// declaration section
+
+/**
+ * Options for watching configuration files.
+ */
+struct watch_options {
+    /**
+     * Quiet period after the last change before reloading, so that the many
+     * writes of an editor saving a file only cause a single reload.
+     */
+    std::chrono::milliseconds debounce = std::chrono::milliseconds(200);
+
+    /**
+     * Interval between checks of the files when change notification is not
+     * available on the platform.
+     */
+    std::chrono::milliseconds poll_interval = std::chrono::milliseconds(1000);
+
+    /** Called on the watcher thread after every successful reload */
+    std::function<void()> on_reload;
+
+    /**
+     * Called on the watcher thread with the error message after every failed
+     * reload, in which case the previous configuration remains in place.
+     * Defaults to printing to stderr.
+     */
+    std::function<void(const std::string &)> on_error;
+};
+
+namespace details {
+struct watch_context;
+} // namespace details
+
+/**
+ * Handle of a background thread watching configuration files, which stops the
+ * thread when destroyed.
+ */
+class watcher {
+  public:
+    /**
+     * Starts watching the base and override files.
+     * @param base_toml_path Path to the base TOML configuration file path.
+     * @param override_toml_path Path to the override TOML configuration file
+     * path, which does not need to exist.
+     * @param options Options for watching.
+     * @throw setup_error
+     */
+    watcher(
+        const std::string &base_toml_path,
+        const std::string &override_toml_path,
+        watch_options options);
+
+    watcher(watcher &&other) noexcept;
+    auto operator=(watcher &&other) noexcept -> watcher &;
+    ~watcher();
+
+    /**
+     * Stops watching and waits for any reload in progress to complete. Does
+     * nothing if already stopped.
+     */
+    void stop() noexcept;
+
+  private:
+    std::unique_ptr<details::watch_context> context;
+};
+
+namespace details {
+/**
+ * Describes the state shared between a watcher and its background thread.
+ */
+struct watch_context {
+    std::string base_toml_path;
+    std::string override_toml_path;
+    watch_options options;
+
+    /** Guards started and stopping */
+    std::mutex mutex;
+    std::condition_variable started_cv;
+    std::condition_variable stop_cv;
+    bool started = false;
+    bool stopping = false;
+
+#ifdef __linux__
+    /** Pipe for waking up the inotify watch, -1 if not created */
+    int stop_pipe[2] = {-1, -1};
+#endif
+
+    std::thread thread;
+};
+
+// implementation section
+
+inline void reload_watched(watch_context &context) noexcept {
+    // fmt
+    using fmt::format;
+
+    // std
+    using std::exception;
+    using std::string;
+
+    string err_msg;
+
+    try {
+        const auto merged_config = parse_toml_file(context.base_toml_path);
+
+        if (file_exists(context.override_toml_path)) {
+            merge_config_root(
+                merged_config, parse_toml_file(context.override_toml_path));
+        }
+
+        reconfigure(merged_config);
+    } catch (const exception &e) {
+        err_msg = e.what();
+    } catch (...) {
+        err_msg = "Unknown error";
+    }
+
+    try {
+        if (err_msg.empty()) {
+            if (context.options.on_reload) {
+                context.options.on_reload();
+            }
+        } else if (context.options.on_error) {
+            context.options.on_error(err_msg);
+        } else {
+            std::fprintf(
+                stderr,
+                "%s\n",
+                format(
+                    "spdlog_setup: unable to reload '{}': {}",
+                    context.base_toml_path,
+                    err_msg)
+                    .c_str());
+        }
+    } catch (...) {
+        // callbacks must not end the watcher thread
+    }
+}
+
+inline void mark_watch_started(watch_context &context) {
+    {
+        std::lock_guard<std::mutex> lock(context.mutex);
+        context.started = true;
+    }
+
+    context.started_cv.notify_all();
+}
+
+inline void run_polling_watch(watch_context &context) {
+    // std
+    using std::mutex;
+    using std::unique_lock;
+    using std::chrono::steady_clock;
+
+    const auto same_stat = [](const file_stat &lhs, const file_stat &rhs) {
+        return lhs.exists == rhs.exists && lhs.size == rhs.size &&
+               lhs.mtime_sec == rhs.mtime_sec &&
+               lhs.mtime_nsec == rhs.mtime_nsec;
+    };
+
+    auto base_stat = stat_file(context.base_toml_path);
+    auto override_stat = stat_file(context.override_toml_path);
+    mark_watch_started(context);
+
+    auto pending = false;
+    auto last_change = steady_clock::now();
+
+    unique_lock<mutex> lock(context.mutex);
+
+    while (true) {
+        const auto interval = pending && context.options.debounce <
+                                             context.options.poll_interval
+                                  ? context.options.debounce
+                                  : context.options.poll_interval;
+
+        if (context.stop_cv.wait_for(
+                lock, interval, [&context] { return context.stopping; })) {
+            return;
+        }
+
+        const auto new_base_stat = stat_file(context.base_toml_path);
+        const auto new_override_stat = stat_file(context.override_toml_path);
+
+        if (!same_stat(new_base_stat, base_stat) ||
+            !same_stat(new_override_stat, override_stat)) {
+            base_stat = new_base_stat;
+            override_stat = new_override_stat;
+            pending = true;
+            last_change = steady_clock::now();
+        } else if (
+            pending &&
+            steady_clock::now() - last_change >= context.options.debounce) {
+
+            pending = false;
+
+            // reloading must not hold up stopping
+            lock.unlock();
+            reload_watched(context);
+            lock.lock();
+        }
+    }
+}
+
+#ifdef __linux__
+inline auto watched_dir_of(const std::string &file_path) -> std::string {
+    const auto last_slash_index = file_path.find_last_of('/');
+
+    if (last_slash_index == std::string::npos) {
+        return ".";
+    }
+
+    return last_slash_index == 0 ? "/" : file_path.substr(0, last_slash_index);
+}
+
+inline auto watched_name_of(const std::string &file_path) -> std::string {
+    const auto last_slash_index = file_path.find_last_of('/');
+
+    return last_slash_index == std::string::npos
+               ? file_path
+               : file_path.substr(last_slash_index + 1);
+}
+
+/**
+ * Watches the directories of the files through inotify, since editors often
+ * replace files by renaming, which would end watches on the files themselves.
+ * @return false if inotify is unavailable, otherwise true after stopping.
+ */
+inline auto run_inotify_watch(watch_context &context) -> bool {
+    // std
+    using std::string;
+    using std::unordered_map;
+    using std::vector;
+    using std::chrono::duration_cast;
+    using std::chrono::milliseconds;
+    using std::chrono::steady_clock;
+
+    const auto fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+    if (fd < 0) {
+        return false;
+    }
+
+    static constexpr auto MASK = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM |
+                                 IN_CREATE | IN_DELETE | IN_ATTRIB;
+
+    // watch descriptor to names of watched files within the directory
+    unordered_map<int, vector<string>> watched_names;
+
+    for (const auto &file_path :
+         {context.base_toml_path, context.override_toml_path}) {
+
+        const auto wd =
+            inotify_add_watch(fd, watched_dir_of(file_path).c_str(), MASK);
+
+        if (wd < 0) {
+            close(fd);
+            return false;
+        }
+
+        watched_names[wd].push_back(watched_name_of(file_path));
+    }
+
+    mark_watch_started(context);
+
+    alignas(inotify_event) char buffer[4096];
+
+    auto pending = false;
+    auto last_change = steady_clock::now();
+
+    while (true) {
+        auto timeout = -1;
+
+        if (pending) {
+            const auto elapsed = duration_cast<milliseconds>(
+                steady_clock::now() - last_change);
+
+            timeout = elapsed >= context.options.debounce
+                          ? 0
+                          : static_cast<int>(
+                                (context.options.debounce - elapsed).count());
+        }
+
+        pollfd fds[2] = {{fd, POLLIN, 0}, {context.stop_pipe[0], POLLIN, 0}};
+        const auto ready = poll(fds, 2, timeout);
+
+        if (ready < 0) {
+            continue;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            ssize_t length;
+
+            while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+                for (auto ptr = buffer; ptr < buffer + length;) {
+                    const auto event =
+                        reinterpret_cast<const inotify_event *>(ptr);
+
+                    const auto names_itr = watched_names.find(event->wd);
+
+                    if (event->len > 0 && names_itr != watched_names.cend()) {
+                        const string name(event->name);
+
+                        for (const auto &watched_name : names_itr->second) {
+                            if (name == watched_name) {
+                                pending = true;
+                                last_change = steady_clock::now();
+                            }
+                        }
+                    }
+
+                    ptr += sizeof(inotify_event) + event->len;
+                }
+            }
+        }
+
+        if (pending &&
+            steady_clock::now() - last_change >= context.options.debounce) {
+            pending = false;
+            reload_watched(context);
+        }
+    }
+
+    close(fd);
+    return true;
+}
+#endif
+
+inline void run_watch(watch_context &context) noexcept {
+    try {
+#ifdef __linux__
+        if (run_inotify_watch(context)) {
+            return;
+        }
+#endif
+
+        run_polling_watch(context);
+    } catch (...) {
+        // nothing sensible can be done on the watcher thread
+    }
+
+    // never leave the constructor waiting
+    mark_watch_started(context);
+}
+} // namespace details
+
+inline watcher::watcher(
+    const std::string &base_toml_path,
+    const std::string &override_toml_path,
+    watch_options options)
+    : context(new details::watch_context()) {
+
+    // std
+    using std::exception;
+    using std::move;
+    using std::thread;
+
+    context->base_toml_path = base_toml_path;
+    context->override_toml_path = override_toml_path;
+    context->options = move(options);
+
+#ifdef __linux__
+    if (pipe2(context->stop_pipe, O_CLOEXEC) != 0) {
+        throw setup_error("Unable to create pipe for stopping watcher");
+    }
+#endif
+
+    try {
+        const auto raw_context = context.get();
+        context->thread = thread([raw_context] {
+            details::run_watch(*raw_context);
+        });
+    } catch (const exception &e) {
+#ifdef __linux__
+        close(context->stop_pipe[0]);
+        close(context->stop_pipe[1]);
+#endif
+        throw setup_error(
+            fmt::format("Unable to start watcher thread: {}", e.what()));
+    }
+
+    // changes made after returning are guaranteed to be seen
+    std::unique_lock<std::mutex> lock(context->mutex);
+    context->started_cv.wait(lock, [this] { return context->started; });
+}
+
+inline watcher::watcher(watcher &&other) noexcept
+    : context(std::move(other.context)) {}
+
+inline auto watcher::operator=(watcher &&other) noexcept -> watcher & {
+    if (this != &other) {
+        stop();
+        context = std::move(other.context);
+    }
+
+    return *this;
+}
+
+inline watcher::~watcher() { stop(); }
+
+inline void watcher::stop() noexcept {
+    if (!context) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(context->mutex);
+        context->stopping = true;
+    }
+
+    context->stop_cv.notify_all();
+
+#ifdef __linux__
+    const char wake = 0;
+    const auto written = write(context->stop_pipe[1], &wake, 1);
+    static_cast<void>(written);
+#endif
+
+    if (context->thread.joinable()) {
+        context->thread.join();
+    }
+
+#ifdef __linux__
+    close(context->stop_pipe[0]);
+    close(context->stop_pipe[1]);
+#endif
+
+    context.reset();
+}
+} // namespace spdlog_setup
@@ -0,0 +1,48 @@
+/**
+ * Build time generator behind spdlog_setup_embed, which turns a TOML
+ * configuration file into a C++ header with the configuration embedded.
+ * @author Chen Weiguang
+ * @version 0.3.3-pre
+ */
+
+#include "spdlog_setup/conf.h"
+
+#include <exception>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+int main(int argc, char *argv[]) {
+    // std
+    using std::cerr;
+    using std::exception;
+    using std::ostringstream;
+    using std::string;
+
+    if (argc != 4) {
+        cerr << "Usage: " << argv[0]
+             << " <config.toml> <output header> <namespace>\n";
+        return 2;
+    }
+
+    const string toml_path = argv[1];
+    const string header_path = argv[2];
+    const string ns_name = argv[3];
+
+    try {
+        const auto config = spdlog_setup::details::parse_toml_file(toml_path);
+        spdlog_setup::details::validate_config(*config);
+
+        ostringstream ostr;
+
+        spdlog_setup::details::write_embedded_header(
+            ostr, *config, ns_name, toml_path);
+
+        spdlog_setup::details::write_file_atomically(header_path, ostr.str());
+    } catch (const exception &e) {
+        cerr << toml_path << ": " << e.what() << "\n";
+        return 1;
+    }
+
+    return 0;
+}
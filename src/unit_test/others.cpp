@@ -17,18 +17,28 @@
 
 #include "spdlog_setup/conf.h"
 
+#include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <fstream>
 #include <iostream>
 #include <iterator>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <typeinfo>
 #include <unordered_map>
+#include <vector>
 
 using namespace examples;
 
 // spdlog_setup
 using fmt::arg;
 using spdlog::level::level_enum;
+using spdlog_setup::compiled_template;
 using spdlog_setup::setup_error;
+using spdlog_setup::details::embedded_kind;
+using spdlog_setup::details::embedded_node;
 using spdlog_setup::details::render;
 
 namespace names = spdlog_setup::details::names;
@@ -106,178 +116,2149 @@ TEST_CASE("Parse max size error", "[parse_max_size_error]") {
         spdlog_setup::details::parse_max_size(" 1x2x3K"), setup_error);
 }
 
+TEST_CASE("Parse duration", "[parse_duration]") {
+    using spdlog_setup::details::parse_duration;
+
+    REQUIRE(parse_duration("250us") == std::chrono::microseconds(250));
+    REQUIRE(parse_duration(" 250ms ") == std::chrono::milliseconds(250));
+    REQUIRE(parse_duration("5s") == std::chrono::seconds(5));
+    REQUIRE(parse_duration("2min") == std::chrono::minutes(2));
+    REQUIRE(parse_duration("1h") == std::chrono::hours(1));
+    REQUIRE_THROWS_AS(parse_duration("5"), setup_error);
+    REQUIRE_THROWS_AS(parse_duration("-5s"), setup_error);
+}
+
 TEST_CASE("Parse TOML file for set-up", "[from_file]") {
     spdlog::drop_all();
 
     const auto tmp_file = get_full_conf_tmp_file();
     spdlog_setup::from_file(tmp_file.get_file_path());
 
-    const auto root_logger = spdlog::get("root");
-    REQUIRE(root_logger != nullptr);
+    const auto root_logger = spdlog::get("root");
+    REQUIRE(root_logger != nullptr);
+
+    root_logger->trace("Test Message - Trace!");
+    root_logger->debug("Test Message - Debug!");
+    root_logger->info("Test Message - Info!");
+    root_logger->warn("Test Message - Warn!");
+    root_logger->error("Test Message - Error!");
+    root_logger->critical("Test Message - Critical!");
+
+    const auto console_logger = spdlog::get("console");
+    REQUIRE(console_logger != nullptr);
+
+    console_logger->info("Console Message - Info!");
+    console_logger->error("Console Message - Error!");
+}
+
+TEST_CASE(
+    "Parse pre-TOML file for set-up", "[from_file_with_tag_replacement]") {
+    spdlog::drop_all();
+
+    const auto index_arg = arg("index", 123);
+    const auto path_arg = arg("path", "spdlog_setup");
+    const auto tmp_file = get_pre_conf_tmp_file();
+
+    spdlog_setup::from_file_with_tag_replacement(
+        tmp_file.get_file_path(), index_arg, path_arg);
+
+    const auto root_logger = spdlog::get("root");
+    REQUIRE(root_logger != nullptr);
+
+    root_logger->trace("Test Message - Trace!");
+    root_logger->debug("Test Message - Debug!");
+    root_logger->info("Test Message - Info!");
+    root_logger->warn("Test Message - Warn!");
+    root_logger->error("Test Message - Error!");
+    root_logger->critical("Test Message - Critical!");
+}
+
+TEST_CASE(
+    "Parse TOML file with override for set-up", "[from_file_with_override]") {
+    spdlog::drop_all();
+
+    const auto full_conf_tmp_file = get_full_conf_tmp_file();
+    const auto override_conf_tmp_file = get_override_conf_tmp_file();
+
+    const auto use_override = spdlog_setup::from_file_and_override(
+        full_conf_tmp_file.get_file_path(),
+        override_conf_tmp_file.get_file_path());
+
+    REQUIRE(use_override);
+
+    const auto console_logger = spdlog::get("console");
+    REQUIRE(console_logger != nullptr);
+
+    console_logger->trace("Console Message - Trace!");
+    console_logger->debug("Console Message - Debug!");
+    console_logger->info("Console Message - Info!");
+    console_logger->warn("Console Message - Warn!");
+    console_logger->error("Console Message - Error!");
+    console_logger->critical("Console Message - Critical!");
+}
+
+TEST_CASE(
+    "Parse TOML file with empty override for set-up",
+    "[from_file_with_override_empty]") {
+
+    spdlog::drop_all();
+
+    const auto full_conf_tmp_file = get_full_conf_tmp_file();
+
+    const auto use_override = spdlog_setup::from_file_and_override(
+        full_conf_tmp_file.get_file_path(), "no_such_file");
+
+    REQUIRE(!use_override);
+
+    const auto console_logger = spdlog::get("console");
+    REQUIRE(console_logger != nullptr);
+
+    console_logger->trace("Console Message - Trace!");
+    console_logger->debug("Console Message - Debug!");
+    console_logger->info("Console Message - Info!");
+    console_logger->warn("Console Message - Warn!");
+    console_logger->error("Console Message - Error!");
+    console_logger->critical("Console Message - Critical!");
+}
+
+TEST_CASE(
+    "Parse pre-TOML file with override for set-up",
+    "[from_file_with_override_with_tag_replacement]") {
+    spdlog::drop_all();
+
+    const auto index_arg = arg("index", 123);
+    const auto path_arg = arg("path", "spdlog_setup");
+    const auto hash_arg = arg("hash", "qwerty");
+
+    const auto pre_conf_tmp_file = get_pre_conf_tmp_file();
+    const auto override_pre_conf_tmp_file = get_override_pre_conf_tmp_file();
+
+    const auto use_override =
+        spdlog_setup::from_file_and_override_with_tag_replacement(
+            pre_conf_tmp_file.get_file_path(),
+            override_pre_conf_tmp_file.get_file_path(),
+            index_arg,
+            path_arg,
+            hash_arg);
+
+    REQUIRE(use_override);
+
+    const auto root_logger = spdlog::get("root");
+    REQUIRE(root_logger != nullptr);
+
+    root_logger->trace("Test Message - Trace!");
+    root_logger->debug("Test Message - Debug!");
+    root_logger->info("Test Message - Info!");
+    root_logger->warn("Test Message - Warn!");
+    root_logger->error("Test Message - Error!");
+    root_logger->critical("Test Message - Critical!");
+}
+
+TEST_CASE(
+    "Parse pre-TOML file with missing override for set-up",
+    "[from_file_with_missing_override_with_tag_replacement]") {
+    spdlog::drop_all();
+
+    const auto index_arg = arg("index", 123);
+    const auto path_arg = arg("path", "spdlog_setup");
+
+    const auto pre_conf_tmp_file = get_pre_conf_tmp_file();
+
+    const auto use_override =
+        spdlog_setup::from_file_and_override_with_tag_replacement(
+            pre_conf_tmp_file.get_file_path(),
+            "no_such_file",
+            index_arg,
+            path_arg);
+
+    REQUIRE(!use_override);
+
+    const auto root_logger = spdlog::get("root");
+    REQUIRE(root_logger != nullptr);
+
+    root_logger->trace("Test Message - Trace!");
+    root_logger->debug("Test Message - Debug!");
+    root_logger->info("Test Message - Info!");
+    root_logger->warn("Test Message - Warn!");
+    root_logger->error("Test Message - Error!");
+    root_logger->critical("Test Message - Critical!");
+}
+
+TEST_CASE("Parse TOML file that does not exist", "[from_file_no_such_file]") {
+    spdlog::drop_all();
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file("config/no_such_file"), setup_error);
+}
+
+TEST_CASE(
+    "Parse pre-TOML file that does not exist",
+    "[from_file_with_tag_replacement_no_such_file]") {
+
+    spdlog::drop_all();
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file_with_tag_replacement("config/no_such_file"),
+        setup_error);
+}
+
+TEST_CASE("Merge multiple override layers", "[merge_config_layers]") {
+    const auto base_tmp_file = get_simple_console_logger_conf_tmp_file();
+
+    const auto layer_1_tmp_file = examples::tmp_file(R"x(
+        [[sink]]
+        name = "null"
+        type = "null_sink_st"
+
+        [[logger]]
+        name = "console"
+        level = "warn"
+
+        [[logger]]
+        name = "extra"
+        level = "debug"
+    )x");
+
+    const auto layer_2_tmp_file = examples::tmp_file(R"x(
+        [[logger]]
+        name = "extra"
+        level = "err"
+
+        [[logger]]
+        name = "not-console"
+        level = "off"
+    )x");
+
+    const auto base = cpptoml::parse_file(base_tmp_file.get_file_path());
+    const auto layer_1 = cpptoml::parse_file(layer_1_tmp_file.get_file_path());
+    const auto layer_2 = cpptoml::parse_file(layer_2_tmp_file.get_file_path());
+
+    spdlog_setup::details::merge_config_layers(base, {layer_1, layer_2});
+
+    const auto loggers = base->get_table_array(LOGGER_TABLE);
+    REQUIRE(dist(*loggers) == 3);
+
+    const auto level_of = [&loggers](const string &name) {
+        return *spdlog_setup::details::find_item_by_name(*loggers, name)
+                    ->get_as<string>(LEVEL);
+    };
+
+    REQUIRE(level_of("not-console") == "off");
+    REQUIRE(level_of("console") == "warn");
+    REQUIRE(level_of("extra") == "err");
+
+    // table array missing in base is taken under its own name
+    const auto sinks = base->get_table_array(names::SINK_TABLE);
+    REQUIRE(sinks != nullptr);
+    REQUIRE(dist(*sinks) == 1);
+    REQUIRE(dist(*base->get_table_array(PATTERN_TABLE)) == 1);
+}
+
+TEST_CASE(
+    "Parse TOML file with multiple overrides for set-up",
+    "[from_file_and_overrides]") {
+    spdlog::drop_all();
+
+    const auto full_conf_tmp_file = get_full_conf_tmp_file();
+    const auto override_conf_tmp_file = get_override_conf_tmp_file();
+
+    const auto level_override_tmp_file = examples::tmp_file(R"x(
+        [[logger]]
+        name = "console"
+        level = "critical"
+    )x");
+
+    const auto used_overrides = spdlog_setup::from_file_and_overrides(
+        full_conf_tmp_file.get_file_path(),
+        {override_conf_tmp_file.get_file_path(),
+         "no_such_file",
+         level_override_tmp_file.get_file_path()});
+
+    REQUIRE(used_overrides == 2);
+
+    const auto console_logger = spdlog::get("console");
+    REQUIRE(console_logger != nullptr);
+    REQUIRE(console_logger->level() == level_enum::critical);
+    REQUIRE(console_logger->sinks().size() == 3);
+}
+
+TEST_CASE("Parse TOML from mapped file", "[parse_toml_file]") {
+    const auto tmp_file = get_simple_console_logger_conf_tmp_file();
+
+    const auto config =
+        spdlog_setup::details::parse_toml_file(tmp_file.get_file_path());
+
+    REQUIRE(config != nullptr);
+    REQUIRE(dist(*config->get_table_array(LOGGER_TABLE)) == 2);
+    REQUIRE(dist(*config->get_table_array(PATTERN_TABLE)) == 1);
+
+    const auto empty_tmp_file = examples::tmp_file();
+
+    const auto empty_config =
+        spdlog_setup::details::parse_toml_file(empty_tmp_file.get_file_path());
+
+    REQUIRE(empty_config != nullptr);
+    REQUIRE(dist(*empty_config) == 0);
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::parse_toml_file("config/no_such_file"),
+        setup_error);
+}
+
+TEST_CASE("Parse TOML file with snapshot for set-up", "[from_file_snapshot]") {
+    spdlog::drop_all();
+
+    const auto tmp_file = get_full_conf_tmp_file();
+    const auto &tmp_file_path = tmp_file.get_file_path();
+    const auto snapshot_path =
+        spdlog_setup::details::snapshot_path_for(tmp_file_path);
+
+    // first load parses the TOML file and writes the snapshot
+    spdlog_setup::from_file_with_snapshot(tmp_file_path);
+    REQUIRE(spdlog_setup::details::file_exists(snapshot_path));
+
+    const auto config = spdlog_setup::details::load_snapshot(
+        snapshot_path, std::vector<string>{tmp_file_path});
+
+    REQUIRE(config != nullptr);
+    REQUIRE(config->get_table_array(LOGGER_TABLE) != nullptr);
+
+    // second load sets up from the snapshot
+    spdlog::drop_all();
+    spdlog_setup::from_file_with_snapshot(tmp_file_path);
+
+    const auto root_logger = spdlog::get("root");
+    REQUIRE(root_logger != nullptr);
+    REQUIRE(root_logger->level() == level_enum::trace);
+
+    std::remove(snapshot_path.c_str());
+}
+
+TEST_CASE("Write file atomically", "[write_file_atomically]") {
+    const auto tmp_file = examples::tmp_file("old");
+    const auto &tmp_file_path = tmp_file.get_file_path();
+
+    const auto read_file = [](const string &path) {
+        ifstream istr(path, std::ios::binary);
+        return string(std::istreambuf_iterator<char>(istr), {});
+    };
+
+    // concurrent writers never share a temporary file, so every reader sees
+    // one of the complete contents
+    std::vector<std::thread> writers;
+
+    for (auto i = 0; i < 4; ++i) {
+        writers.emplace_back([i, &tmp_file_path] {
+            const auto content = string(4096, static_cast<char>('a' + i));
+
+            for (auto j = 0; j < 50; ++j) {
+                spdlog_setup::details::write_file_atomically(
+                    tmp_file_path, content);
+            }
+        });
+    }
+
+    for (auto i = 0; i < 100; ++i) {
+        const auto content = read_file(tmp_file_path);
+        REQUIRE((content == "old" || content.size() == 4096));
+    }
+
+    for (auto &writer : writers) {
+        writer.join();
+    }
+
+    const auto content = read_file(tmp_file_path);
+    REQUIRE(content.size() == 4096);
+    REQUIRE(content == string(4096, content.front()));
+}
+
+TEST_CASE("Reject stale snapshot", "[stale_snapshot]") {
+    const auto tmp_file = get_simple_console_logger_conf_tmp_file();
+    const auto &tmp_file_path = tmp_file.get_file_path();
+    const auto sources = std::vector<string>{tmp_file_path};
+
+    std::vector<spdlog_setup::details::snapshot_source> parsed_sources(1);
+
+    const auto parsed_config = spdlog_setup::details::parse_snapshot_source(
+        tmp_file_path, parsed_sources[0]);
+
+    // the snapshot is keyed with the bytes that were parsed
+    REQUIRE(parsed_sources[0].stat.exists);
+    REQUIRE(
+        parsed_sources[0].stat.size ==
+        spdlog_setup::details::stat_file(tmp_file_path).size);
+
+    const auto snapshot = spdlog_setup::details::serialize_snapshot(
+        *parsed_config, parsed_sources);
+
+    const auto config = spdlog_setup::details::deserialize_snapshot(
+        snapshot.data(), snapshot.size(), sources);
+
+    REQUIRE(config != nullptr);
+    REQUIRE(dist(*config->get_table_array(LOGGER_TABLE)) == 2);
+
+    // truncated content is never trusted
+    REQUIRE(
+        spdlog_setup::details::deserialize_snapshot(
+            snapshot.data(), snapshot.size() - 1, sources) == nullptr);
+
+    // changed source content invalidates the snapshot
+    {
+        std::ofstream ostr(tmp_file_path, std::ios::app);
+        ostr << "global_pattern = \"%v\"\n";
+    }
+
+    REQUIRE(
+        spdlog_setup::details::deserialize_snapshot(
+            snapshot.data(), snapshot.size(), sources) == nullptr);
+}
+
+TEST_CASE("Parse embedded configuration for set-up", "[from_embedded]") {
+    spdlog::drop_all();
+
+    static constexpr embedded_node NODES[] = {
+        {embedded_kind::Table, nullptr, 2, nullptr, 0, 0, 0.0, false},
+        {embedded_kind::TableArray, "logger", 1, nullptr, 0, 0, 0.0, false},
+        {embedded_kind::Table, nullptr, 3, nullptr, 0, 0, 0.0, false},
+        {embedded_kind::String, "level", 0, "warn", 4, 0, 0.0, false},
+        {embedded_kind::String, "name", 0, "embedded", 8, 0, 0.0, false},
+        {embedded_kind::Array, "sinks", 1, nullptr, 0, 0, 0.0, false},
+        {embedded_kind::String, nullptr, 0, "null", 4, 0, 0.0, false},
+        {embedded_kind::TableArray, "sink", 1, nullptr, 0, 0, 0.0, false},
+        {embedded_kind::Table, nullptr, 2, nullptr, 0, 0, 0.0, false},
+        {embedded_kind::String, "name", 0, "null", 4, 0, 0.0, false},
+        {embedded_kind::String, "type", 0, "null_sink_st", 12, 0, 0.0, false},
+    };
+
+    static constexpr auto NODE_COUNT = sizeof(NODES) / sizeof(NODES[0]);
+
+    spdlog_setup::from_embedded(NODES, NODE_COUNT);
+
+    const auto logger = spdlog::get("embedded");
+    REQUIRE(logger != nullptr);
+    REQUIRE(logger->level() == level_enum::warn);
+    REQUIRE(logger->sinks().size() == 1);
+
+    // overrides are still merged on top of the embedded configuration
+    spdlog::drop_all();
+
+    const auto override_tmp_file = examples::tmp_file(R"x(
+        [[logger]]
+        name = "embedded"
+        level = "err"
+    )x");
+
+    REQUIRE(spdlog_setup::from_embedded_and_override(
+        NODES, NODE_COUNT, override_tmp_file.get_file_path()));
+
+    REQUIRE(spdlog::get("embedded")->level() == level_enum::err);
+
+    spdlog::drop_all();
+
+    REQUIRE_FALSE(spdlog_setup::from_embedded_and_override(
+        NODES, NODE_COUNT, "no_such_file"));
+
+    REQUIRE(spdlog::get("embedded")->level() == level_enum::warn);
+
+    // truncated nodes are rejected
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::table_from_embedded(NODES, NODE_COUNT - 1),
+        setup_error);
+}
+
+TEST_CASE("Write embedded configuration", "[write_embedded_header]") {
+    const auto tmp_file = examples::tmp_file(R"x(
+        ratio = 0.5
+        lowest = -9223372036854775808
+
+        [[sink]]
+        name = "null"
+        type = "null_sink_st"
+        level = "info"
+
+        [[logger]]
+        name = "quote\"d?\t"
+        sinks = ["null"]
+    )x");
+
+    const auto config = cpptoml::parse_file(tmp_file.get_file_path());
+    spdlog_setup::details::validate_config(*config);
+
+    std::ostringstream ostr;
+
+    spdlog_setup::details::write_embedded_header(
+        ostr, *config, "app_conf", "log_conf.toml");
+
+    const auto header = ostr.str();
+
+    REQUIRE(header.find("namespace app_conf {") != string::npos);
+    REQUIRE(header.find("inline void setup_embedded()") != string::npos);
+    REQUIRE(header.find(R"x("quote\"d\?\011", 9)x") != string::npos);
+    REQUIRE(header.find("(-9223372036854775807LL - 1)") != string::npos);
+    REQUIRE(header.find(", 0.5, false}") != string::npos);
+
+    // keys are written in sorted order
+    REQUIRE(header.find(R"x("logger")x") < header.find(R"x("lowest")x"));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::write_embedded_header(
+            ostr, *config, "1_conf", "log_conf.toml"),
+        setup_error);
+}
+
+TEST_CASE("Validate configuration", "[validate_config]") {
+    const auto validate = [](const string &content) {
+        const auto tmp_file = examples::tmp_file(content);
+        const auto config = cpptoml::parse_file(tmp_file.get_file_path());
+        spdlog_setup::details::validate_config(*config);
+    };
+
+    REQUIRE_THROWS_AS(
+        validate(R"x(
+            [[sink]]
+            name = "null"
+            type = "no_such_sink"
+
+            [[logger]]
+            name = "console"
+            sinks = ["null"]
+        )x"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        validate(R"x(
+            [[logger]]
+            name = "console"
+            sinks = ["no_such_sink"]
+        )x"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        validate(R"x(
+            [[sink]]
+            name = "null"
+            type = "null_sink_st"
+
+            [[logger]]
+            name = "console"
+            sinks = ["null"]
+            level = "loud"
+        )x"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        validate(R"x(
+            [[sink]]
+            name = "null"
+            type = "null_sink_st"
+
+            [[logger]]
+            name = "console"
+            sinks = ["null"]
+            pattern = "no_such_pattern"
+        )x"),
+        setup_error);
+}
+
+TEST_CASE("Compare configuration nodes", "[config_nodes_equal]") {
+    const auto lhs_tmp_file = examples::tmp_file(R"x(
+        ratio = 0.5
+        names = ["a", "b"]
+
+        [[sink]]
+        name = "null"
+        type = "null_sink_st"
+        level = "info"
+    )x");
+
+    const auto rhs_tmp_file = examples::tmp_file(R"x(
+        names = ["a", "b"]
+        ratio = 0.5
+
+        [[sink]]
+        level = "warn"
+        type = "null_sink_st"
+        name = "null"
+    )x");
+
+    const auto lhs = cpptoml::parse_file(lhs_tmp_file.get_file_path());
+    const auto rhs = cpptoml::parse_file(rhs_tmp_file.get_file_path());
+
+    REQUIRE_FALSE(spdlog_setup::details::config_nodes_equal(lhs, rhs));
+    REQUIRE(spdlog_setup::details::config_nodes_equal(lhs, lhs));
+
+    REQUIRE(spdlog_setup::details::config_tables_equal_except(
+        *lhs->get_table_array("sink")->get().front(),
+        *rhs->get_table_array("sink")->get().front(),
+        {LEVEL}));
+
+    REQUIRE_FALSE(spdlog_setup::details::config_tables_equal_except(
+        *lhs, *rhs->get_table_array("sink")->get().front(), {}));
+}
+
+TEST_CASE("Reconfigure from file", "[reconfigure_from_file]") {
+    spdlog::drop_all();
+
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/reconfigure/spdlog_setup.log"
+        create_parent_dir = true
+
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [[thread_pool]]
+        name = "tp"
+        queue_size = 128
+        num_threads = 1
+
+        [[logger]]
+        name = "sync"
+        sinks = ["file"]
+        level = "info"
+
+        [[logger]]
+        name = "async"
+        type = "async"
+        thread_pool = "tp"
+        sinks = ["null"]
+
+        [[logger]]
+        name = "removed"
+        sinks = ["null"]
+    )x");
+
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    const auto sync_logger = spdlog::get("sync");
+    const auto async_logger = spdlog::get("async");
+    REQUIRE(sync_logger != nullptr);
+    REQUIRE(async_logger != nullptr);
+    REQUIRE(spdlog::get("removed") != nullptr);
+
+    const auto file_sink = sync_logger->sinks().front();
+
+    // only levels and patterns change, so everything is kept
+    const auto level_tmp_file = examples::tmp_file(R"x(
+        [[pattern]]
+        name = "short"
+        value = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/reconfigure/spdlog_setup.log"
+        create_parent_dir = true
+        level = "warn"
+
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [[thread_pool]]
+        name = "tp"
+        queue_size = 128
+        num_threads = 1
+
+        [[logger]]
+        name = "sync"
+        sinks = ["file"]
+        level = "debug"
+        flush_level = "err"
+        pattern = "short"
+
+        [[logger]]
+        name = "async"
+        type = "async"
+        thread_pool = "tp"
+        sinks = ["null"]
+
+        [[logger]]
+        name = "added"
+        sinks = ["null"]
+    )x");
+
+    spdlog_setup::reconfigure_from_file(level_tmp_file.get_file_path());
+
+    REQUIRE(spdlog::get("sync") == sync_logger);
+    REQUIRE(spdlog::get("async") == async_logger);
+    REQUIRE(spdlog::get("removed") == nullptr);
+    REQUIRE(spdlog::get("added") != nullptr);
+
+    REQUIRE(sync_logger->sinks().front() == file_sink);
+    REQUIRE(sync_logger->level() == level_enum::debug);
+    REQUIRE(sync_logger->flush_level() == level_enum::err);
+    REQUIRE(file_sink->level() == level_enum::warn);
+
+    // the kept async logger still has its thread pool
+    REQUIRE_NOTHROW(async_logger->info("still alive"));
+
+    // invalid configuration leaves the applied configuration in place
+    const auto invalid_tmp_file = examples::tmp_file(R"x(
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [[logger]]
+        name = "sync"
+        sinks = ["null"]
+        level = "loud"
+    )x");
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::reconfigure_from_file(invalid_tmp_file.get_file_path()),
+        setup_error);
+
+    REQUIRE(spdlog::get("sync") == sync_logger);
+    REQUIRE(spdlog::get("added") != nullptr);
+    REQUIRE(sync_logger->level() == level_enum::debug);
+
+    // changing the sink definition rebuilds the sink and its loggers
+    const auto rebuilt_tmp_file = examples::tmp_file(R"x(
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/reconfigure/spdlog_setup_other.log"
+        create_parent_dir = true
+
+        [[logger]]
+        name = "sync"
+        sinks = ["file"]
+    )x");
+
+    spdlog_setup::reconfigure_from_file(rebuilt_tmp_file.get_file_path());
+
+    const auto rebuilt_logger = spdlog::get("sync");
+    REQUIRE(rebuilt_logger != nullptr);
+    REQUIRE(rebuilt_logger != sync_logger);
+    REQUIRE(rebuilt_logger->sinks().front() != file_sink);
+    REQUIRE(rebuilt_logger->level() == level_enum::info);
+    REQUIRE(spdlog::get("async") == nullptr);
+    REQUIRE(spdlog::get("added") == nullptr);
+}
+
+TEST_CASE(
+    "Keep patterns when reconfigure fails", "[reconfigure_failed_pattern]") {
+
+    spdlog::drop_all();
+
+    static constexpr auto LOG_PATH = "log/reconfigure_pattern/spdlog_setup.log";
+
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        global_pattern = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/reconfigure_pattern/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[logger]]
+        name = "kept"
+        sinks = ["file"]
+    )x");
+
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    const auto logger = spdlog::get("kept");
+    REQUIRE(logger != nullptr);
+
+    // the first new logger would set its pattern onto the kept sink, before
+    // the second one fails to build
+    const auto failing_tmp_file = examples::tmp_file(R"x(
+        global_pattern = "%v"
+
+        [[pattern]]
+        name = "tagged"
+        value = "tagged %v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/reconfigure_pattern/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[logger]]
+        name = "kept"
+        sinks = ["file"]
+
+        [[logger]]
+        name = "first"
+        sinks = ["file"]
+        pattern = "tagged"
+
+        [[logger]]
+        name = "failing"
+        type = "async"
+        thread_pool = "no_such_pool"
+        sinks = ["file"]
+    )x");
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::reconfigure_from_file(failing_tmp_file.get_file_path()),
+        setup_error);
+
+    REQUIRE(spdlog::get("kept") == logger);
+    REQUIRE(spdlog::get("first") == nullptr);
+
+    logger->info("untagged");
+    logger->flush();
+
+    ifstream log_file(LOG_PATH);
+    string last_line;
+
+    for (string line; std::getline(log_file, line);) {
+        last_line = line;
+    }
+
+    REQUIRE(last_line == "untagged");
+}
+
+TEST_CASE(
+    "Reconfigure file sink parameters", "[reconfigure_file_sink_params]") {
+
+    spdlog::drop_all();
+
+    static constexpr auto ROTATED_PATH =
+        "log/reconfigure_params/spdlog_setup.1.log";
+
+    std::remove(ROTATED_PATH);
+
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        [[sink]]
+        name = "rotating"
+        type = "rotating_file_sink_mt"
+        base_filename = "log/reconfigure_params/spdlog_setup.log"
+        max_size = "1M"
+        max_files = 1
+        create_parent_dir = true
+
+        [[logger]]
+        name = "rotating"
+        sinks = ["rotating"]
+    )x");
+
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    const auto logger = spdlog::get("rotating");
+    REQUIRE(logger != nullptr);
+
+    auto sink = logger->sinks().front();
+
+    static constexpr auto SMALL_CONF = R"x(
+        [[sink]]
+        name = "rotating"
+        type = "rotating_file_sink_mt"
+        base_filename = "log/reconfigure_params/spdlog_setup.log"
+        max_size = "100"
+        max_files = 1
+        create_parent_dir = true
+
+        [[logger]]
+        name = "rotating"
+        sinks = ["rotating"]
+    )x";
+
+    const auto small_tmp_file = examples::tmp_file(SMALL_CONF);
+
+    // a second sink with other parameters must not open the file in use
+    REQUIRE_THROWS_AS(
+        spdlog_setup::reconfigure_from_file(small_tmp_file.get_file_path()),
+        setup_error);
+
+    REQUIRE(spdlog::get("rotating") == logger);
+    REQUIRE(logger->sinks().front() == sink);
+
+    // the new parameters apply once the file is no longer in use
+    spdlog::drop_all();
+    logger->sinks().clear();
+    sink.reset();
+
+    spdlog_setup::from_file(small_tmp_file.get_file_path());
+
+    const auto small_logger = spdlog::get("rotating");
+    REQUIRE(small_logger != nullptr);
+
+    for (auto i = 0; i < 20; ++i) {
+        small_logger->info("line {}", i);
+    }
+
+    small_logger->flush();
+    REQUIRE(ifstream(ROTATED_PATH).good());
+}
+
+TEST_CASE("Reject sinks sharing a file", "[shared_file_sink_conflict]") {
+    spdlog::drop_all();
+
+    static constexpr auto CONF = R"x(
+        {}
+
+        [[sink]]
+        name = "info_file"
+        type = "basic_file_sink_mt"
+        filename = "log/shared_conflict/spdlog_setup.log"
+        create_parent_dir = true
+        level = "info"
+
+        [[sink]]
+        name = "err_file"
+        type = "basic_file_sink_mt"
+        filename = "log/shared_conflict/../shared_conflict/spdlog_setup.log"
+        create_parent_dir = true
+        level = "{}"
+
+        [[logger]]
+        name = "shared_conflict"
+        sinks = ["info_file", "err_file"]
+    )x";
+
+    const auto conflict_tmp_file =
+        examples::tmp_file(fmt::format(CONF, "", "err"));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(conflict_tmp_file.get_file_path()),
+        setup_error);
+
+    // nothing is built yet in lazy mode, but the conflict is still found
+    const auto lazy_tmp_file =
+        examples::tmp_file(fmt::format(CONF, "lazy_loggers = true", "err"));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(lazy_tmp_file.get_file_path()), setup_error);
+
+    REQUIRE(spdlog::get("shared_conflict") == nullptr);
+
+    // equal definitions share one sink
+    const auto same_tmp_file =
+        examples::tmp_file(fmt::format(CONF, "", "info"));
+    spdlog_setup::from_file(same_tmp_file.get_file_path());
+
+    const auto logger = spdlog::get("shared_conflict");
+    REQUIRE(logger != nullptr);
+    REQUIRE(logger->sinks().size() == 2);
+    REQUIRE(logger->sinks().front() == logger->sinks().back());
+}
+
+TEST_CASE(
+    "Reject shared single-threaded file sinks",
+    "[shared_file_sink_st_conflict]") {
+    spdlog::drop_all();
+
+    static constexpr auto TWO_LOGGERS_CONF = R"x(
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_st"
+        filename = "log/shared_st_conflict/spdlog_setup.log"
+        create_parent_dir = true
+
+        [[logger]]
+        name = "first"
+        sinks = ["file"]
+
+        [[logger]]
+        name = "second"
+        sinks = ["file"]
+    )x";
+
+    const auto two_loggers_tmp_file = examples::tmp_file(TWO_LOGGERS_CONF);
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(two_loggers_tmp_file.get_file_path()),
+        setup_error);
+
+    static constexpr auto TWO_SINKS_CONF = R"x(
+        [[sink]]
+        name = "first_file"
+        type = "basic_file_sink_st"
+        filename = "log/shared_st_conflict/spdlog_setup.log"
+        create_parent_dir = true
+
+        [[sink]]
+        name = "second_file"
+        type = "basic_file_sink_st"
+        filename = "log/shared_st_conflict/spdlog_setup.log"
+        create_parent_dir = true
+
+        [[logger]]
+        name = "first"
+        sinks = ["first_file"]
+
+        [[logger]]
+        name = "second"
+        sinks = ["second_file"]
+    )x";
+
+    const auto two_sinks_tmp_file = examples::tmp_file(TWO_SINKS_CONF);
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(two_sinks_tmp_file.get_file_path()),
+        setup_error);
+
+    REQUIRE(spdlog::get("first") == nullptr);
+    REQUIRE(spdlog::get("second") == nullptr);
+}
+
+TEST_CASE("Lazy logger instantiation", "[lazy_loggers]") {
+    spdlog::drop_all();
+
+    static constexpr auto CONF = R"x(
+        lazy_loggers = true
+
+        [global_thread_pool]
+        queue_size = 128
+        num_threads = 1
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/lazy/spdlog_setup.log"
+        create_parent_dir = true
+
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [[logger]]
+        name = "first"
+        sinks = ["file", "null"]
+
+        [[logger]]
+        name = "second"
+        type = "async"
+        sinks = ["null"]
+        level = "{}"
+
+        [[logger]]
+        name = "third"
+        sinks = ["file"]
+    )x";
+
+    const auto log_path = "log/lazy/spdlog_setup.log";
+    std::remove(log_path);
+
+    const auto conf_tmp_file = examples::tmp_file(fmt::format(CONF, "info"));
+
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    // nothing is built until requested
+    REQUIRE(spdlog::get("first") == nullptr);
+    REQUIRE(spdlog::get("second") == nullptr);
+    REQUIRE(!spdlog_setup::details::file_exists(log_path));
+
+    const auto first_logger = spdlog_setup::get("first");
+    REQUIRE(first_logger != nullptr);
+    REQUIRE(spdlog::get("first") == first_logger);
+    REQUIRE(spdlog_setup::get("first") == first_logger);
+    REQUIRE(spdlog_setup::details::file_exists(log_path));
+    REQUIRE(spdlog::get("second") == nullptr);
+
+    // sinks already built are shared with loggers built later
+    const auto third_logger = spdlog_setup::get("third");
+    REQUIRE(third_logger != nullptr);
+    REQUIRE(third_logger->sinks().front() == first_logger->sinks().front());
+
+    const auto second_logger = spdlog_setup::get("second");
+    REQUIRE(second_logger != nullptr);
+    REQUIRE_NOTHROW(second_logger->info("lazily built"));
+
+    REQUIRE(spdlog_setup::get("unknown") == nullptr);
+
+    // reconfiguring only updates the loggers built so far
+    spdlog::drop("third");
+
+    const auto level_tmp_file = examples::tmp_file(fmt::format(CONF, "warn"));
+
+    spdlog_setup::reconfigure_from_file(level_tmp_file.get_file_path());
+
+    REQUIRE(spdlog::get("first") == first_logger);
+    REQUIRE(spdlog::get("second") == second_logger);
+    REQUIRE(second_logger->level() == level_enum::warn);
+    REQUIRE(spdlog::get("third") == nullptr);
+    REQUIRE(spdlog_setup::get("third") != nullptr);
+
+    // errors in loggers never requested are still reported up front
+    const auto invalid_tmp_file = examples::tmp_file(fmt::format(CONF, "loud"));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(invalid_tmp_file.get_file_path()),
+        setup_error);
+
+    spdlog::drop_all();
+}
+
+TEST_CASE("Log through lock-free thread pools", "[lockfree_queue]") {
+    spdlog::drop_all();
+
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        global_pattern = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/lockfree/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [global_thread_pool]
+        queue_size = 64
+        num_threads = 1
+        queue = "lockfree"
+
+        [[thread_pool]]
+        name = "lockfree"
+        queue_size = 16
+        num_threads = 1
+        queue = "lockfree"
+        wait_strategy = "spin_then_block"
+        batch_size = 8
+        max_batch_latency_us = 50
+
+        [[logger]]
+        name = "ordered"
+        type = "async"
+        thread_pool = "lockfree"
+        sinks = ["file"]
+
+        [[logger]]
+        name = "overrun"
+        type = "async"
+        overflow_policy = "overrun_oldest"
+        sinks = ["null"]
+    )x");
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    using spdlog_setup::details::managed_async_logger;
+
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    const auto logger = spdlog::get("ordered");
+    REQUIRE(logger != nullptr);
+    REQUIRE(typeid(*logger) == typeid(const managed_async_logger &));
+
+    const auto overrun_logger = spdlog::get("overrun");
+    REQUIRE(overrun_logger != nullptr);
+    REQUIRE(typeid(*overrun_logger) == typeid(const managed_async_logger &));
+
+    static constexpr auto THREADS_COUNT = 4;
+    static constexpr auto MESSAGES_COUNT = 200;
+
+    std::vector<std::thread> threads;
+
+    // far more messages than the queue holds, so producers have to block
+    for (auto t = 0; t < THREADS_COUNT; ++t) {
+        threads.emplace_back([&logger, &overrun_logger, t] {
+            for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+                logger->info("{} {}", t, i);
+                overrun_logger->info("{} {}", t, i);
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    logger->flush();
+
+    std::vector<string> lines;
+
+    for (auto i = 0; i < 500; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        lines.clear();
+        ifstream log_file("log/lockfree/spdlog_setup.log");
+
+        for (string line; getline(log_file, line);) {
+            lines.push_back(line);
+        }
+
+        if (lines.size() >= THREADS_COUNT * MESSAGES_COUNT) {
+            break;
+        }
+    }
+
+    // blocking never loses messages, and a single worker keeps the order
+    REQUIRE(lines.size() == THREADS_COUNT * MESSAGES_COUNT);
+
+    std::vector<int> next_indices(THREADS_COUNT, 0);
+
+    for (const auto &line : lines) {
+        std::istringstream line_stream(line);
+        int t = 0;
+        int i = 0;
+        line_stream >> t >> i;
+
+        REQUIRE(i == next_indices[t]);
+        ++next_indices[t];
+    }
+
+    spdlog::drop_all();
+#else
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(conf_tmp_file.get_file_path()), setup_error);
+#endif
+
+    // the wait strategy and batches only apply to the lock-free queue
+    for (const auto field :
+         {R"(wait_strategy = "spin_then_block")", "batch_size = 8"}) {
+
+        const auto invalid_tmp_file = examples::tmp_file(fmt::format(
+            R"x(
+                [[sink]]
+                name = "null"
+                type = "null_sink_mt"
+
+                [[thread_pool]]
+                name = "blocking"
+                queue_size = 16
+                num_threads = 1
+                {}
+            )x",
+            field));
+
+        REQUIRE_THROWS_AS(
+            spdlog_setup::from_file(invalid_tmp_file.get_file_path()),
+            setup_error);
+    }
+}
+
+TEST_CASE("Hand off messages to polling workers", "[wait_strategy]") {
+    static constexpr auto CONF = R"x(
+        global_pattern = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/wait_strategy/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [global_thread_pool]
+        queue_size = 16
+        num_threads = 1
+        queue = "lockfree"
+        {wait}
+
+        [[thread_pool]]
+        name = "lockfree"
+        queue_size = 16
+        num_threads = 2
+        queue = "lockfree"
+        {wait}
+
+        [[logger]]
+        name = "global_polled"
+        type = "async"
+        sinks = ["file"]
+        flush_level = "info"
+
+        [[logger]]
+        name = "polled"
+        type = "async"
+        thread_pool = "lockfree"
+        sinks = ["file"]
+        flush_level = "info"
+    )x";
+
+    const auto from_conf = [](const string &wait) {
+        spdlog::drop_all();
+
+        const auto tmp_file =
+            examples::tmp_file(fmt::format(CONF, arg("wait", wait)));
+
+        spdlog_setup::from_file(tmp_file.get_file_path());
+    };
+
+    const auto count_lines = [] {
+        ifstream file("log/wait_strategy/spdlog_setup.log");
+        string line;
+        auto count = 0;
+
+        while (getline(file, line)) {
+            ++count;
+        }
+
+        return count;
+    };
+
+    REQUIRE_THROWS_AS(from_conf(R"(wait_strategy = "busy")"), setup_error);
+
+    // only spin_then_block stops spinning
+    REQUIRE_THROWS_AS(
+        from_conf("wait_strategy = \"spin\"\nspin_budget_us = 10"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        from_conf("wait_strategy = \"spin_then_block\"\nspin_budget_us = -1"),
+        setup_error);
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    static constexpr auto MESSAGES_COUNT = 100;
+
+    for (const auto wait :
+         {R"(wait_strategy = "yield")",
+          R"(wait_strategy = "spin")",
+          "wait_strategy = \"spin_then_block\"\nspin_budget_us = 200"}) {
+
+        from_conf(wait);
+
+        // the workers idle in between, as producers would after a lull
+        for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+            spdlog::get("global_polled")->info("{}", i);
+            spdlog::get("polled")->info("{}", i);
+
+            if (i % 10 == 0) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+
+        for (auto i = 0; i < 500 && count_lines() < 2 * MESSAGES_COUNT;
+             ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        REQUIRE(count_lines() == 2 * MESSAGES_COUNT);
+    }
+
+    // the spinning global thread pool would otherwise outlive the test
+    spdlog::drop_all();
+    spdlog::init_thread_pool(8192, 1);
+#endif
+
+    spdlog::drop_all();
+}
+
+TEST_CASE("Keep logger order in sharded pools", "[sharded_thread_pool]") {
+    spdlog::drop_all();
+
+    static constexpr auto LOGGERS_COUNT = 8;
+    static constexpr auto MESSAGES_COUNT = 200;
+
+    string conf = R"x(
+        global_pattern = "%n %v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/sharded/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[thread_pool]]
+        name = "sharded"
+        queue_size = 32
+        num_threads = 4
+        queue = "lockfree"
+        sharding = "logger"
+        batch_size = 4
+    )x";
+
+    for (auto l = 0; l < LOGGERS_COUNT; ++l) {
+        conf += fmt::format(
+            R"x(
+                [[logger]]
+                name = "sharded_{}"
+                type = "async"
+                thread_pool = "sharded"
+                sinks = ["file"]
+                flush_level = "info"
+            )x",
+            l);
+    }
+
+    const auto conf_tmp_file = examples::tmp_file(conf);
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    std::vector<std::thread> threads;
+
+    // a thread per logger, where the loggers spread over the workers
+    for (auto l = 0; l < LOGGERS_COUNT; ++l) {
+        threads.emplace_back([l] {
+            const auto logger = spdlog::get(fmt::format("sharded_{}", l));
+
+            for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+                logger->info("{}", i);
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    std::vector<string> lines;
+
+    for (auto i = 0; i < 500; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        lines.clear();
+        ifstream log_file("log/sharded/spdlog_setup.log");
+
+        for (string line; getline(log_file, line);) {
+            lines.push_back(line);
+        }
+
+        if (lines.size() >= LOGGERS_COUNT * MESSAGES_COUNT) {
+            break;
+        }
+    }
+
+    REQUIRE(lines.size() == LOGGERS_COUNT * MESSAGES_COUNT);
+
+    // each logger keeps its order, although written by several workers
+    std::unordered_map<string, int> next_indices;
+
+    for (const auto &line : lines) {
+        std::istringstream line_stream(line);
+        string name;
+        int i = 0;
+        line_stream >> name >> i;
+
+        REQUIRE(i == next_indices[name]);
+        ++next_indices[name];
+    }
+
+    REQUIRE(next_indices.size() == LOGGERS_COUNT);
+    spdlog::drop_all();
+#else
+    REQUIRE_THROWS_AS(
+        spdlog_setup::from_file(conf_tmp_file.get_file_path()), setup_error);
+#endif
+}
+
+TEST_CASE(
+    "Queue into private single-producer queues", "[logger_spsc_queue]") {
+
+    spdlog::drop_all();
+
+    static constexpr auto LOGGERS_COUNT = 4;
+    static constexpr auto MESSAGES_COUNT = 500;
+
+    static constexpr auto CONF = R"x(
+        global_pattern = "%n %v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/spsc/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[thread_pool]]
+        name = "blocking"
+        queue_size = 32
+        num_threads = 1
+
+        [[thread_pool]]
+        name = "lockfree"
+        queue_size = 32
+        num_threads = 2
+        queue = "lockfree"
+        batch_size = 4
+
+        [[logger]]
+        name = "spsc_shared"
+        type = "async"
+        thread_pool = "lockfree"
+        sinks = ["file"]
+        {logger}
+    )x";
+
+    const auto from_conf = [](const string &logger) {
+        spdlog::drop_all();
+
+        const auto tmp_file =
+            examples::tmp_file(fmt::format(CONF, arg("logger", logger)));
+
+        spdlog_setup::from_file(tmp_file.get_file_path());
+    };
+
+    REQUIRE_THROWS_AS(from_conf(R"(queue = "mpmc")"), setup_error);
+    REQUIRE_THROWS_AS(from_conf("queue_size = 16"), setup_error);
+
+    REQUIRE_THROWS_AS(
+        from_conf(R"(
+            [[logger]]
+            name = "spsc_sync"
+            sinks = ["file"]
+            queue = "spsc"
+        )"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        from_conf(R"(
+            [[logger]]
+            name = "spsc_overrun"
+            type = "async"
+            thread_pool = "lockfree"
+            sinks = ["file"]
+            queue = "spsc"
+            overflow_policy = "overrun_oldest"
+        )"),
+        setup_error);
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    // only the workers of lock-free thread pools poll private queues
+    REQUIRE_THROWS_AS(
+        from_conf(R"(
+            [[logger]]
+            name = "spsc_blocking"
+            type = "async"
+            thread_pool = "blocking"
+            sinks = ["file"]
+            queue = "spsc"
+        )"),
+        setup_error);
+
+    string loggers;
+
+    for (auto l = 0; l < LOGGERS_COUNT; ++l) {
+        loggers += fmt::format(
+            R"x(
+                [[logger]]
+                name = "spsc_{}"
+                type = "async"
+                thread_pool = "lockfree"
+                sinks = ["file"]
+                queue = "spsc"
+                queue_size = 16
+            )x",
+            l);
+    }
+
+    from_conf(loggers);
+
+    std::vector<std::thread> threads;
+
+    // a thread per private queue, next to a thread on the shared queue
+    for (auto l = 0; l < LOGGERS_COUNT; ++l) {
+        threads.emplace_back([l] {
+            const auto logger = spdlog::get(fmt::format("spsc_{}", l));
+
+            for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+                logger->info("{}", i);
+            }
+        });
+    }
+
+    threads.emplace_back([] {
+        const auto logger = spdlog::get("spsc_shared");
+
+        for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+            logger->info("{}", i);
+        }
+    });
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    // flushes may come from other threads than the producer
+    for (auto l = 0; l < LOGGERS_COUNT; ++l) {
+        spdlog::get(fmt::format("spsc_{}", l))->flush();
+    }
+
+    spdlog::get("spsc_shared")->flush();
+
+    std::vector<string> lines;
+
+    for (auto i = 0; i < 500; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        lines.clear();
+        ifstream log_file("log/spsc/spdlog_setup.log");
+
+        for (string line; getline(log_file, line);) {
+            lines.push_back(line);
+        }
+
+        if (lines.size() >= (LOGGERS_COUNT + 1) * MESSAGES_COUNT) {
+            break;
+        }
+    }
+
+    REQUIRE(lines.size() == (LOGGERS_COUNT + 1) * MESSAGES_COUNT);
+
+    // each private queue keeps its order, although taken by either worker,
+    // unlike the shared queue taken by both workers at the same time
+    std::unordered_map<string, int> next_indices;
+
+    for (const auto &line : lines) {
+        const auto space = line.find(' ');
+        const auto name = line.substr(0, space);
+        const auto index = std::stoi(line.substr(space + 1));
+
+        if (name != "spsc_shared") {
+            REQUIRE(index == next_indices[name]);
+            ++next_indices[name];
+        }
+    }
+
+    REQUIRE(next_indices.size() == LOGGERS_COUNT);
+
+    const auto snapshot = spdlog_setup::stats();
+    const auto &pool = snapshot.thread_pools.back();
+
+    REQUIRE(pool.name == "lockfree");
+    REQUIRE(pool.queue_capacity == 32 + LOGGERS_COUNT * 16);
+    REQUIRE(pool.queue_depth == 0);
+#endif
+
+    spdlog::drop_all();
+}
+
+TEST_CASE("Parse async overflow policies", "[overflow_policies]") {
+    spdlog::drop_all();
+
+    static constexpr auto CONF = R"x(
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [[thread_pool]]
+        name = "lockfree"
+        queue_size = 16
+        num_threads = 1
+        queue = "{queue}"
+
+        [[logger]]
+        name = "overflow"
+        type = "async"
+        thread_pool = "lockfree"
+        sinks = ["null"]
+        {overflow}
+    )x";
+
+    const auto from_conf = [](const string &queue, const string &overflow) {
+        const auto tmp_file = examples::tmp_file(fmt::format(
+            CONF, arg("queue", queue), arg("overflow", overflow)));
+
+        spdlog_setup::from_file(tmp_file.get_file_path());
+    };
+
+    // wrong parameters are reported regardless of the queue
+    REQUIRE_THROWS_AS(
+        from_conf("lockfree", R"(overflow_policy = "block_with_timeout")"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        from_conf(
+            "lockfree",
+            R"(overflow_policy = "block"
+               overflow_timeout = "1ms")"),
+        setup_error);
+
+    REQUIRE_THROWS_AS(
+        from_conf(
+            "lockfree",
+            R"(overflow_policy = "drop_below_level"
+               overflow_level = "loud")"),
+        setup_error);
 
-    root_logger->trace("Test Message - Trace!");
-    root_logger->debug("Test Message - Debug!");
-    root_logger->info("Test Message - Info!");
-    root_logger->warn("Test Message - Warn!");
-    root_logger->error("Test Message - Error!");
-    root_logger->critical("Test Message - Critical!");
+    // spdlog thread pools only block or overrun the oldest
+    REQUIRE_THROWS_AS(
+        from_conf("blocking", R"(overflow_policy = "discard_new")"),
+        setup_error);
 
-    const auto console_logger = spdlog::get("console");
-    REQUIRE(console_logger != nullptr);
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    from_conf(
+        "lockfree",
+        R"(overflow_policy = "block_with_timeout"
+           overflow_timeout = "10ms")");
 
-    console_logger->info("Console Message - Info!");
-    console_logger->error("Console Message - Error!");
-}
+    const auto dropped = spdlog_setup::get_dropped_messages("overflow");
+    REQUIRE(dropped.timed_out == 0);
 
-TEST_CASE(
-    "Parse pre-TOML file for set-up", "[from_file_with_tag_replacement]") {
     spdlog::drop_all();
 
-    const auto index_arg = arg("index", 123);
-    const auto path_arg = arg("path", "spdlog_setup");
-    const auto tmp_file = get_pre_conf_tmp_file();
+    from_conf(
+        "lockfree",
+        R"(overflow_policy = "drop_below_level"
+           overflow_level = "err")");
 
-    spdlog_setup::from_file_with_tag_replacement(
-        tmp_file.get_file_path(), index_arg, path_arg);
+    REQUIRE(spdlog::get("overflow") != nullptr);
+#endif
 
-    const auto root_logger = spdlog::get("root");
-    REQUIRE(root_logger != nullptr);
+    REQUIRE_THROWS_AS(
+        spdlog_setup::get_dropped_messages("missing"), setup_error);
 
-    root_logger->trace("Test Message - Trace!");
-    root_logger->debug("Test Message - Debug!");
-    root_logger->info("Test Message - Info!");
-    root_logger->warn("Test Message - Warn!");
-    root_logger->error("Test Message - Error!");
-    root_logger->critical("Test Message - Critical!");
+    spdlog::drop_all();
 }
 
-TEST_CASE(
-    "Parse TOML file with override for set-up", "[from_file_with_override]") {
+TEST_CASE("Take stats of thread pools, loggers and sinks", "[stats]") {
     spdlog::drop_all();
 
-    const auto full_conf_tmp_file = get_full_conf_tmp_file();
-    const auto override_conf_tmp_file = get_override_conf_tmp_file();
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        global_pattern = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/stats/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[thread_pool]]
+        name = "blocking"
+        queue_size = 32
+        num_threads = 1
+
+        [[thread_pool]]
+        name = "lockfree"
+        queue_size = 16
+        num_threads = 2
+        queue = "lockfree"
+        sharding = "logger"
+
+        [[logger]]
+        name = "stats_sync"
+        sinks = ["file"]
+
+        [[logger]]
+        name = "stats_blocking"
+        type = "async"
+        thread_pool = "blocking"
+        sinks = ["file"]
+
+        [[logger]]
+        name = "stats_lockfree"
+        type = "async"
+        thread_pool = "lockfree"
+        sinks = ["file"]
+    )x");
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    static constexpr auto MESSAGES_COUNT = 10;
+
+    // each line is "message N" with the end of line
+    const auto line_size = 9 + string(spdlog::details::os::default_eol).size();
+
+    for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+        spdlog::get("stats_sync")->info("message {}", i);
+    }
 
-    const auto use_override = spdlog_setup::from_file_and_override(
-        full_conf_tmp_file.get_file_path(),
-        override_conf_tmp_file.get_file_path());
+    auto snapshot = spdlog_setup::stats();
 
-    REQUIRE(use_override);
+    REQUIRE(snapshot.sinks.size() == 1);
+    REQUIRE(snapshot.sinks[0].name == "file");
+    REQUIRE(snapshot.sinks[0].messages == MESSAGES_COUNT);
+    REQUIRE(snapshot.sinks[0].bytes == MESSAGES_COUNT * line_size);
 
-    const auto console_logger = spdlog::get("console");
-    REQUIRE(console_logger != nullptr);
+    REQUIRE(snapshot.loggers.size() == 3);
+    REQUIRE(snapshot.loggers[0].name == "stats_blocking");
+    REQUIRE(snapshot.loggers[1].name == "stats_lockfree");
+    REQUIRE(snapshot.loggers[2].name == "stats_sync");
 
-    console_logger->trace("Console Message - Trace!");
-    console_logger->debug("Console Message - Debug!");
-    console_logger->info("Console Message - Info!");
-    console_logger->warn("Console Message - Warn!");
-    console_logger->error("Console Message - Error!");
-    console_logger->critical("Console Message - Critical!");
-}
+    for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+        spdlog::get("stats_blocking")->info("message {}", i);
+        spdlog::get("stats_lockfree")->info("message {}", i);
+    }
 
-TEST_CASE(
-    "Parse TOML file with empty override for set-up",
-    "[from_file_with_override_empty]") {
+    for (auto i = 0; i < 500; ++i) {
+        snapshot = spdlog_setup::stats();
 
-    spdlog::drop_all();
+        if (snapshot.sinks[0].messages >= 3 * MESSAGES_COUNT) {
+            break;
+        }
 
-    const auto full_conf_tmp_file = get_full_conf_tmp_file();
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
 
-    const auto use_override = spdlog_setup::from_file_and_override(
-        full_conf_tmp_file.get_file_path(), "no_such_file");
+    REQUIRE(snapshot.sinks[0].messages == 3 * MESSAGES_COUNT);
+    REQUIRE(snapshot.sinks[0].bytes == 3 * MESSAGES_COUNT * line_size);
 
-    REQUIRE(!use_override);
+    // the global thread pool comes first with its empty name if present
+    const auto &pools = snapshot.thread_pools;
+    REQUIRE(pools.size() >= 2);
 
-    const auto console_logger = spdlog::get("console");
-    REQUIRE(console_logger != nullptr);
+    const auto &blocking_stats = pools[pools.size() - 2];
+    REQUIRE(blocking_stats.name == "blocking");
+    REQUIRE(blocking_stats.queue_capacity == 32);
+    REQUIRE(blocking_stats.queue_depth == 0);
+    REQUIRE(blocking_stats.overruns == 0);
+    REQUIRE(blocking_stats.enqueue_latency.empty());
 
-    console_logger->trace("Console Message - Trace!");
-    console_logger->debug("Console Message - Debug!");
-    console_logger->info("Console Message - Info!");
-    console_logger->warn("Console Message - Warn!");
-    console_logger->error("Console Message - Error!");
-    console_logger->critical("Console Message - Critical!");
+    const auto &lockfree_stats = pools[pools.size() - 1];
+    REQUIRE(lockfree_stats.name == "lockfree");
+    REQUIRE(lockfree_stats.queue_capacity == 2 * 16);
+    REQUIRE(lockfree_stats.queue_depth == 0);
+    REQUIRE(lockfree_stats.high_water_mark <= 16);
+    REQUIRE(lockfree_stats.overruns == 0);
+
+    uint64_t enqueued = 0;
+
+    for (const auto &bucket : lockfree_stats.enqueue_latency) {
+        enqueued += bucket.count;
+    }
+
+    REQUIRE(enqueued == MESSAGES_COUNT);
+    REQUIRE(
+        lockfree_stats.enqueue_latency.back().upper_bound ==
+        std::chrono::nanoseconds::max());
+
+    spdlog::drop_all();
+#else
+    static_cast<void>(conf_tmp_file);
+#endif
 }
 
-TEST_CASE(
-    "Parse pre-TOML file with override for set-up",
-    "[from_file_with_override_with_tag_replacement]") {
+TEST_CASE("Flush loggers and sinks periodically", "[flush_interval]") {
     spdlog::drop_all();
 
-    const auto index_arg = arg("index", 123);
-    const auto path_arg = arg("path", "spdlog_setup");
-    const auto hash_arg = arg("hash", "qwerty");
+    static constexpr auto CONF = R"x(
+        global_pattern = "%v"
+        {global}
+
+        [[sink]]
+        name = "sink_flushed"
+        type = "{sink_type}"
+        filename = "log/flush_interval/sink_flushed.log"
+        create_parent_dir = true
+        truncate = true
+        {sink}
+
+        [[sink]]
+        name = "logger_flushed"
+        type = "basic_file_sink_mt"
+        filename = "log/flush_interval/logger_flushed.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[logger]]
+        name = "sink_flushed"
+        sinks = ["sink_flushed"]
+
+        [[logger]]
+        name = "logger_flushed"
+        sinks = ["logger_flushed"]
+    )x";
+
+    const auto from_conf = [](
+                               const string &global,
+                               const string &sink_type,
+                               const string &sink) {
+        spdlog::drop_all();
+
+        const auto tmp_file = examples::tmp_file(fmt::format(
+            CONF,
+            arg("global", global),
+            arg("sink_type", sink_type),
+            arg("sink", sink)));
+
+        spdlog_setup::from_file(tmp_file.get_file_path());
+    };
+
+    const auto read_file = [](const string &path) {
+        ifstream file(path);
+        return string(
+            std::istreambuf_iterator<char>(file),
+            std::istreambuf_iterator<char>());
+    };
+
+    const auto wait_for_content = [&read_file](const string &path) {
+        for (auto i = 0; i < 500; ++i) {
+            const auto content = read_file(path);
+
+            if (!content.empty()) {
+                return content;
+            }
+
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
 
-    const auto pre_conf_tmp_file = get_pre_conf_tmp_file();
-    const auto override_pre_conf_tmp_file = get_override_pre_conf_tmp_file();
+        return string();
+    };
 
-    const auto use_override =
-        spdlog_setup::from_file_and_override_with_tag_replacement(
-            pre_conf_tmp_file.get_file_path(),
-            override_pre_conf_tmp_file.get_file_path(),
-            index_arg,
-            path_arg,
-            hash_arg);
+    REQUIRE_THROWS_AS(
+        from_conf(R"(flush_interval = "soon")", "basic_file_sink_mt", ""),
+        setup_error);
 
-    REQUIRE(use_override);
+    REQUIRE_THROWS_AS(
+        from_conf("", "basic_file_sink_mt", R"(flush_interval = "0ms")"),
+        setup_error);
 
-    const auto root_logger = spdlog::get("root");
-    REQUIRE(root_logger != nullptr);
+    // flushing from another thread is only safe for _mt sinks
+    REQUIRE_THROWS_AS(
+        from_conf("", "basic_file_sink_st", R"(flush_interval = "50ms")"),
+        setup_error);
 
-    root_logger->trace("Test Message - Trace!");
-    root_logger->debug("Test Message - Debug!");
-    root_logger->info("Test Message - Info!");
-    root_logger->warn("Test Message - Warn!");
-    root_logger->error("Test Message - Error!");
-    root_logger->critical("Test Message - Critical!");
+    from_conf(
+        R"(flush_interval = "20ms")",
+        "basic_file_sink_mt",
+        R"(flush_interval = "50ms")");
+
+    // both files are buffered, so only the flusher writes the lines out
+    spdlog::get("sink_flushed")->info("sink");
+    spdlog::get("logger_flushed")->info("logger");
+
+    REQUIRE(
+        wait_for_content("log/flush_interval/sink_flushed.log") ==
+        "sink" + string(spdlog::details::os::default_eol));
+
+    REQUIRE(
+        wait_for_content("log/flush_interval/logger_flushed.log") ==
+        "logger" + string(spdlog::details::os::default_eol));
+
+    // a set-up without intervals stops the periodic flushes
+    from_conf("", "basic_file_sink_mt", "");
+
+    spdlog::get("sink_flushed")->info("sink");
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+    REQUIRE(read_file("log/flush_interval/sink_flushed.log").empty());
+
+    spdlog::drop_all();
 }
 
-TEST_CASE(
-    "Parse pre-TOML file with missing override for set-up",
-    "[from_file_with_missing_override_with_tag_replacement]") {
+TEST_CASE("Shut down by draining all thread pools", "[shutdown]") {
     spdlog::drop_all();
 
-    const auto index_arg = arg("index", 123);
-    const auto path_arg = arg("path", "spdlog_setup");
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        global_pattern = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/shutdown/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[thread_pool]]
+        name = "blocking"
+        queue_size = 1024
+        num_threads = 1
+
+        [[thread_pool]]
+        name = "lockfree"
+        queue_size = 1024
+        num_threads = 2
+        queue = "lockfree"
+
+        [[logger]]
+        name = "shutdown_blocking"
+        type = "async"
+        thread_pool = "blocking"
+        sinks = ["file"]
+
+        [[logger]]
+        name = "shutdown_lockfree"
+        type = "async"
+        thread_pool = "lockfree"
+        sinks = ["file"]
+    )x");
+
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    static constexpr auto MESSAGES_COUNT = 500;
+
+    const auto count_lines = [] {
+        ifstream file("log/shutdown/spdlog_setup.log");
+        string line;
+        auto count = 0;
+
+        while (getline(file, line)) {
+            ++count;
+        }
 
-    const auto pre_conf_tmp_file = get_pre_conf_tmp_file();
+        return count;
+    };
 
-    const auto use_override =
-        spdlog_setup::from_file_and_override_with_tag_replacement(
-            pre_conf_tmp_file.get_file_path(),
-            "no_such_file",
-            index_arg,
-            path_arg);
+    for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+        spdlog::get("shutdown_blocking")->info("message {}", i);
+        spdlog::get("shutdown_lockfree")->info("message {}", i);
+    }
 
-    REQUIRE(!use_override);
+    const auto report = spdlog_setup::shutdown(
+        std::chrono::steady_clock::now() + std::chrono::seconds(5));
 
-    const auto root_logger = spdlog::get("root");
-    REQUIRE(root_logger != nullptr);
+    REQUIRE(report.completed);
+    REQUIRE(report.flushed_sinks == std::vector<string>{"file"});
+    REQUIRE(report.unflushed_sinks.empty());
 
-    root_logger->trace("Test Message - Trace!");
-    root_logger->debug("Test Message - Debug!");
-    root_logger->info("Test Message - Info!");
-    root_logger->warn("Test Message - Warn!");
-    root_logger->error("Test Message - Error!");
-    root_logger->critical("Test Message - Critical!");
+    for (const auto &pool : report.thread_pools) {
+        REQUIRE(pool.dropped == 0);
+    }
+
+    // the file is buffered, so the lines are only all out once flushed
+    REQUIRE(count_lines() == 2 * MESSAGES_COUNT);
+
+    // nothing is accepted any more
+    spdlog::get("shutdown_blocking")->info("late");
+    spdlog::get("shutdown_lockfree")->info("late");
+    spdlog::get("shutdown_blocking")->flush();
+    spdlog::get("shutdown_lockfree")->flush();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+    REQUIRE(count_lines() == 2 * MESSAGES_COUNT);
+
+    spdlog::drop_all();
+    spdlog::set_level(spdlog::level::info);
 }
 
-TEST_CASE("Parse TOML file that does not exist", "[from_file_no_such_file]") {
+TEST_CASE("Route async loggers per NUMA node", "[numa_per_node]") {
     spdlog::drop_all();
 
+    const auto conf_tmp_file = examples::tmp_file(R"x(
+        global_pattern = "%v"
+
+        [[sink]]
+        name = "file"
+        type = "basic_file_sink_mt"
+        filename = "log/numa/spdlog_setup.log"
+        create_parent_dir = true
+        truncate = true
+
+        [[thread_pool]]
+        name = "numa"
+        queue_size = 128
+        num_threads = 1
+        numa = "per_node"
+
+        [[logger]]
+        name = "numa"
+        type = "async"
+        thread_pool = "numa"
+        sinks = ["file"]
+    )x");
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+    spdlog_setup::from_file(conf_tmp_file.get_file_path());
+
+    const auto logger = spdlog::get("numa");
+    REQUIRE(logger != nullptr);
+
+    REQUIRE(
+        typeid(*logger) ==
+        typeid(const spdlog_setup::details::numa_async_logger &));
+
+    static constexpr auto THREADS_COUNT = 4;
+    static constexpr auto MESSAGES_COUNT = 100;
+
+    std::vector<std::thread> threads;
+
+    for (auto t = 0; t < THREADS_COUNT; ++t) {
+        threads.emplace_back([&logger, t] {
+            for (auto i = 0; i < MESSAGES_COUNT; ++i) {
+                logger->info("{} {}", t, i);
+            }
+        });
+    }
+
+    for (auto &thread : threads) {
+        thread.join();
+    }
+
+    logger->flush();
+
+    std::vector<string> lines;
+
+    for (auto i = 0; i < 500; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+        lines.clear();
+        ifstream log_file("log/numa/spdlog_setup.log");
+
+        for (string line; getline(log_file, line);) {
+            lines.push_back(line);
+        }
+
+        if (lines.size() >= THREADS_COUNT * MESSAGES_COUNT) {
+            break;
+        }
+    }
+
+    REQUIRE(lines.size() == THREADS_COUNT * MESSAGES_COUNT);
+
+    // every thread keeps its order
+    std::vector<int> next_indices(THREADS_COUNT, 0);
+
+    for (const auto &line : lines) {
+        std::istringstream line_stream(line);
+        int t = 0;
+        int i = 0;
+        line_stream >> t >> i;
+
+        REQUIRE(i == next_indices[t]);
+        ++next_indices[t];
+    }
+
+    spdlog::drop_all();
+#else
     REQUIRE_THROWS_AS(
-        spdlog_setup::from_file("config/no_such_file"), setup_error);
+        spdlog_setup::from_file(conf_tmp_file.get_file_path()), setup_error);
+#endif
 }
 
-TEST_CASE(
-    "Parse pre-TOML file that does not exist",
-    "[from_file_with_tag_replacement_no_such_file]") {
-
+TEST_CASE("Watch configuration files for changes", "[watch]") {
     spdlog::drop_all();
 
-    REQUIRE_THROWS_AS(
-        spdlog_setup::from_file_with_tag_replacement("config/no_such_file"),
-        setup_error);
+    static constexpr auto CONF = R"x(
+        [[sink]]
+        name = "null"
+        type = "null_sink_mt"
+
+        [[logger]]
+        name = "watched"
+        sinks = ["null"]
+        level = "{}"
+    )x";
+
+    const auto conf_tmp_file = examples::tmp_file(fmt::format(CONF, "info"));
+    const auto &conf_path = conf_tmp_file.get_file_path();
+    spdlog_setup::from_file(conf_path);
+
+    const auto logger = spdlog::get("watched");
+    REQUIRE(logger != nullptr);
+
+    std::atomic<int> reloads(0);
+    std::atomic<int> errors(0);
+
+    spdlog_setup::watch_options options;
+    options.debounce = std::chrono::milliseconds(50);
+    options.poll_interval = std::chrono::milliseconds(20);
+    options.on_reload = [&reloads] { ++reloads; };
+    options.on_error = [&errors](const string &) { ++errors; };
+
+    auto watcher = spdlog_setup::watch(conf_path, "no_such_file", options);
+
+    const auto wait_for = [](const std::atomic<int> &counter) {
+        for (auto i = 0; i < 500 && counter == 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        return counter > 0;
+    };
+
+    // editors commonly save by replacing the file
+    spdlog_setup::details::write_file_atomically(
+        conf_path, fmt::format(CONF, "warn"));
+
+    REQUIRE(wait_for(reloads));
+    REQUIRE(spdlog::get("watched") == logger);
+    REQUIRE(logger->level() == level_enum::warn);
+
+    // invalid configuration is reported and leaves the logger in place
+    spdlog_setup::details::write_file_atomically(
+        conf_path, fmt::format(CONF, "loud"));
+
+    REQUIRE(wait_for(errors));
+    REQUIRE(spdlog::get("watched") == logger);
+    REQUIRE(logger->level() == level_enum::warn);
+
+    watcher.stop();
 }
 
 TEST_CASE("Save logger to new file", "[save_logger_to_file_new]") {
@@ -563,8 +2544,70 @@ TEST_CASE("Delete logger from empty file", "[delete_logger_in_file_empty]") {
         setup_error);
 }
 
+TEST_CASE("Edit override file in a transaction", "[override_transaction]") {
+    spdlog::drop_all();
+
+    const auto tmp_file = get_simple_console_logger_conf_tmp_file();
+    const auto &tmp_file_path = tmp_file.get_file_path();
+
+    {
+        spdlog_setup::override_transaction transaction(tmp_file_path);
+
+        for (auto i = 0; i < 100; ++i) {
+            transaction.set_logger_level(
+                "logger_" + std::to_string(i), level_enum::warn);
+        }
+
+        transaction.set_logger_level("console", level_enum::err);
+        transaction.set_sink_level("console_st", level_enum::info);
+        REQUIRE(transaction.delete_logger("not-console"));
+        REQUIRE(!transaction.delete_logger("no-such-thing"));
+
+        // nothing is written until committed
+        const auto config = cpptoml::parse_file(tmp_file_path);
+        REQUIRE(dist(*config->get_table_array(LOGGER_TABLE)) == 2);
+
+        transaction.commit();
+    }
+
+    const auto config = cpptoml::parse_file(tmp_file_path);
+    const auto loggers = config->get_table_array(LOGGER_TABLE);
+    REQUIRE(loggers != nullptr);
+    REQUIRE(dist(*loggers) == 101);
+
+    const auto console = get_index(*loggers, 0);
+    REQUIRE(*console->get_as<string>(NAME) == "console");
+    REQUIRE(*console->get_as<string>(LEVEL) == "err");
+    REQUIRE(*console->get_as<string>(names::PATTERN) == "easy");
+
+    const auto sinks = config->get_table_array(names::SINK_TABLE);
+    REQUIRE(sinks != nullptr);
+    REQUIRE(dist(*sinks) == 1);
+    REQUIRE(*get_index(*sinks, 0)->get_as<string>(LEVEL) == "info");
+
+    // saving all registered loggers at once
+    spdlog::stdout_logger_mt("first")->set_level(level_enum::debug);
+    spdlog::stdout_logger_mt("second")->set_level(level_enum::critical);
+
+    spdlog_setup::save_loggers_to_file(tmp_file_path, true);
+
+    const auto saved_config = cpptoml::parse_file(tmp_file_path);
+    const auto saved_loggers = saved_config->get_table_array(LOGGER_TABLE);
+    REQUIRE(saved_loggers != nullptr);
+    REQUIRE(dist(*saved_loggers) == 2);
+
+    const auto first = spdlog_setup::details::find_item_by_name(
+        *saved_loggers, "first");
+
+    REQUIRE(first != nullptr);
+    REQUIRE(*first->get_as<string>(LEVEL) == "debug");
+
+    spdlog::drop_all();
+}
+
 TEST_CASE("Check templating", "[check_templating]") {
     REQUIRE(render("", {{}}) == "");
+    REQUIRE(render("x = { a = 1 }", {{}}) == "x = { a = 1 }");
     REQUIRE(render("abc", {{}}) == "abc");
     REQUIRE(render("{{ a }}", {{"a", "Alpha"}}) == "Alpha");
 
@@ -591,3 +2634,69 @@ TEST_CASE("Check templating", "[check_templating]") {
                 {"l", "LLL"},
             }) == "aBBBcdfghijKKKLLL) (BBB");
 }
+
+TEST_CASE("Check compiled templating", "[check_compiled_templating]") {
+    const compiled_template tmpl("a{{b}}cd{{ e }}f{{\"g\"}}h{i {{b}}");
+
+    // verbatim text is literal, without any slot
+    REQUIRE(tmpl.variables() == std::vector<string>{"b", "e", "b"});
+
+    REQUIRE(
+        tmpl.render({{"b", "BBB"}, {"e", "EEE"}}) == "aBBBcdEEEfgh{i BBB");
+
+    REQUIRE(tmpl.render({{"e", "!"}}) == "acd!fgh{i ");
+
+    // binding the empty name substitutes into neither verbatim text nor
+    // empty braces
+    REQUIRE(tmpl.render({{"", "X"}}) == "acdfgh{i ");
+    REQUIRE(compiled_template("a{{ }}b").render({{"", "X"}}) == "ab");
+
+    // buffer is reused across renders
+    string out = "leftover";
+    tmpl.render_into(out, {{"b", "1"}});
+    REQUIRE(out == "a1cdfgh{i 1");
+
+    struct bindings {
+        string b;
+        string e;
+    } values{"x", "y"};
+
+    tmpl.render_into_with(out, [&values](const string &name) -> const string * {
+        return name == "b" ? &values.b : name == "e" ? &values.e : nullptr;
+    });
+
+    REQUIRE(out == "axcdyfgh{i x");
+
+    REQUIRE_THROWS_AS(compiled_template("{{ a b }}"), setup_error);
+    REQUIRE_THROWS_AS(compiled_template("{{ a"), setup_error);
+}
+
+TEST_CASE(
+    "Parse compiled pre-TOML file for set-up",
+    "[from_file_with_compiled_tag_replacement]") {
+
+    spdlog::drop_all();
+
+    const auto tmp_file = examples::tmp_file(R"x(
+        [[sink]]
+        name = "{{ sink }}"
+        type = "null_sink_mt"
+
+        [[logger]]
+        name = "{{ logger }}"
+        sinks = ["{{ sink }}"]
+        level = "{{ level }}"
+    )x");
+
+    const auto tmpl =
+        spdlog_setup::compile_template_file(tmp_file.get_file_path());
+
+    for (const auto &worker : {"worker-1", "worker-2"}) {
+        spdlog_setup::from_file_with_tag_replacement(
+            tmpl, {{"sink", "null"}, {"logger", worker}, {"level", "warn"}});
+
+        const auto logger = spdlog::get(worker);
+        REQUIRE(logger != nullptr);
+        REQUIRE(logger->level() == level_enum::warn);
+    }
+}
@@ -8,6 +8,10 @@
 
 #include "sinks.h"
 
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
 #include <typeinfo>
 
 TEST_CASE("Parse stdout sink st", "[parse_generate_stdout_sink_st]") {
@@ -33,3 +37,417 @@ TEST_CASE("Parse stderr sink mt", "[parse_generate_stderr_sink_mt]") {
         spdlog_setup::details::setup_sink(generate_stderr_sink_mt());
     REQUIRE(typeid(*sink) == typeid(const spdlog::sinks::stderr_sink_mt &));
 }
+
+TEST_CASE("Parse file sinks in parallel", "[parse_file_sinks_in_parallel]") {
+    const auto sinks =
+        spdlog_setup::details::setup_sinks(generate_file_sinks(32, 4));
+
+    REQUIRE(sinks.size() == 32);
+
+    for (const auto &sink : sinks) {
+        REQUIRE(
+            typeid(*sink.second) ==
+            typeid(const spdlog::sinks::basic_file_sink_mt &));
+    }
+}
+
+TEST_CASE(
+    "Parse sinks in parallel without file sinks",
+    "[parse_no_file_sinks_in_parallel]") {
+    namespace names = spdlog_setup::details::names;
+
+    auto sink_table = generate_stdout_sink_mt();
+    sink_table->insert(names::NAME, std::string("console"));
+
+    auto sink_table_array = cpptoml::make_table_array();
+    sink_table_array->push_back(std::move(sink_table));
+
+    auto conf = cpptoml::make_table();
+    conf->insert(names::SINK_TABLE, std::move(sink_table_array));
+    conf->insert(names::SINK_SETUP_THREADS, 4);
+
+    // no sink is left for the worker threads to build
+    const auto sinks = spdlog_setup::details::setup_sinks(conf);
+
+    REQUIRE(sinks.size() == 1);
+
+    REQUIRE(
+        typeid(*sinks.at("console")) ==
+        typeid(const spdlog::sinks::stdout_sink_mt &));
+}
+
+TEST_CASE("Share file sinks of the same file", "[share_file_sinks]") {
+    const auto sink = spdlog_setup::details::setup_sink(
+        generate_file_sink("basic_file_sink_mt", "log/shared/sink.log"));
+
+    // same file spelt differently, as from another configuration
+    const auto same_sink = spdlog_setup::details::setup_sink(generate_file_sink(
+        "basic_file_sink_mt", "log/shared/../shared/./sink.log"));
+
+    REQUIRE(same_sink == sink);
+
+    // a second sink must not write into the file that is still in use
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(
+            generate_file_sink("basic_file_sink_st", "log/shared/sink.log")),
+        spdlog_setup::setup_error);
+
+    const auto other_file_sink = spdlog_setup::details::setup_sink(
+        generate_file_sink("basic_file_sink_mt", "log/shared/other.log"));
+
+    REQUIRE(other_file_sink != sink);
+
+    // other file parameters would truncate the file under the shared sink
+    auto truncate_table =
+        generate_file_sink("basic_file_sink_mt", "log/shared/sink.log");
+
+    truncate_table->insert(spdlog_setup::details::names::TRUNCATE, true);
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(truncate_table),
+        spdlog_setup::setup_error);
+}
+
+TEST_CASE(
+    "Never share single-threaded file sinks", "[share_file_sinks_st]") {
+    const auto table =
+        generate_file_sink("basic_file_sink_st", "log/shared/sink_st.log");
+
+    auto sink = spdlog_setup::details::setup_sink(table);
+
+    REQUIRE(
+        typeid(*sink) == typeid(const spdlog::sinks::basic_file_sink_st &));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(table), spdlog_setup::setup_error);
+
+    // the file can be opened again once the first sink is released
+    sink.reset();
+
+    const auto reopened_sink = spdlog_setup::details::setup_sink(table);
+    REQUIRE(reopened_sink != nullptr);
+}
+
+TEST_CASE(
+    "Parse invalid file sinks in parallel",
+    "[parse_invalid_file_sinks_in_parallel]") {
+    namespace names = spdlog_setup::details::names;
+
+    const auto conf = generate_file_sinks(16, 4);
+    const auto sink_tables = conf->get_table_array(names::SINK_TABLE);
+
+    // both are missing filename, only the first in file order is reported
+    sink_tables->get()[13]->erase(names::FILENAME);
+    sink_tables->get()[5]->erase(names::FILENAME);
+
+    for (auto i = 0; i < 10; ++i) {
+        try {
+            spdlog_setup::details::setup_sinks(conf);
+            FAIL("Expected setup_error");
+        } catch (const spdlog_setup::setup_error &e) {
+            REQUIRE(
+                std::string(e.what()).find("Sink 'file_5' error") !=
+                std::string::npos);
+        }
+    }
+}
+
+TEST_CASE("Write into memory-mapped file sinks", "[mmap_file_sink]") {
+    namespace names = spdlog_setup::details::names;
+
+    // std
+    using std::ifstream;
+    using std::istreambuf_iterator;
+    using std::string;
+
+    const auto read_file = [](const string &path) {
+        ifstream istr(path, std::ios::binary);
+        return string(istreambuf_iterator<char>(istr), {});
+    };
+
+    const string path = "log/mmap/sink.log";
+
+    auto sink_table = generate_file_sink("mmap_file_sink_mt", path);
+    sink_table->insert(names::CHUNK_SIZE, std::string("4K"));
+    sink_table->insert(names::TRUNCATE, true);
+
+    string expected;
+
+    {
+        auto sink = spdlog_setup::details::setup_sink(sink_table);
+        REQUIRE(
+            typeid(*sink) == typeid(const spdlog_setup::mmap_file_sink_mt &));
+
+        spdlog::logger logger("mmap", sink);
+        logger.set_pattern("%v");
+
+        // spans several chunks
+        for (auto i = 0; i < 1000; ++i) {
+            logger.info("message {}", i);
+            expected += "message " + std::to_string(i) + "\n";
+        }
+
+        logger.flush();
+
+        // padded up to the end of the current chunk while open
+        const auto open_content = read_file(path);
+        REQUIRE(open_content.size() > expected.size());
+        REQUIRE(open_content.substr(0, expected.size()) == expected);
+
+        REQUIRE(
+            open_content.find_first_not_of('\0', expected.size()) ==
+            string::npos);
+    }
+
+    // truncated to the bytes written once closed
+    REQUIRE(read_file(path) == expected);
+
+    // content ending with zero bytes is appended to, not trimmed
+    const auto binary = string("binary") + string(100, '\0');
+
+    {
+        std::ofstream ostr(path, std::ios::binary | std::ios::app);
+        ostr << binary;
+    }
+
+    expected += binary;
+
+    sink_table->insert(names::TRUNCATE, false);
+    sink_table->insert(names::TYPE, std::string("mmap_file_sink_st"));
+
+    {
+        auto sink = spdlog_setup::details::setup_sink(sink_table);
+        REQUIRE(
+            typeid(*sink) == typeid(const spdlog_setup::mmap_file_sink_st &));
+
+        spdlog::logger logger("mmap", sink);
+        logger.set_pattern("%v");
+        logger.info("appended");
+        logger.flush();
+    }
+
+    REQUIRE(read_file(path) == expected + "appended\n");
+
+    sink_table->insert(names::CHUNK_SIZE, std::string("0"));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(sink_table),
+        spdlog_setup::setup_error);
+}
+
+TEST_CASE("Write file sinks through large buffers", "[buffered_file_sink]") {
+    namespace names = spdlog_setup::details::names;
+
+    // std
+    using std::ifstream;
+    using std::istreambuf_iterator;
+    using std::string;
+
+    const auto read_file = [](const string &path) {
+        ifstream istr(path, std::ios::binary);
+        return string(istreambuf_iterator<char>(istr), {});
+    };
+
+    const auto log_lines = [](
+                               const std::shared_ptr<spdlog::sinks::sink> &sink,
+                               const int count,
+                               string &expected) {
+        spdlog::logger logger("buffered", sink);
+        logger.set_pattern("%v");
+
+        for (auto i = 0; i < count; ++i) {
+            logger.info("message {}", i);
+            expected += "message " + std::to_string(i) + "\n";
+        }
+    };
+
+    for (const auto direct_io : {false, true}) {
+        const string path = "log/buffered/sink.log";
+
+        auto sink_table = generate_file_sink("basic_file_sink_mt", path);
+        sink_table->insert(names::BUFFER_SIZE, std::string("64K"));
+        sink_table->insert(names::DIRECT_IO, direct_io);
+        sink_table->insert(names::TRUNCATE, true);
+
+        string expected;
+
+        {
+            const auto sink = spdlog_setup::details::setup_sink(sink_table);
+
+            REQUIRE(
+                typeid(*sink) ==
+                typeid(const spdlog_setup::buffered_file_sink_mt &));
+
+            // held back until the buffer fills up or is flushed
+            log_lines(sink, 100, expected);
+            REQUIRE(read_file(path).empty());
+
+            sink->flush();
+            REQUIRE(read_file(path) == expected);
+
+            // a partial block written out again in place with direct I/O
+            log_lines(sink, 10000, expected);
+            sink->flush();
+            REQUIRE(read_file(path) == expected);
+
+            log_lines(sink, 10, expected);
+        }
+
+        REQUIRE(read_file(path) == expected);
+
+        // appends after a partial block, which is read back with direct I/O
+        sink_table->insert(names::TRUNCATE, false);
+        sink_table->insert(names::TYPE, std::string("basic_file_sink_st"));
+
+        {
+            const auto sink = spdlog_setup::details::setup_sink(sink_table);
+
+            REQUIRE(
+                typeid(*sink) ==
+                typeid(const spdlog_setup::buffered_file_sink_st &));
+
+            log_lines(sink, 10, expected);
+        }
+
+        REQUIRE(read_file(path) == expected);
+    }
+
+    {
+        const string path = "log/buffered/rotating/sink.log";
+
+        std::remove(path.c_str());
+        std::remove("log/buffered/rotating/sink.1.log");
+
+        auto sink_table = generate_file_sink("rotating_file_sink_mt", path);
+        sink_table->erase(names::FILENAME);
+        sink_table->insert(names::BASE_FILENAME, path);
+        sink_table->insert(names::MAX_SIZE, std::string("4K"));
+        sink_table->insert(names::MAX_FILES, static_cast<int64_t>(1));
+        sink_table->insert(names::BUFFER_SIZE, std::string("1K"));
+
+        string expected;
+
+        {
+            const auto sink = spdlog_setup::details::setup_sink(sink_table);
+
+            REQUIRE(
+                typeid(*sink) ==
+                typeid(const spdlog_setup::buffered_rotating_file_sink_mt &));
+
+            log_lines(sink, 1000, expected);
+        }
+
+        // rotated by size, as the unbuffered sink
+        const auto content = read_file(path);
+        const auto rotated = read_file("log/buffered/rotating/sink.1.log");
+
+        REQUIRE(content.size() <= 4096);
+        REQUIRE(rotated.size() <= 4096);
+        REQUIRE(rotated.size() + content.size() > 4096);
+        REQUIRE(expected.substr(expected.size() - content.size()) == content);
+    }
+
+    {
+        auto sink_table = generate_file_sink(
+            "daily_file_sink_st", "log/buffered/daily/sink.log");
+
+        sink_table->erase(names::FILENAME);
+        sink_table->insert(names::BASE_FILENAME, "log/buffered/daily/sink.log");
+        sink_table->insert(names::ROTATION_HOUR, static_cast<int64_t>(0));
+        sink_table->insert(names::ROTATION_MINUTE, static_cast<int64_t>(0));
+        sink_table->insert(names::DIRECT_IO, true);
+
+        const auto sink = spdlog_setup::details::setup_sink(sink_table);
+
+        REQUIRE(
+            typeid(*sink) ==
+            typeid(const spdlog_setup::buffered_daily_file_sink_st &));
+    }
+
+    auto sink_table =
+        generate_file_sink("basic_file_sink_mt", "log/buffered/invalid.log");
+
+    sink_table->insert(names::BUFFER_SIZE, std::string("0"));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(sink_table),
+        spdlog_setup::setup_error);
+}
+
+TEST_CASE("Write file sinks through io_uring", "[uring_file_sink]") {
+    namespace names = spdlog_setup::details::names;
+
+    // std
+    using std::ifstream;
+    using std::istreambuf_iterator;
+    using std::string;
+
+    const auto read_file = [](const string &path) {
+        ifstream istr(path, std::ios::binary);
+        return string(istreambuf_iterator<char>(istr), {});
+    };
+
+    const string path = "log/uring/sink.log";
+
+    auto sink_table = generate_file_sink("uring_file_sink_mt", path);
+    sink_table->insert(names::BUFFER_SIZE, std::string("4K"));
+    sink_table->insert(names::BUFFERS_IN_FLIGHT, static_cast<int64_t>(2));
+    sink_table->insert(names::TRUNCATE, true);
+
+    string expected;
+
+    {
+        const auto sink = spdlog_setup::details::setup_sink(sink_table);
+
+        REQUIRE(
+            typeid(*sink) == typeid(const spdlog_setup::uring_file_sink_mt &));
+
+        spdlog::logger logger("uring", sink);
+        logger.set_pattern("%v");
+
+        // keeps every buffer in flight, with partial buffers in between
+        for (auto i = 0; i < 10000; ++i) {
+            logger.info("message {}", i);
+            expected += "message " + std::to_string(i) + "\n";
+
+            // flushing waits for the buffers in flight to be written
+            if (i % 1000 == 0) {
+                logger.flush();
+                REQUIRE(read_file(path) == expected);
+            }
+        }
+    }
+
+    // every write is waited for once closed
+    REQUIRE(read_file(path) == expected);
+
+    sink_table->insert(names::TRUNCATE, false);
+    sink_table->insert(names::TYPE, std::string("uring_file_sink_st"));
+
+    {
+        const auto sink = spdlog_setup::details::setup_sink(sink_table);
+
+        REQUIRE(
+            typeid(*sink) == typeid(const spdlog_setup::uring_file_sink_st &));
+
+        spdlog::logger logger("uring", sink);
+        logger.set_pattern("%v");
+        logger.info("appended");
+    }
+
+    REQUIRE(read_file(path) == expected + "appended\n");
+
+    sink_table->insert(names::BUFFERS_IN_FLIGHT, static_cast<int64_t>(0));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(sink_table),
+        spdlog_setup::setup_error);
+
+    // beyond the entries io_uring_setup accepts
+    sink_table->insert(
+        names::BUFFERS_IN_FLIGHT, static_cast<int64_t>(32769));
+
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_sink(sink_table),
+        spdlog_setup::setup_error);
+}
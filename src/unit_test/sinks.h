@@ -44,3 +44,41 @@ inline auto generate_stderr_sink_mt() -> std::shared_ptr<cpptoml::table> {
     sink_table->insert(names::TYPE, std::string("stderr_sink_mt"));
     return std::move(sink_table);
 }
+
+inline auto generate_file_sinks(
+    const size_t count, const size_t sink_setup_threads)
+    -> std::shared_ptr<cpptoml::table> {
+    namespace names = spdlog_setup::details::names;
+
+    auto sink_table_array = cpptoml::make_table_array();
+
+    for (size_t i = 0; i < count; ++i) {
+        const auto index = std::to_string(i);
+
+        auto sink_table = cpptoml::make_table();
+        sink_table->insert(names::NAME, "file_" + index);
+        sink_table->insert(names::TYPE, std::string("basic_file_sink_mt"));
+        sink_table->insert(
+            names::FILENAME, "log/parallel/" + index + "/sink.log");
+        sink_table->insert(names::CREATE_PARENT_DIR, true);
+        sink_table_array->push_back(std::move(sink_table));
+    }
+
+    auto conf = cpptoml::make_table();
+    conf->insert(names::SINK_TABLE, std::move(sink_table_array));
+    conf->insert(names::SINK_SETUP_THREADS, sink_setup_threads);
+
+    return std::move(conf);
+}
+
+inline auto generate_file_sink(
+    const std::string &type, const std::string &filename)
+    -> std::shared_ptr<cpptoml::table> {
+    namespace names = spdlog_setup::details::names;
+
+    auto sink_table = cpptoml::make_table();
+    sink_table->insert(names::TYPE, type);
+    sink_table->insert(names::FILENAME, filename);
+    sink_table->insert(names::CREATE_PARENT_DIR, true);
+    return std::move(sink_table);
+}
@@ -8,6 +8,14 @@
 
 #include "thread_pool.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
 TEST_CASE("Parse global thread pool", "[parse_global_thread_pool]") {
     // Cannot test queue size and thread count as they are not exposed publicly
     // Can only test that the thread pool was changed to another instance
@@ -62,3 +70,344 @@ TEST_CASE(
             generate_invalid_no_num_threads_thread_pool()),
         spdlog_setup::setup_error);
 }
+
+TEST_CASE("Parse CPU list", "[parse_cpu_list]") {
+    using spdlog_setup::details::parse_cpu_list;
+
+    REQUIRE(parse_cpu_list("3") == std::vector<int>{3});
+    REQUIRE(parse_cpu_list("0-2, 8") == (std::vector<int>{0, 1, 2, 8}));
+    REQUIRE_THROWS_AS(parse_cpu_list("3-1"), spdlog_setup::setup_error);
+    REQUIRE_THROWS_AS(parse_cpu_list("0,,1"), spdlog_setup::setup_error);
+    REQUIRE_THROWS_AS(parse_cpu_list("a"), spdlog_setup::setup_error);
+}
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+TEST_CASE("Push and pop lock-free ring", "[lockfree_ring]") {
+    spdlog_setup::details::lockfree_ring<int> ring(3);
+    REQUIRE(ring.capacity() == 3);
+
+    auto item = 0;
+    REQUIRE(!ring.try_pop(item));
+
+    // wraps around more than once, keeping the order
+    for (auto lap = 0; lap < 3; ++lap) {
+        for (auto i = 1; i <= 3; ++i) {
+            auto pushed = lap * 10 + i;
+            REQUIRE(ring.try_push(pushed));
+        }
+
+        auto rejected = -1;
+        REQUIRE(!ring.try_push(rejected));
+        REQUIRE(rejected == -1);
+
+        for (auto i = 1; i <= 3; ++i) {
+            REQUIRE(ring.try_pop(item));
+            REQUIRE(item == lap * 10 + i);
+        }
+
+        REQUIRE(!ring.try_pop(item));
+    }
+}
+#endif
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+TEST_CASE("Push and pop single-producer ring", "[spsc_ring]") {
+    spdlog_setup::details::spsc_ring<int> ring(3);
+    REQUIRE(ring.capacity() == 3);
+
+    auto item = 0;
+    REQUIRE(!ring.try_pop(item));
+
+    // wraps around more than once, keeping the order
+    for (auto lap = 0; lap < 3; ++lap) {
+        for (auto i = 1; i <= 3; ++i) {
+            auto pushed = lap * 10 + i;
+            REQUIRE(ring.try_push(pushed));
+        }
+
+        auto rejected = -1;
+        REQUIRE(!ring.try_push(rejected));
+        REQUIRE(rejected == -1);
+        REQUIRE(ring.size_approx() == 3);
+
+        for (auto i = 1; i <= 3; ++i) {
+            REQUIRE(ring.try_pop(item));
+            REQUIRE(item == lap * 10 + i);
+        }
+
+        REQUIRE(!ring.try_pop(item));
+    }
+
+    REQUIRE(ring.pushed_count() == 9);
+    REQUIRE(ring.popped_count() == 9);
+
+#ifndef NDEBUG
+    spdlog_setup::details::managed_spsc_queue spsc(1);
+    REQUIRE(spsc.claim_producer());
+    REQUIRE(spsc.claim_producer());
+
+    auto other_claimed = true;
+    std::thread([&spsc, &other_claimed] {
+        other_claimed = spsc.claim_producer();
+    }).join();
+
+    REQUIRE(!other_claimed);
+#endif
+}
+#endif
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+TEST_CASE("Count messages dropped on overflow", "[overflow_drops]") {
+    using spdlog_setup::details::managed_async_logger;
+    using spdlog_setup::details::managed_pool_options;
+    using spdlog_setup::details::managed_thread_pool;
+    using spdlog_setup::details::overflow_handling;
+    using spdlog_setup::details::overflow_policy;
+
+    // logs into a pool with a queue of 4, whose worker is held up writing
+    // the first message, so that the queue fills up
+    const auto overfill = [](
+                              const overflow_handling &overflow,
+                              const spdlog::level::level_enum level,
+                              const int extra_count) {
+        const auto sink = std::make_shared<gated_sink>();
+
+        auto pool = std::make_shared<managed_thread_pool>(
+            4, 1, managed_pool_options(), 1, nullptr);
+
+        const auto logger = std::make_shared<managed_async_logger>(
+            "overflow", std::vector<spdlog::sink_ptr>{sink}, pool, overflow);
+
+        std::unique_lock<std::mutex> gate(sink->gate);
+        logger->warn("held");
+
+        while (sink->entered == 0) {
+            std::this_thread::yield();
+        }
+
+        for (auto i = 0; i < 4 + extra_count; ++i) {
+            logger->log(level, "{}", i);
+        }
+
+        gate.unlock();
+
+        // writes out everything queued
+        pool.reset();
+
+        const auto dropped = logger->dropped();
+        const auto written = static_cast<uint64_t>(sink->written.load());
+
+        REQUIRE(
+            written == 5 + extra_count - dropped.discarded -
+                           dropped.timed_out - dropped.overrun -
+                           dropped.below_level);
+
+        return dropped;
+    };
+
+    overflow_handling overflow;
+
+    overflow.policy = overflow_policy::DiscardNew;
+    REQUIRE(overfill(overflow, spdlog::level::info, 3).discarded == 3);
+
+    overflow.policy = overflow_policy::OverrunOldest;
+    REQUIRE(overfill(overflow, spdlog::level::info, 2).overrun == 2);
+
+    overflow.policy = overflow_policy::BlockWithTimeout;
+    overflow.timeout = std::chrono::milliseconds(1);
+    REQUIRE(overfill(overflow, spdlog::level::info, 2).timed_out == 2);
+
+    // info is dropped from three quarters full onwards
+    overflow.policy = overflow_policy::DropBelowLevel;
+    REQUIRE(overfill(overflow, spdlog::level::info, 0).below_level == 1);
+
+    // clones keep the pool and the overflow policy
+    const auto pool = std::make_shared<managed_thread_pool>(
+        4, 1, managed_pool_options(), 1, nullptr);
+
+    const auto logger = std::make_shared<managed_async_logger>(
+        "original", std::vector<spdlog::sink_ptr>{}, pool, overflow);
+
+    const auto cloned = logger->clone("cloned");
+    REQUIRE(cloned->name() == "cloned");
+
+    REQUIRE(
+        typeid(*cloned) ==
+        typeid(const spdlog_setup::details::managed_async_logger &));
+}
+#endif
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+TEST_CASE("Write messages in batches", "[batch_draining]") {
+    using spdlog_setup::details::managed_async_logger;
+    using spdlog_setup::details::managed_pool_options;
+    using spdlog_setup::details::managed_thread_pool;
+    using spdlog_setup::details::overflow_handling;
+
+    const auto sink = std::make_shared<gated_sink>();
+
+    managed_pool_options options;
+    options.batch_size = 8;
+
+    auto pool =
+        std::make_shared<managed_thread_pool>(16, 1, options, 1, nullptr);
+
+    const auto logger = std::make_shared<managed_async_logger>(
+        "batch",
+        std::vector<spdlog::sink_ptr>{sink},
+        pool,
+        overflow_handling());
+
+    logger->flush_on(spdlog::level::trace);
+
+    // the messages queue up while the worker is held up by the first one
+    std::unique_lock<std::mutex> gate(sink->gate);
+    logger->info("held");
+
+    while (sink->entered == 0) {
+        std::this_thread::yield();
+    }
+
+    for (auto i = 0; i < 6; ++i) {
+        logger->info("{}", i);
+    }
+
+    gate.unlock();
+    pool.reset();
+
+    // flushed once for the first message, and once for the batch of the rest
+    REQUIRE(sink->written == 7);
+    REQUIRE(sink->flushed == 2);
+}
+#endif
+
+#ifdef SPDLOG_SETUP_MANAGED_THREAD_POOL
+TEST_CASE("Close and discard queued messages", "[managed_shutdown]") {
+    using spdlog_setup::details::managed_async_logger;
+    using spdlog_setup::details::managed_pool_options;
+    using spdlog_setup::details::managed_thread_pool;
+    using spdlog_setup::details::overflow_handling;
+
+    const auto sink = std::make_shared<gated_sink>();
+
+    auto pool = std::make_shared<managed_thread_pool>(
+        16, 1, managed_pool_options(), 1, nullptr);
+
+    const auto logger = std::make_shared<managed_async_logger>(
+        "shutdown",
+        std::vector<spdlog::sink_ptr>{sink},
+        pool,
+        overflow_handling());
+
+    REQUIRE(pool->idle());
+
+    // the messages queue up while the worker is held up by the first one
+    std::unique_lock<std::mutex> gate(sink->gate);
+    logger->info("held");
+
+    while (sink->entered == 0) {
+        std::this_thread::yield();
+    }
+
+    for (auto i = 0; i < 4; ++i) {
+        logger->info("{}", i);
+    }
+
+    REQUIRE_FALSE(pool->idle());
+
+    pool->close();
+    logger->info("rejected");
+    logger->info("rejected");
+    REQUIRE(pool->rejected() == 2);
+    REQUIRE(pool->queue_depth() == 4);
+
+    pool->discard_queued();
+    gate.unlock();
+
+    REQUIRE(pool->wait_idle(
+        std::chrono::steady_clock::now() + std::chrono::seconds(5)));
+
+    // only the message being written when discarding is written out
+    REQUIRE(sink->written == 1);
+    REQUIRE(pool->queue_depth() == 0);
+}
+#endif
+
+TEST_CASE(
+    "Wait for the message being written on shutdown", "[shutdown_in_flight]") {
+    const auto original = spdlog::thread_pool();
+
+    spdlog_setup::details::setup_thread_pools(generate_global_thread_pool());
+
+    const auto sink = std::make_shared<gated_sink>();
+
+    const auto logger = std::make_shared<spdlog::async_logger>(
+        "in_flight", sink, spdlog::thread_pool());
+
+    std::atomic<bool> gate_locked{false};
+
+    std::thread gatekeeper([&sink, &gate_locked] {
+        std::lock_guard<std::mutex> gate(sink->gate);
+        gate_locked = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    });
+
+    while (!gate_locked) {
+        std::this_thread::yield();
+    }
+
+    logger->info("held");
+
+    // nothing is queued any more, but the message is not written yet
+    while (sink->entered == 0) {
+        std::this_thread::yield();
+    }
+
+    const auto report = spdlog_setup::shutdown(
+        std::chrono::steady_clock::now() + std::chrono::seconds(5));
+
+    const int written = sink->written;
+    gatekeeper.join();
+
+    REQUIRE(report.completed);
+    REQUIRE(written == 1);
+
+    spdlog::set_level(spdlog::level::info);
+    spdlog::details::registry::instance().set_tp(original);
+}
+
+#ifdef SPDLOG_SETUP_THREAD_SCHEDULING
+TEST_CASE("Parse scheduled thread pool", "[parse_scheduled_thread_pool]") {
+    cpu_set_t cpu_set;
+    REQUIRE(sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0);
+
+    // any CPU the process may run on
+    auto cpu = 0;
+
+    while (!CPU_ISSET(cpu, &cpu_set)) {
+        ++cpu;
+    }
+
+    const auto thread_pools = spdlog_setup::details::setup_thread_pools(
+        generate_scheduled_thread_pool(
+            std::to_string(cpu), "spdlog_setup_test_worker"));
+
+    REQUIRE(thread_pools.size() == 1);
+
+    // a CPU the process may not run on fails when the workers start
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_thread_pools(
+            generate_scheduled_thread_pool(
+                std::to_string(CPU_SETSIZE - 1), "spdlog_setup")),
+        spdlog_setup::setup_error);
+}
+#else
+TEST_CASE(
+    "Parse unsupported scheduled thread pool",
+    "[parse_unsupported_scheduled_thread_pool]") {
+    REQUIRE_THROWS_AS(
+        spdlog_setup::details::setup_thread_pools(
+            generate_scheduled_thread_pool("0", "spdlog_setup")),
+        spdlog_setup::setup_error);
+}
+#endif
@@ -8,7 +8,11 @@
 
 #include "conf.h"
 
+#include "spdlog/sinks/base_sink.h"
+
+#include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 
@@ -117,3 +121,46 @@ inline auto generate_invalid_no_num_threads_thread_pool()
 
     return std::move(conf);
 }
+
+inline auto generate_scheduled_thread_pool(
+    const std::string &cpu_affinity, const std::string &thread_name)
+    -> std::shared_ptr<cpptoml::table> {
+    namespace names = spdlog_setup::details::names;
+
+    auto thread_pool_table_array = cpptoml::make_table_array();
+
+    auto thread_pool_table = cpptoml::make_table();
+    thread_pool_table->insert(names::NAME, TEST_THREAD_POOL_NAME);
+    thread_pool_table->insert(names::QUEUE_SIZE, size_t(1234));
+    thread_pool_table->insert(names::NUM_THREADS, size_t(2));
+    thread_pool_table->insert(names::CPU_AFFINITY, cpu_affinity);
+    thread_pool_table->insert(names::NICE, 5);
+    thread_pool_table->insert(names::SCHED_POLICY, std::string("batch"));
+    thread_pool_table->insert(names::THREAD_NAME, thread_name);
+    thread_pool_table_array->push_back(std::move(thread_pool_table));
+
+    auto conf = cpptoml::make_table();
+    conf->insert(names::THREAD_POOL_TABLE, std::move(thread_pool_table_array));
+
+    return std::move(conf);
+}
+
+/**
+ * Sink that holds up the worker writing into it while the gate is locked.
+ */
+class gated_sink : public spdlog::sinks::base_sink<std::mutex> {
+  public:
+    std::mutex gate;
+    std::atomic<int> entered{0};
+    std::atomic<int> written{0};
+    std::atomic<int> flushed{0};
+
+  protected:
+    void sink_it_(const spdlog::details::log_msg &) override {
+        ++entered;
+        std::lock_guard<std::mutex> lock(gate);
+        ++written;
+    }
+
+    void flush_() override { ++flushed; }
+};